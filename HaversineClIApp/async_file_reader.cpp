@@ -0,0 +1,656 @@
+#include "async_file_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAS_IO_URING 1
+#endif
+#endif
+
+#ifndef HAS_IO_URING
+#define HAS_IO_URING 0
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+#ifdef _WIN32
+using FileHandle = HANDLE;
+static const FileHandle INVALID_FILE{INVALID_HANDLE_VALUE};
+
+static FileHandle openForReading(const std::string& path)
+{
+  return CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                     nullptr);
+}
+
+static size_t fileSizeOf(FileHandle file)
+{
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file, &size);
+  return static_cast<size_t>(size.QuadPart);
+}
+
+// Reads all size bytes at offset, returns false when a read fails or the file ends first
+static bool readAt(FileHandle file, char* destination, size_t size, size_t offset)
+{
+  while(size > 0u)
+  {
+    OVERLAPPED position{};
+    position.Offset = static_cast<DWORD>(offset);
+    position.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32u);
+    DWORD bytesRead{0u};
+    const DWORD readSize{static_cast<DWORD>(size < 0x40000000u ? size : 0x40000000u)};
+    if(!ReadFile(file, destination, readSize, &bytesRead, &position) || bytesRead == 0u)
+    {
+      return false;
+    }
+    destination += bytesRead;
+    offset += bytesRead;
+    size -= bytesRead;
+  }
+  return true;
+}
+
+static void closeFile(FileHandle file)
+{
+  CloseHandle(file);
+}
+#else
+using FileHandle = int;
+static const FileHandle INVALID_FILE{-1};
+
+static FileHandle openForReading(const std::string& path)
+{
+  return open(path.c_str(), O_RDONLY);
+}
+
+static size_t fileSizeOf(FileHandle file)
+{
+  struct stat status{};
+  fstat(file, &status);
+  return static_cast<size_t>(status.st_size);
+}
+
+// Reads all size bytes at offset, returns false when a read fails or the file ends first
+static bool readAt(FileHandle file, char* destination, size_t size, size_t offset)
+{
+  while(size > 0u)
+  {
+    const ssize_t bytesRead{pread(file, destination, size, static_cast<off_t>(offset))};
+    if(bytesRead <= 0)
+    {
+      if(bytesRead < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    destination += bytesRead;
+    offset += static_cast<size_t>(bytesRead);
+    size -= static_cast<size_t>(bytesRead);
+  }
+  return true;
+}
+
+static void closeFile(FileHandle file)
+{
+  close(file);
+}
+#endif
+
+// Block b is read into slot b % depth. The caller holds the blocks in [nextBlock - held, nextBlock), the slots of the
+// depth blocks from nextBlock - held on are being read or waiting to be handed out.
+struct AsyncFileReader::Impl
+{
+  Impl(FileHandle file_, size_t blockSize_, size_t depth_, size_t headroom_)
+      : file{file_}, fileSize{fileSizeOf(file_)}, blockSize{blockSize_}, depth{depth_}, headroom{headroom_},
+        blockCount{(fileSize + blockSize - 1u) / blockSize},
+        storage{std::make_unique<char[]>(depth * (headroom + blockSize))}
+  {
+  }
+
+  virtual ~Impl()
+  {
+    closeFile(file);
+  }
+
+  char* slotData(size_t slot) const
+  {
+    return storage.get() + slot * (headroom + blockSize) + headroom;
+  }
+
+  size_t blockBytes(size_t block) const
+  {
+    return std::min(blockSize, fileSize - block * blockSize);
+  }
+
+  // Waits until block is read into its slot, throws when the read failed
+  virtual void waitFor(size_t block) = 0;
+  // The slot of block was given back and can take the read of block + depth
+  virtual void released(size_t block) = 0;
+  virtual AsyncReadBackend backend() const = 0;
+  virtual double readSeconds() const = 0;
+
+  FileHandle file;
+  size_t fileSize;
+  size_t blockSize;
+  size_t depth;
+  size_t headroom;
+  size_t blockCount;
+  std::unique_ptr<char[]> storage;
+
+  size_t nextBlock{0u};
+  size_t held{0u};
+  double waitSeconds{0.0};
+};
+
+namespace
+{
+
+class ReadThreadImpl final : public AsyncFileReader::Impl
+{
+ public:
+  ReadThreadImpl(FileHandle file_, size_t blockSize_, size_t depth_, size_t headroom_)
+      : Impl(file_, blockSize_, depth_, headroom_), _thread(&ReadThreadImpl::run, this)
+  {
+  }
+
+  ~ReadThreadImpl() override
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+  }
+
+  void waitFor(size_t block) override
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_readCount <= block && !_failed)
+    {
+      const auto start = Clock::now();
+      _changed.wait(lock, [&] { return _readCount > block || _failed; });
+      waitSeconds += secondsSince(start);
+    }
+    if(_readCount <= block)
+    {
+      throw std::runtime_error("Read failed");
+    }
+  }
+
+  void released(size_t block) override
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _releasedCount = block + 1u;
+    }
+    _changed.notify_all();
+  }
+
+  AsyncReadBackend backend() const override
+  {
+    return AsyncReadBackend::READ_THREAD;
+  }
+
+  double readSeconds() const override
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _readSeconds;
+  }
+
+ private:
+  void run()
+  {
+    for(size_t block{0u}; block < blockCount; block++)
+    {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [&] { return block < _releasedCount + depth || _stop; });
+        if(_stop)
+        {
+          return;
+        }
+      }
+
+      const auto start = Clock::now();
+      const bool succeeded{readAt(file, slotData(block % depth), blockBytes(block), block * blockSize)};
+      const double seconds{secondsSince(start)};
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _readSeconds += seconds;
+        if(succeeded)
+        {
+          _readCount = block + 1u;
+        }
+        else
+        {
+          _failed = true;
+        }
+      }
+      _changed.notify_all();
+      if(!succeeded)
+      {
+        return;
+      }
+    }
+  }
+
+  mutable std::mutex _mutex;
+  std::condition_variable _changed;
+  size_t _readCount{0u};
+  size_t _releasedCount{0u};
+  double _readSeconds{0.0};
+  bool _failed{false};
+  bool _stop{false};
+  std::thread _thread; // NOTE: Last, it starts reading as soon as it is constructed
+};
+
+#if HAS_IO_URING
+
+// An SQE's length is 32 bit. Larger blocks are read 1gb at a time, like readAt does on Windows.
+static constexpr size_t MAX_SQE_READ_SIZE{0x40000000u};
+
+int ioUringSetup(unsigned entries, io_uring_params* params)
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ring, unsigned opcode, const void* arguments, unsigned count)
+{
+  return static_cast<int>(syscall(__NR_io_uring_register, ring, opcode, arguments, count));
+}
+
+// io_uring through the raw system calls, no liburing. The rings are shared with the kernel: this side only writes
+// the submission tail and the completion head, with release stores, and reads the other ends with acquire loads.
+class IoUringImpl final : public AsyncFileReader::Impl
+{
+ public:
+  IoUringImpl(FileHandle file_, size_t blockSize_, size_t depth_, size_t headroom_)
+      : Impl(file_, blockSize_, depth_, headroom_), _slots(depth_)
+  {
+  }
+
+  ~IoUringImpl() override
+  {
+    // NOTE: Reads still in flight write into the buffers, they have to finish before the storage goes
+    if(_ring != -1)
+    {
+      while(_inFlight > 0u && ioUringEnter(_ring, 0u, 1u, IORING_ENTER_GETEVENTS) >= 0)
+      {
+        reap(nullptr);
+      }
+    }
+    if(_sqes)
+    {
+      munmap(_sqes, _sqesSize);
+    }
+    if(_cqRing && _cqRing != _sqRing)
+    {
+      munmap(_cqRing, _cqRingSize);
+    }
+    if(_sqRing)
+    {
+      munmap(_sqRing, _sqRingSize);
+    }
+    if(_ring != -1)
+    {
+      close(_ring);
+    }
+  }
+
+  // Returns false, leaving the caller to fall back to the read thread, when the kernel doesn't offer io_uring or
+  // doesn't allow it (io_uring_disabled, seccomp)
+  bool start()
+  {
+    io_uring_params params{};
+    _ring = ioUringSetup(static_cast<unsigned>(depth), &params);
+    if(_ring < 0)
+    {
+      _ring = -1;
+      return false;
+    }
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap{(params.features & IORING_FEAT_SINGLE_MMAP) != 0u};
+    if(singleMap)
+    {
+      _sqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+    _sqRing = mapRing(_sqRingSize, IORING_OFF_SQ_RING);
+    _cqRing = singleMap ? _sqRing : mapRing(_cqRingSize, IORING_OFF_CQ_RING);
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe*>(mapRing(_sqesSize, IORING_OFF_SQES));
+    if(!_sqRing || !_cqRing || !_sqes)
+    {
+      return false;
+    }
+
+    char* sq{static_cast<char*>(_sqRing)};
+    _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq{static_cast<char*>(_cqRing)};
+    _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // NOTE: Registered buffers are pinned once instead of on every read. Pinning can run into RLIMIT_MEMLOCK on
+    // older kernels, plain reads into the same buffers work without it.
+    std::vector<iovec> buffers(depth);
+    for(size_t slot{0u}; slot < depth; slot++)
+    {
+      buffers[slot].iov_base = slotData(slot);
+      buffers[slot].iov_len = blockSize;
+    }
+    _fixedBuffers = ioUringRegister(_ring, IORING_REGISTER_BUFFERS, buffers.data(),
+                                    static_cast<unsigned>(buffers.size())) == 0;
+    // NOTE: Cached data would otherwise be copied inline by io_uring_enter, on this thread - nothing would overlap
+    _forceAsync = (params.features & IORING_FEAT_FAST_POLL) != 0u;
+
+    for(size_t block{0u}; block < std::min(depth, blockCount); block++)
+    {
+      queueBlock(block);
+    }
+    return true;
+  }
+
+  void waitFor(size_t block) override
+  {
+    Slot& slot{_slots[block % depth]};
+    reap(nullptr);
+    if(!slot.done)
+    {
+      const auto start = Clock::now();
+      size_t bytesArrived{0u};
+      while(!slot.done)
+      {
+        if(ioUringEnter(_ring, 0u, 1u, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+        {
+          throw std::runtime_error("io_uring_enter failed");
+        }
+        reap(&bytesArrived);
+      }
+      const double seconds{secondsSince(start)};
+      waitSeconds += seconds;
+      _bytesArrivedWaiting += bytesArrived;
+    }
+    if(slot.error != 0)
+    {
+      throw std::runtime_error(std::string("Read failed: ") + std::strerror(slot.error));
+    }
+  }
+
+  void released(size_t block) override
+  {
+    if(block + depth < blockCount)
+    {
+      queueBlock(block + depth);
+    }
+  }
+
+  AsyncReadBackend backend() const override
+  {
+    return AsyncReadBackend::IO_URING;
+  }
+
+  double readSeconds() const override
+  {
+    if(_bytesArrivedWaiting == 0u)
+    {
+      return 0.0;
+    }
+    return waitSeconds * static_cast<double>(fileSize) / static_cast<double>(_bytesArrivedWaiting);
+  }
+
+ private:
+  struct Slot
+  {
+    size_t block{0u};
+    size_t filled{0u};
+    bool done{false};
+    int error{0};
+  };
+
+  void* mapRing(size_t size, uint64_t offset) const
+  {
+    void* ring{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring,
+                    static_cast<off_t>(offset))};
+    return ring == MAP_FAILED ? nullptr : ring;
+  }
+
+  void queueBlock(size_t block)
+  {
+    Slot& slot{_slots[block % depth]};
+    slot = Slot{};
+    slot.block = block;
+    submitRead(block % depth);
+  }
+
+  // Reads the rest of the slot's block, a short read is continued where it stopped
+  void submitRead(size_t slotIndex)
+  {
+    const Slot& slot{_slots[slotIndex]};
+    const unsigned tail{*_sqTail};
+    const unsigned index{tail & _sqMask};
+    io_uring_sqe& sqe{_sqes[index]};
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = _fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe.flags = _forceAsync ? IOSQE_ASYNC : 0u;
+    sqe.fd = file;
+    sqe.off = slot.block * blockSize + slot.filled;
+    sqe.addr = reinterpret_cast<uint64_t>(slotData(slotIndex) + slot.filled);
+    // NOTE: The rest of a capped read is continued by reap like any short read
+    const size_t remaining{blockBytes(slot.block) - slot.filled};
+    sqe.len = static_cast<uint32_t>(remaining < MAX_SQE_READ_SIZE ? remaining : MAX_SQE_READ_SIZE);
+    sqe.buf_index = static_cast<uint16_t>(slotIndex);
+    sqe.user_data = slotIndex;
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1u, __ATOMIC_RELEASE);
+
+    int submitted;
+    do
+    {
+      submitted = ioUringEnter(_ring, 1u, 0u, 0u);
+    } while(submitted < 0 && (errno == EINTR || errno == EAGAIN));
+    if(submitted < 0)
+    {
+      throw std::runtime_error("io_uring_enter failed");
+    }
+    _inFlight++;
+  }
+
+  // Takes every completion the kernel has posted. bytesArrived, when given, counts the bytes the reads brought in.
+  void reap(size_t* bytesArrived)
+  {
+    unsigned head{*_cqHead};
+    const unsigned tail{__atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)};
+    for(; head != tail; head++)
+    {
+      const io_uring_cqe& cqe{_cqes[head & _cqMask]};
+      Slot& slot{_slots[cqe.user_data]};
+      _inFlight--;
+      if(cqe.res < 0)
+      {
+        slot.error = -cqe.res;
+        slot.done = true;
+        continue;
+      }
+      slot.filled += static_cast<size_t>(cqe.res);
+      if(bytesArrived)
+      {
+        *bytesArrived += static_cast<size_t>(cqe.res);
+      }
+      if(cqe.res == 0 && slot.filled < blockBytes(slot.block))
+      {
+        slot.error = EIO; // NOTE: The file got shorter while it was read
+        slot.done = true;
+      }
+      else if(slot.filled < blockBytes(slot.block))
+      {
+        submitRead(cqe.user_data);
+      }
+      else
+      {
+        slot.done = true;
+      }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  std::vector<Slot> _slots;
+  int _ring{-1};
+  void* _sqRing{nullptr};
+  void* _cqRing{nullptr};
+  size_t _sqRingSize{0u};
+  size_t _cqRingSize{0u};
+  io_uring_sqe* _sqes{nullptr};
+  size_t _sqesSize{0u};
+  unsigned* _sqTail{nullptr};
+  unsigned _sqMask{0u};
+  unsigned* _sqArray{nullptr};
+  unsigned* _cqHead{nullptr};
+  unsigned* _cqTail{nullptr};
+  unsigned _cqMask{0u};
+  io_uring_cqe* _cqes{nullptr};
+  bool _fixedBuffers{false};
+  bool _forceAsync{false};
+  size_t _inFlight{0u};
+  size_t _bytesArrivedWaiting{0u};
+};
+
+#endif
+
+} // namespace
+
+AsyncFileReader::AsyncFileReader(const std::string& path, size_t blockSize, size_t depth, size_t headroom,
+                                 bool preferIoUring)
+{
+  if(blockSize == 0u || depth == 0u)
+  {
+    throw std::invalid_argument("The block size and the depth must not be 0");
+  }
+
+  // NOTE: The backends own the handle once constructed, they close it
+  const auto openFile = [&path] {
+    FileHandle file{openForReading(path)};
+    if(file == INVALID_FILE)
+    {
+      throw std::runtime_error("Could not open file");
+    }
+    return file;
+  };
+
+#if HAS_IO_URING
+  if(preferIoUring)
+  {
+    auto ioUring = std::make_unique<IoUringImpl>(openFile(), blockSize, depth, headroom);
+    if(ioUring->start())
+    {
+      _impl = std::move(ioUring);
+      return;
+    }
+  }
+#else
+  (void)preferIoUring;
+#endif
+  _impl = std::make_unique<ReadThreadImpl>(openFile(), blockSize, depth, headroom);
+}
+
+AsyncFileReader::~AsyncFileReader() = default;
+
+bool AsyncFileReader::next(Block& block)
+{
+  Impl& impl{*_impl};
+  if(impl.nextBlock == impl.blockCount)
+  {
+    return false;
+  }
+  if(impl.held == impl.depth)
+  {
+    throw std::logic_error("Every buffer is held, release one first");
+  }
+
+  impl.waitFor(impl.nextBlock);
+  block.data = impl.slotData(impl.nextBlock % impl.depth);
+  block.size = impl.blockBytes(impl.nextBlock);
+  block.offset = impl.nextBlock * impl.blockSize;
+  impl.nextBlock++;
+  impl.held++;
+  return true;
+}
+
+void AsyncFileReader::release()
+{
+  Impl& impl{*_impl};
+  if(impl.held == 0u)
+  {
+    throw std::logic_error("No block is held");
+  }
+  const size_t block{impl.nextBlock - impl.held};
+  impl.held--;
+  impl.released(block);
+}
+
+AsyncReadBackend AsyncFileReader::backend() const
+{
+  return _impl->backend();
+}
+
+size_t AsyncFileReader::fileSize() const
+{
+  return _impl->fileSize;
+}
+
+double AsyncFileReader::waitSeconds() const
+{
+  return _impl->waitSeconds;
+}
+
+double AsyncFileReader::readSeconds() const
+{
+  return _impl->readSeconds();
+}
+
+const char* asyncReadBackendName(AsyncReadBackend backend)
+{
+  switch(backend)
+  {
+    case AsyncReadBackend::IO_URING:
+      return "io_uring";
+    case AsyncReadBackend::READ_THREAD:
+      return "read thread";
+  }
+  return "unknown";
+}
@@ -0,0 +1,59 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_ASYNC_FILE_READER_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_ASYNC_FILE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class AsyncReadBackend : uint8_t
+{
+  IO_URING,    // Linux, reads queued in the kernel into registered buffers
+  READ_THREAD  // anywhere else, or when io_uring is unavailable: one thread doing the reads in order
+};
+
+// Reads a file front to back in fixed-size blocks with up to depth reads in flight, so the caller can work on one
+// block while the next ones are read. Blocks come out in file order. The caller holds at most depth blocks at once
+// and gives them back in the order it got them, each released buffer takes the next read.
+//
+// Every buffer has headroom writable bytes in front of its data, so the tail of the previous block can be copied
+// there and parsed as one piece with the new block.
+class AsyncFileReader
+{
+ public:
+  struct Block
+  {
+    char* data{nullptr};
+    size_t size{0u};
+    size_t offset{0u}; // of data in the file
+  };
+
+  // Throws std::runtime_error when the file can't be opened. preferIoUring false always uses the read thread.
+  AsyncFileReader(const std::string& path, size_t blockSize, size_t depth, size_t headroom, bool preferIoUring = true);
+  ~AsyncFileReader();
+
+  AsyncFileReader(const AsyncFileReader&) = delete;
+  AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+  // Waits for the next block. Returns false after the last one, throws std::runtime_error when a read failed.
+  bool next(Block& block);
+  // Gives back the oldest block still held
+  void release();
+
+  [[nodiscard]] AsyncReadBackend backend() const;
+  [[nodiscard]] size_t fileSize() const;
+  // Time next() spent blocked on reads - the part of the read time the caller did not hide behind its own work
+  [[nodiscard]] double waitSeconds() const;
+  // Time the reads took. Measured per read on the read thread; io_uring can't time its reads, so there it is the
+  // file size over the rate blocks arrived at while next() was waiting, when the reads were the bottleneck.
+  [[nodiscard]] double readSeconds() const;
+
+  struct Impl;
+
+ private:
+  std::unique_ptr<Impl> _impl;
+};
+
+[[nodiscard]] const char* asyncReadBackendName(AsyncReadBackend backend);
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_ASYNC_FILE_READER_H_
@@ -0,0 +1,87 @@
+#include "fast_haversine.h"
+
+#include <cmath>
+
+#include "cpu_features.h"
+#include "fast_haversine_math.h"
+
+namespace
+{
+
+struct ScalarLanes
+{
+  using Vector = double;
+  using Mask = bool;
+  static constexpr size_t WIDTH{1u};
+
+  static Vector broadcast(double value) { return value; }
+  static Vector load(const double* source) { return *source; }
+  static void store(double* destination, Vector value) { *destination = value; }
+  static Vector add(Vector a, Vector b) { return a + b; }
+  static Vector sub(Vector a, Vector b) { return a - b; }
+  static Vector mul(Vector a, Vector b) { return a * b; }
+  // NOTE: Same operand order as maxpd, b wins when either is NaN
+  static Vector max(Vector a, Vector b) { return a > b ? a : b; }
+  static Vector sqrt(Vector a) { return std::sqrt(a); }
+  static Vector negate(Vector a) { return -a; }
+  static Vector roundNearest(Vector a) { return std::nearbyint(a); }
+  static Vector floor(Vector a) { return std::floor(a); }
+  static Mask lessEqual(Vector a, Vector b) { return a <= b; }
+  static Mask equal(Vector a, Vector b) { return a == b; }
+  static Mask maskOr(Mask a, Mask b) { return a || b; }
+  static Vector select(Mask mask, Vector ifTrue, Vector ifFalse) { return mask ? ifTrue : ifFalse; }
+};
+
+} // namespace
+
+void fastHaversineScalar(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                         double earthRadius, double* distances)
+{
+  haversineBatch<ScalarLanes>(x0, y0, x1, y1, count, earthRadius, distances);
+}
+
+bool isHaversineKernelSupported(HaversineKernel kernel)
+{
+  switch(kernel)
+  {
+    case HaversineKernel::SCALAR: return true;
+    case HaversineKernel::AVX2: return getCpuFeatures().avx2;
+    case HaversineKernel::AVX512: return getCpuFeatures().avx512f;
+  }
+  return false;
+}
+
+HaversineKernel bestHaversineKernel()
+{
+  if(isHaversineKernelSupported(HaversineKernel::AVX512))
+  {
+    return HaversineKernel::AVX512;
+  }
+  if(isHaversineKernelSupported(HaversineKernel::AVX2))
+  {
+    return HaversineKernel::AVX2;
+  }
+  return HaversineKernel::SCALAR;
+}
+
+const char* haversineKernelName(HaversineKernel kernel)
+{
+  switch(kernel)
+  {
+    case HaversineKernel::SCALAR: return "scalar";
+    case HaversineKernel::AVX2: return "avx2";
+    case HaversineKernel::AVX512: return "avx512";
+  }
+  return "unknown";
+}
+
+void fastHaversine(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                   double earthRadius, double* distances, HaversineKernel kernel)
+{
+  switch(isHaversineKernelSupported(kernel) ? kernel : HaversineKernel::SCALAR)
+  {
+    case HaversineKernel::SCALAR: fastHaversineScalar(x0, y0, x1, y1, count, earthRadius, distances); break;
+    case HaversineKernel::AVX2: fastHaversineAvx2(x0, y0, x1, y1, count, earthRadius, distances); break;
+    case HaversineKernel::AVX512: fastHaversineAvx512(x0, y0, x1, y1, count, earthRadius, distances); break;
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+enum class HaversineKernel : uint8_t
+{
+  SCALAR,
+  AVX2,  // 4 pairs per instruction
+  AVX512 // 8 pairs per instruction
+};
+
+[[nodiscard]] bool isHaversineKernelSupported(HaversineKernel kernel);
+[[nodiscard]] HaversineKernel bestHaversineKernel();
+[[nodiscard]] const char* haversineKernelName(HaversineKernel kernel);
+
+// Batch version of ReferenceHaversine over struct-of-arrays input, writes count distances. Follows the reference
+// formula step by step, but sin, cos and asin are polynomial approximations evaluated on every lane at once instead
+// of libm calls. Every kernel computes bit-identical results, only the width differs. An unsupported kernel falls
+// back to the scalar one.
+//
+// sqrt stays the hardware instruction, it is already correctly rounded. 99.8% of the distances are within 4 ulp of
+// ReferenceHaversine, and the worst case against an exact evaluation is the reference's own - the measurements are
+// in fast_haversine_math.h.
+void fastHaversine(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                   double earthRadius, double* distances, HaversineKernel kernel = bestHaversineKernel());
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_H_
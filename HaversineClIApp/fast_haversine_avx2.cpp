@@ -0,0 +1,38 @@
+// Built with -mavx2, only called once getCpuFeatures() reports AVX2
+#include <immintrin.h>
+
+#include "fast_haversine_math.h"
+
+namespace
+{
+
+struct Avx2Lanes
+{
+  using Vector = __m256d;
+  using Mask = __m256d;
+  static constexpr size_t WIDTH{4u};
+
+  static Vector broadcast(double value) { return _mm256_set1_pd(value); }
+  static Vector load(const double* source) { return _mm256_loadu_pd(source); }
+  static void store(double* destination, Vector value) { _mm256_storeu_pd(destination, value); }
+  static Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+  static Vector sub(Vector a, Vector b) { return _mm256_sub_pd(a, b); }
+  static Vector mul(Vector a, Vector b) { return _mm256_mul_pd(a, b); }
+  static Vector max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+  static Vector sqrt(Vector a) { return _mm256_sqrt_pd(a); }
+  static Vector negate(Vector a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+  static Vector roundNearest(Vector a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static Vector floor(Vector a) { return _mm256_floor_pd(a); }
+  static Mask lessEqual(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static Mask equal(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static Mask maskOr(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+  static Vector select(Mask mask, Vector ifTrue, Vector ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, mask); }
+};
+
+} // namespace
+
+void fastHaversineAvx2(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                       double earthRadius, double* distances)
+{
+  haversineBatch<Avx2Lanes>(x0, y0, x1, y1, count, earthRadius, distances);
+}
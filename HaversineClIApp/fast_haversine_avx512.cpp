@@ -0,0 +1,42 @@
+// Built with -mavx512f, only called once getCpuFeatures() reports AVX-512F
+#include <immintrin.h>
+
+#include "fast_haversine_math.h"
+
+namespace
+{
+
+// NOTE: Sticks to AVX-512F, so the float xor (AVX-512DQ) is done on the integer view
+struct Avx512Lanes
+{
+  using Vector = __m512d;
+  using Mask = __mmask8;
+  static constexpr size_t WIDTH{8u};
+
+  static Vector broadcast(double value) { return _mm512_set1_pd(value); }
+  static Vector load(const double* source) { return _mm512_loadu_pd(source); }
+  static void store(double* destination, Vector value) { _mm512_storeu_pd(destination, value); }
+  static Vector add(Vector a, Vector b) { return _mm512_add_pd(a, b); }
+  static Vector sub(Vector a, Vector b) { return _mm512_sub_pd(a, b); }
+  static Vector mul(Vector a, Vector b) { return _mm512_mul_pd(a, b); }
+  static Vector max(Vector a, Vector b) { return _mm512_max_pd(a, b); }
+  static Vector sqrt(Vector a) { return _mm512_sqrt_pd(a); }
+  static Vector negate(Vector a)
+  {
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(INT64_MIN)));
+  }
+  static Vector roundNearest(Vector a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static Vector floor(Vector a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static Mask lessEqual(Vector a, Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+  static Mask equal(Vector a, Vector b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+  static Mask maskOr(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+  static Vector select(Mask mask, Vector ifTrue, Vector ifFalse) { return _mm512_mask_blend_pd(mask, ifFalse, ifTrue); }
+};
+
+} // namespace
+
+void fastHaversineAvx512(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                         double earthRadius, double* distances)
+{
+  haversineBatch<Avx512Lanes>(x0, y0, x1, y1, count, earthRadius, distances);
+}
@@ -0,0 +1,242 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_MATH_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_MATH_H_
+
+// Shared body of the fastHaversine kernels. Each kernel's translation unit is compiled for its own instruction set
+// and instantiates haversineBatch with a Lanes type that wraps that set's intrinsics:
+//
+//   Vector, Mask, WIDTH
+//   broadcast, load, store, add, sub, mul, max, sqrt, negate, roundNearest, floor, lessEqual, equal, maskOr, select
+//
+// The operations are written out in a fixed order and the kernels are built with -ffp-contract=off, so no kernel can
+// fuse a multiply-add another one doesn't - that is what keeps them bit-identical to each other.
+//
+// NOTE: Everything here has internal linkage. An inline function shared between translation units built with
+// different -m flags could have the linker keep the AVX-512 copy for every caller.
+
+#include <cstddef>
+
+#include "fast_haversine.h"
+
+void fastHaversineScalar(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                         double earthRadius, double* distances);
+void fastHaversineAvx2(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                       double earthRadius, double* distances);
+void fastHaversineAvx512(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                         double earthRadius, double* distances);
+
+namespace
+{
+
+// Same constant as RadiansFromDegrees
+constexpr double RADIANS_PER_DEGREE{0.01745329251994329577};
+
+// Cody-Waite reduction by pi/2: the first two parts have their low bits cleared, so k * part is exact for any
+// |k| < 2^20 (inputs up to about 1.6 million radians)
+constexpr double TWO_OVER_PI{6.36619772367581382433e-01};
+constexpr double PI_OVER_TWO_PART1{1.57079632673412561417e+00};
+constexpr double PI_OVER_TWO_PART2{6.07710050630396597660e-11};
+constexpr double PI_OVER_TWO_PART3{2.02226624871116645580e-21};
+
+// pi/2 split into its closest double and the remainder, for asin's pi/2 - 2 * asin(..) step
+constexpr double PI_OVER_TWO_HIGH{1.57079632679489655800e+00};
+constexpr double PI_OVER_TWO_LOW{6.12323399573676603587e-17};
+
+// Near-minimax polynomials, fitted by interpolating at Chebyshev nodes with 80 digit arithmetic and rounding the
+// coefficients to double. Max error measured over 4000 points of each range, with the evaluation order used below:
+//
+//   sin(r) = r + r * (r^2 * SIN(r^2))                        |r| <= pi/4      0.74 ulp
+//   cos(r) = 1 - (r^2 / 2 - r^2 * (r^2 * COS(r^2)))          |r| <= pi/4      0.95 ulp
+//   asin(s) = s + s * (z * ASIN(z)), z = s^2                  0 <= z <= 1/4    0.61 ulp
+//
+// End to end, over 10 million random pairs of the generator's range:
+//
+//   against ReferenceHaversine       70.7% identical, 99.8% within 4 ulp, max 487 ulp (1.8e-9km)
+//   against an 80 bit evaluation     94.7% within 2 ulp (reference: 96.0%), max 1412 ulp (5.1e-9km, same as reference)
+//
+// The large errors are all near antipodal pairs, where asin(sqrt(a)) magnifies the last bit of a - both versions
+// are equally far off there.
+constexpr double SIN_COEFFICIENTS[]{
+  -0.16666666666666666,
+  0.008333333333330948,
+  -0.00019841269836758574,
+  2.755731610255244e-06,
+  -2.5051131845003624e-08,
+  1.5918129294866608e-10,
+};
+
+constexpr double COS_COEFFICIENTS[]{
+  0.041666666666666664,
+  -0.0013888888888887398,
+  2.480158729876569e-05,
+  -2.7557317271729793e-07,
+  2.08761462684032e-09,
+  -1.1382632425521717e-11,
+};
+
+constexpr double ASIN_COEFFICIENTS[]{
+  0.16666666666666669,
+  0.07499999999998433,
+  0.04464285714635543,
+  0.030381944138531247,
+  0.02237217294214989,
+  0.017352392720869973,
+  0.013971212973552933,
+  0.011479177415184906,
+  0.01032281435018578,
+  0.005457506718640358,
+  0.01740087944269402,
+  -0.014851887071247204,
+  0.028757851367421566,
+};
+
+template<typename Lanes, size_t COUNT>
+inline typename Lanes::Vector polynomial(typename Lanes::Vector x, const double (&coefficients)[COUNT])
+{
+  typename Lanes::Vector result{Lanes::broadcast(coefficients[COUNT - 1u])};
+  for(size_t index{COUNT - 1u}; index-- > 0u;)
+  {
+    result = Lanes::add(Lanes::mul(result, x), Lanes::broadcast(coefficients[index]));
+  }
+  return result;
+}
+
+// x = k * pi/2 + r with |r| <= pi/4, quadrant = k mod 4 (as a double, 0 to 3)
+template<typename Lanes>
+inline typename Lanes::Vector reduceQuadrant(typename Lanes::Vector x, typename Lanes::Vector& quadrant)
+{
+  using Vector = typename Lanes::Vector;
+  const Vector k{Lanes::roundNearest(Lanes::mul(x, Lanes::broadcast(TWO_OVER_PI)))};
+  Vector r{Lanes::sub(x, Lanes::mul(k, Lanes::broadcast(PI_OVER_TWO_PART1)))};
+  r = Lanes::sub(r, Lanes::mul(k, Lanes::broadcast(PI_OVER_TWO_PART2)));
+  r = Lanes::sub(r, Lanes::mul(k, Lanes::broadcast(PI_OVER_TWO_PART3)));
+
+  const Vector four{Lanes::broadcast(4.0)};
+  quadrant = Lanes::sub(k, Lanes::mul(four, Lanes::floor(Lanes::mul(k, Lanes::broadcast(0.25)))));
+  return r;
+}
+
+template<typename Lanes>
+inline typename Lanes::Vector sinReduced(typename Lanes::Vector r)
+{
+  const typename Lanes::Vector r2{Lanes::mul(r, r)};
+  return Lanes::add(r, Lanes::mul(r, Lanes::mul(r2, polynomial<Lanes>(r2, SIN_COEFFICIENTS))));
+}
+
+template<typename Lanes>
+inline typename Lanes::Vector cosReduced(typename Lanes::Vector r)
+{
+  using Vector = typename Lanes::Vector;
+  const Vector r2{Lanes::mul(r, r)};
+  const Vector tail{Lanes::mul(r2, Lanes::mul(r2, polynomial<Lanes>(r2, COS_COEFFICIENTS)))};
+  return Lanes::sub(Lanes::broadcast(1.0), Lanes::sub(Lanes::mul(Lanes::broadcast(0.5), r2), tail));
+}
+
+// Only ever squared, so the sign of the quadrant doesn't matter
+template<typename Lanes>
+inline typename Lanes::Vector sinSquared(typename Lanes::Vector x)
+{
+  using Vector = typename Lanes::Vector;
+  Vector quadrant;
+  const Vector r{reduceQuadrant<Lanes>(x, quadrant)};
+  const auto odd{Lanes::maskOr(Lanes::equal(quadrant, Lanes::broadcast(1.0)),
+                               Lanes::equal(quadrant, Lanes::broadcast(3.0)))};
+  const Vector sine{Lanes::select(odd, cosReduced<Lanes>(r), sinReduced<Lanes>(r))};
+  return Lanes::mul(sine, sine);
+}
+
+// cos(k * pi/2 + r) is cos r, -sin r, -cos r, sin r for quadrants 0 to 3
+template<typename Lanes>
+inline typename Lanes::Vector cosine(typename Lanes::Vector x)
+{
+  using Vector = typename Lanes::Vector;
+  Vector quadrant;
+  const Vector r{reduceQuadrant<Lanes>(x, quadrant)};
+  const auto odd{Lanes::maskOr(Lanes::equal(quadrant, Lanes::broadcast(1.0)),
+                               Lanes::equal(quadrant, Lanes::broadcast(3.0)))};
+  const auto negative{Lanes::maskOr(Lanes::equal(quadrant, Lanes::broadcast(1.0)),
+                                    Lanes::equal(quadrant, Lanes::broadcast(2.0)))};
+  const Vector value{Lanes::select(odd, sinReduced<Lanes>(r), cosReduced<Lanes>(r))};
+  return Lanes::select(negative, Lanes::negate(value), value);
+}
+
+// asin(sqrt(a)) for 0 <= a <= 1. Above s = 1/2 it uses asin(s) = pi/2 - 2 * asin(sqrt((1 - s) / 2)), so the
+// polynomial only ever sees z <= 1/4.
+template<typename Lanes>
+inline typename Lanes::Vector asinSqrt(typename Lanes::Vector a)
+{
+  using Vector = typename Lanes::Vector;
+  const Vector half{Lanes::broadcast(0.5)};
+  const Vector s{Lanes::sqrt(a)};
+  const auto small{Lanes::lessEqual(s, half)};
+
+  // NOTE: Clamped because rounding can leave a a hair above 1
+  const Vector folded{Lanes::max(Lanes::mul(Lanes::sub(Lanes::broadcast(1.0), s), half), Lanes::broadcast(0.0))};
+  const Vector z{Lanes::select(small, a, folded)};
+  const Vector t{Lanes::select(small, s, Lanes::sqrt(folded))};
+  const Vector p{Lanes::add(t, Lanes::mul(t, Lanes::mul(z, polynomial<Lanes>(z, ASIN_COEFFICIENTS))))};
+
+  const Vector large{Lanes::sub(Lanes::broadcast(PI_OVER_TWO_HIGH),
+                                Lanes::sub(Lanes::add(p, p), Lanes::broadcast(PI_OVER_TWO_LOW)))};
+  return Lanes::select(small, p, large);
+}
+
+// The reference formula with the same operation order, see ReferenceHaversine
+template<typename Lanes>
+inline typename Lanes::Vector haversineLanes(typename Lanes::Vector x0, typename Lanes::Vector y0,
+                                             typename Lanes::Vector x1, typename Lanes::Vector y1,
+                                             typename Lanes::Vector earthRadius)
+{
+  using Vector = typename Lanes::Vector;
+  const Vector radians{Lanes::broadcast(RADIANS_PER_DEGREE)};
+  const Vector half{Lanes::broadcast(0.5)};
+
+  const Vector dLat{Lanes::mul(radians, Lanes::sub(y1, y0))};
+  const Vector dLon{Lanes::mul(radians, Lanes::sub(x1, x0))};
+  const Vector lat1{Lanes::mul(radians, y0)};
+  const Vector lat2{Lanes::mul(radians, y1)};
+
+  // NOTE: x * 0.5 is the same exact halving as the reference's x / 2.0
+  const Vector cosProduct{Lanes::mul(cosine<Lanes>(lat1), cosine<Lanes>(lat2))};
+  const Vector a{Lanes::add(sinSquared<Lanes>(Lanes::mul(dLat, half)),
+                            Lanes::mul(cosProduct, sinSquared<Lanes>(Lanes::mul(dLon, half))))};
+  const Vector c{Lanes::mul(Lanes::broadcast(2.0), asinSqrt<Lanes>(a))};
+  return Lanes::mul(earthRadius, c);
+}
+
+template<typename Lanes>
+inline void haversineBatch(const double* x0, const double* y0, const double* x1, const double* y1, size_t count,
+                           double earthRadius, double* distances)
+{
+  const typename Lanes::Vector radius{Lanes::broadcast(earthRadius)};
+  size_t index{0u};
+  for(; index + Lanes::WIDTH <= count; index += Lanes::WIDTH)
+  {
+    Lanes::store(distances + index, haversineLanes<Lanes>(Lanes::load(x0 + index), Lanes::load(y0 + index),
+                                                          Lanes::load(x1 + index), Lanes::load(y1 + index), radius));
+  }
+
+  // NOTE: The tail goes through one more full-width pass over zero padded copies, the padding lanes are discarded
+  if(index < count)
+  {
+    double tail[4u][Lanes::WIDTH]{};
+    double tailDistances[Lanes::WIDTH];
+    const size_t remaining{count - index};
+    for(size_t lane{0u}; lane < remaining; lane++)
+    {
+      tail[0][lane] = x0[index + lane];
+      tail[1][lane] = y0[index + lane];
+      tail[2][lane] = x1[index + lane];
+      tail[3][lane] = y1[index + lane];
+    }
+    Lanes::store(tailDistances, haversineLanes<Lanes>(Lanes::load(tail[0]), Lanes::load(tail[1]),
+                                                      Lanes::load(tail[2]), Lanes::load(tail[3]), radius));
+    for(size_t lane{0u}; lane < remaining; lane++)
+    {
+      distances[index + lane] = tailDistances[lane];
+    }
+  }
+}
+
+} // namespace
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_FAST_HAVERSINE_MATH_H_
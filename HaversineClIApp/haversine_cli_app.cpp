@@ -1,20 +1,346 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include "async_file_reader.h"
+#include "fast_haversine.h"
 #include "haversine_formula.cpp"
+#include "haversine_pair_file.h"
+#include "input_buffer_pool.h"
+#include "input_files.h"
+#include "json_document.h"
+#include "json_number.h"
 #include "json_parser.h"
+#include "machine_profile.h"
+#include "mapped_file.h"
+#include "parallel_haversine.h"
 #include "profiler.h"
 
-bool isCliArgsValid(int argc, char* argv[])
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment (lib, "psapi.lib")
+#else
+#include <glob.h>
+#include <sys/resource.h>
+#endif
+
+constexpr size_t DEFAULT_CHUNK_SIZE{1024u * 1024u};
+// NOTE: A chunk has to hold at least one whole record plus whatever was carried over from the previous one
+constexpr size_t MIN_CHUNK_SIZE{4096u};
+// Reads --io=uring keeps in flight unless --io-depth says otherwise
+constexpr size_t DEFAULT_IO_DEPTH{4u};
+// Distances computed per fastHaversine call, small enough to stay on the stack and in L1. A machine profile can pick
+// another block size, up to the MAX the stack array holds.
+constexpr size_t DISTANCE_BLOCK_SIZE{1024u};
+constexpr size_t MAX_DISTANCE_BLOCK_SIZE{4096u};
+constexpr double EARTH_RADIUS{6372.8};
+
+struct CliOptions
+{
+  std::string jsonFilePath;
+  std::string binFilePath;
+  bool forceTree{false};
+  bool useMmap{false};
+  MapOptions mapOptions;
+  bool stream{false};
+  size_t chunkSize{DEFAULT_CHUNK_SIZE};
+  bool asyncIo{false}; // stream through AsyncFileReader instead of blocking freads
+  size_t ioDepth{DEFAULT_IO_DEPTH};
+  bool parallel{false};
+  size_t threadCount{1u};
+  bool scaling{false};
+  bool fastKernel{false};
+  bool pairFile{false}; // the input is a binary .hvb pair file rather than JSON, told apart by its magic
+  std::string tracePath;
+  std::string profileOutPath; // anchor table for profile_diff, JSON when it ends in .json, binary otherwise
+  size_t traceEvents{DefaultProfileTraceCapacity};
+  std::string batchListPath; // run every pair of files the list names through one InputBufferPool
+  std::string machineProfilePath; // bench_cache_sweep --profile output the sizes below are picked from
+  size_t readBufferSize{DEFAULT_READ_BUFFER_SIZE};
+  size_t distanceBlockSize{DISTANCE_BLOCK_SIZE};
+};
+
+void printUsage(const char* program)
+{
+  std::cerr << "Usage: " << program << " <pairs_file> <answers_f64_file> [--tree] [--mmap [--populate] [--huge]]"
+            << " [--stream [--chunk-size=<bytes>] [--io=fread|uring [--io-depth=<count>]]]"
+            << " [--threads=<count> [--scaling]] [--kernel=reference|fast]"
+            << " [--trace=<file> [--trace-events=<count>]] [--profile-out=<file>] [--machine-profile=<file>]"
+            << std::endl;
+  std::cerr << "       " << program << " --batch=<list_file> [--tree] [--huge] [--kernel=reference|fast]"
+            << " [--trace=<file> [--trace-events=<count>]] [--profile-out=<file>] [--machine-profile=<file>]"
+            << std::endl;
+  std::cerr << "  <pairs_file>  the generator's coordinates.json, or its binary coordinates.hvb - recognised by content,"
+            << " used without parsing" << std::endl;
+  std::cerr << "  --tree      always build the generic JSONDocument instead of using the pairs fast path" << std::endl;
+  std::cerr << "  --mmap      map both files read-only instead of reading them into memory" << std::endl;
+  std::cerr << "  --populate  with --mmap, fault every page in while mapping" << std::endl;
+  std::cerr << "  --huge      with --mmap or --batch, ask for transparent huge pages" << std::endl;
+  std::cerr << "  --stream    parse the pairs in fixed-size chunks, memory use doesn't grow with the input" << std::endl;
+  std::cerr << "  --chunk-size=<bytes>  with --stream, the read size (default " << DEFAULT_CHUNK_SIZE << ", at least "
+            << MIN_CHUNK_SIZE << ")" << std::endl;
+  std::cerr << "  --io=uring  stream with reads queued ahead on io_uring (a read thread where it is unavailable), so"
+            << " reading overlaps parsing. Implies --stream" << std::endl;
+  std::cerr << "  --io-depth=<count>  with --io=uring, the chunk reads kept in flight (default " << DEFAULT_IO_DEPTH
+            << ")" << std::endl;
+  std::cerr << "  --threads=<count>  parse and sum the pairs on count threads, 0 uses every core" << std::endl;
+  std::cerr << "  --scaling   with --threads, also time every thread count from 1 up and print a scaling table"
+            << std::endl;
+  std::cerr << "  --kernel=reference|fast  libm ReferenceHaversine (default) or the vectorized fastHaversine" << std::endl;
+  std::cerr << "  --trace=<file>  also record every timed block and write them to file as Chrome trace JSON"
+            << " (chrome://tracing, ui.perfetto.dev)" << std::endl;
+  std::cerr << "  --trace-events=<count>  with --trace, the events kept per thread, older ones are dropped (default "
+            << DefaultProfileTraceCapacity << ")" << std::endl;
+  std::cerr << "  --profile-out=<file>  also save the profile's anchor table to file for profile_diff, as JSON when"
+            << " the name ends in .json, binary otherwise" << std::endl;
+  std::cerr << "  --batch=<list_file>  process many files back to back in buffers sized once for the largest. Each"
+            << " line of the list is <pairs_file> <answers_f64_file>, or a pairs file or glob alone: its answers are"
+            << " the .f64 of the same name if there is one, else distance_answers.f64 next to it" << std::endl;
+  std::cerr << "  --machine-profile=<file>  size the read buffer, the stream chunks and the distance blocks from the"
+            << " caches bench_cache_sweep --profile measured, instead of the defaults. --chunk-size still wins"
+            << std::endl;
+}
+
+// NOTE: A profile missing a level keeps that size's default, so a partial sweep (no L2 found, say) still loads
+bool applyMachineProfile(CliOptions& options, bool chunkSizeGiven)
+{
+  MachineProfile profile;
+  if(!readMachineProfile(options.machineProfilePath.c_str(), profile))
+  {
+    std::cerr << "Error: Could not read the machine profile " << options.machineProfilePath
+              << ", or a value in it is out of range" << std::endl;
+    return false;
+  }
+  options.readBufferSize = streamChunkSizeFor(profile, DEFAULT_READ_BUFFER_SIZE);
+  if(!chunkSizeGiven)
+  {
+    options.chunkSize = streamChunkSizeFor(profile, DEFAULT_CHUNK_SIZE);
+  }
+  options.distanceBlockSize = distanceBlockSizeFor(profile, DISTANCE_BLOCK_SIZE, MAX_DISTANCE_BLOCK_SIZE);
+  return true;
+}
+
+bool parseCliArgs(int argc, char* argv[], CliOptions& options)
 {
   TimeFunction;
-  if (argc != 3)
+  std::vector<std::string> positional;
+  bool traceEventsGiven{false};
+  bool ioDepthGiven{false};
+  bool chunkSizeGiven{false};
+  for(int argIndex{1}; argIndex < argc; argIndex++)
+  {
+    std::string arg = argv[argIndex];
+    if(arg == "--tree")
+    {
+      options.forceTree = true;
+    }
+    else if(arg == "--mmap")
+    {
+      options.useMmap = true;
+    }
+    else if(arg == "--populate")
+    {
+      options.mapOptions.populate = true;
+    }
+    else if(arg == "--huge")
+    {
+      options.mapOptions.hugePages = true;
+    }
+    else if(arg == "--stream")
+    {
+      options.stream = true;
+    }
+    else if(arg.rfind("--chunk-size=", 0) == 0)
+    {
+      const std::string value = arg.substr(std::string("--chunk-size=").size());
+      char* end{nullptr};
+      options.chunkSize = std::strtoull(value.c_str(), &end, 10);
+      if(value.empty() || *end != '\0' || options.chunkSize < MIN_CHUNK_SIZE)
+      {
+        std::cerr << "Error: --chunk-size must be a number of bytes, at least " << MIN_CHUNK_SIZE << std::endl;
+        return false;
+      }
+      chunkSizeGiven = true;
+    }
+    else if(arg == "--io=fread" || arg == "--io=uring")
+    {
+      options.asyncIo = (arg == "--io=uring");
+      options.stream = options.stream || options.asyncIo;
+    }
+    else if(arg.rfind("--io-depth=", 0) == 0)
+    {
+      const std::string value = arg.substr(std::string("--io-depth=").size());
+      char* end{nullptr};
+      options.ioDepth = std::strtoull(value.c_str(), &end, 10);
+      if(value.empty() || *end != '\0' || options.ioDepth == 0u)
+      {
+        std::cerr << "Error: --io-depth must be a positive read count" << std::endl;
+        return false;
+      }
+      ioDepthGiven = true;
+    }
+    else if(arg.rfind("--threads=", 0) == 0)
+    {
+      const std::string value = arg.substr(std::string("--threads=").size());
+      char* end{nullptr};
+      options.threadCount = std::strtoull(value.c_str(), &end, 10);
+      if(value.empty() || *end != '\0')
+      {
+        std::cerr << "Error: --threads must be a thread count" << std::endl;
+        return false;
+      }
+      options.parallel = true;
+    }
+    else if(arg.rfind("--trace=", 0) == 0)
+    {
+      options.tracePath = arg.substr(std::string("--trace=").size());
+      if(options.tracePath.empty())
+      {
+        std::cerr << "Error: --trace must be a file path" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--profile-out=", 0) == 0)
+    {
+      options.profileOutPath = arg.substr(std::string("--profile-out=").size());
+      if(options.profileOutPath.empty())
+      {
+        std::cerr << "Error: --profile-out must be a file path" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--trace-events=", 0) == 0)
+    {
+      const std::string value = arg.substr(std::string("--trace-events=").size());
+      char* end{nullptr};
+      options.traceEvents = std::strtoull(value.c_str(), &end, 10);
+      if(value.empty() || *end != '\0' || options.traceEvents == 0u)
+      {
+        std::cerr << "Error: --trace-events must be a positive event count" << std::endl;
+        return false;
+      }
+      traceEventsGiven = true;
+    }
+    else if(arg == "--scaling")
+    {
+      options.scaling = true;
+    }
+    else if(arg == "--kernel=reference" || arg == "--kernel=fast")
+    {
+      options.fastKernel = (arg == "--kernel=fast");
+    }
+    else if(arg.rfind("--machine-profile=", 0) == 0)
+    {
+      options.machineProfilePath = arg.substr(std::string("--machine-profile=").size());
+      if(options.machineProfilePath.empty())
+      {
+        std::cerr << "Error: --machine-profile must be a profile file path" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--batch=", 0) == 0)
+    {
+      options.batchListPath = arg.substr(std::string("--batch=").size());
+      if(options.batchListPath.empty())
+      {
+        std::cerr << "Error: --batch must be a list file path" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--", 0) == 0)
+    {
+      std::cerr << "Error: Unknown option " << arg << std::endl;
+      printUsage(argv[0]);
+      return false;
+    }
+    else
+    {
+      positional.push_back(arg);
+    }
+  }
+
+  if(!options.machineProfilePath.empty() && !applyMachineProfile(options, chunkSizeGiven))
+  {
+    return false;
+  }
+
+  if(!options.batchListPath.empty())
+  {
+    if(!positional.empty())
+    {
+      printUsage(argv[0]);
+      return false;
+    }
+    if(options.useMmap || options.mapOptions.populate || options.stream || options.parallel)
+    {
+      std::cerr << "Error: --batch can't be combined with --mmap, --populate, --stream, --io or --threads" << std::endl;
+      return false;
+    }
+    if(traceEventsGiven && options.tracePath.empty())
+    {
+      std::cerr << "Error: --trace-events only applies with --trace" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  if (positional.size() != 2)
+  {
+    printUsage(argv[0]);
+    return false;
+  }
+
+  if(!options.useMmap && (options.mapOptions.populate || options.mapOptions.hugePages))
+  {
+    std::cerr << "Error: --populate only applies with --mmap, --huge with --mmap or --batch" << std::endl;
+    return false;
+  }
+
+  if(options.stream && (options.useMmap || options.forceTree))
+  {
+    std::cerr << "Error: --stream can't be combined with --mmap or --tree" << std::endl;
+    return false;
+  }
+
+  if(options.parallel && (options.stream || options.forceTree))
+  {
+    std::cerr << "Error: --threads can't be combined with --stream or --tree" << std::endl;
+    return false;
+  }
+
+  if(ioDepthGiven && !options.asyncIo)
   {
-    std::cerr << "Usage: " << argv[0] << " <pairs_json_file> <answers_f64_file>" << std::endl;
+    std::cerr << "Error: --io-depth only applies with --io=uring" << std::endl;
     return false;
   }
 
-  std::string jsonFilePath = argv[1];
-  std::string binFilePath = argv[2];
+  if(traceEventsGiven && options.tracePath.empty())
+  {
+    std::cerr << "Error: --trace-events only applies with --trace" << std::endl;
+    return false;
+  }
+
+  if(options.scaling && !options.parallel)
+  {
+    std::cerr << "Error: --scaling only applies with --threads" << std::endl;
+    return false;
+  }
+
+  if(options.parallel && options.threadCount == 0u)
+  {
+    // NOTE: hardware_concurrency may not know, one thread is always right
+    options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  options.jsonFilePath = positional[0];
+  options.binFilePath = positional[1];
+  const std::string& jsonFilePath = options.jsonFilePath;
+  const std::string& binFilePath = options.binFilePath;
 
   if (binFilePath.substr(binFilePath.find_last_of(".") + 1) != "f64")
   {
@@ -23,13 +349,22 @@ bool isCliArgsValid(int argc, char* argv[])
   }
 
   // Check if the files exist
-  std::ifstream jsonFile(jsonFilePath);
+  std::ifstream jsonFile(jsonFilePath, std::ios::binary);
   if (!jsonFile)
   {
     std::cerr << "Error: The file " << jsonFilePath << " does not exist" << std::endl;
     return false;
   }
 
+  char magic[sizeof(HAVERSINE_PAIR_FILE_MAGIC)]{};
+  jsonFile.read(magic, sizeof(magic));
+  options.pairFile = isHaversinePairFile(magic, static_cast<size_t>(jsonFile.gcount()));
+  if(options.pairFile && (options.stream || options.forceTree || options.parallel))
+  {
+    std::cerr << "Error: --stream, --tree and --threads only apply to JSON input" << std::endl;
+    return false;
+  }
+
   std::ifstream binFile(binFilePath, std::ios::binary);
   if (!binFile)
   {
@@ -40,113 +375,843 @@ bool isCliArgsValid(int argc, char* argv[])
   return true;
 }
 
-//C++ style file reading
-std::string readJsonFile(const std::string& jsonFilePath)
+// Maps the file, then faults its pages in under their own anchor, so neither the mapping nor the parse that follows
+// is charged for the page faults. With --populate the faults happen while mapping instead.
+MappedFile mapInputFile(const std::string& filePath, const MapOptions& mapOptions)
 {
-  const size_t buffer_size = 256  * 1024;
-  std::ifstream jsonFile(jsonFilePath, std::ios::in | std::ios::binary | std::ios::ate);
-  if (!jsonFile)
+  MappedFile mapping;
   {
-    throw std::runtime_error("Could not open file");
+    TimeBlock("mapInputFile");
+    mapping = MappedFile(filePath, mapOptions);
   }
 
-  std::streamsize fileSize = jsonFile.tellg();
-  jsonFile.seekg(0, std::ios::beg);
-  std::string fileContent(fileSize, '\0');
+  TimeBandwidth("touchPages", mapping.size());
+  volatile size_t touched = mapping.touchPages();
+  (void)touched;
+  return mapping;
+}
+
+size_t peakMemoryBytes()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_maxrss) * 1024u;
+#endif
+}
+
+size_t pageFaultCount()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PageFaultCount;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_minflt + usage.ru_majflt);
+#endif
+}
 
-  std::vector<char> buffer(buffer_size);
-  jsonFile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+struct HaversineTotals
+{
+  double sum{0.0};
+  double referenceSum{0.0};
+  double maxError{0.0};
+  size_t pairCount{0u};
+};
 
-  TimeBandwidth(__func__, fileSize);
-  if (!jsonFile.read(&fileContent[0], fileSize)) {
-    std::cerr << "Failed to read the entire file!" << std::endl;
-    return "";
+void computeDistances(const HaversinePairsView& pairs, size_t first, size_t count, bool fastKernel, double* distances)
+{
+  if(fastKernel)
+  {
+    fastHaversine(pairs.x0 + first, pairs.y0 + first, pairs.x1 + first, pairs.y1 + first, count, EARTH_RADIUS,
+                  distances);
+    return;
   }
+  for(size_t pairIndex{first}; pairIndex < first + count; pairIndex++)
+  {
+    distances[pairIndex - first] = ReferenceHaversine(pairs.x0[pairIndex], pairs.y0[pairIndex],
+                                                      pairs.x1[pairIndex], pairs.y1[pairIndex], EARTH_RADIUS);
+  }
+}
 
-  return fileContent;
+// NOTE: Both sums are scaled by the total pair count as they go, so it has to be known up front - streaming takes it
+// from the answers file size.
+void sumHaversine(const HaversinePairsView& pairs, const double* answers, double sumCoefficient,
+                  const CliOptions& options, HaversineTotals& totals)
+{
+  TimeBandwidth(__func__, pairs.byteCount());
+  const bool fastKernel{options.fastKernel};
+  const size_t blockSize{options.distanceBlockSize};
+  double distances[MAX_DISTANCE_BLOCK_SIZE];
+  for(size_t first{0u}; first < pairs.size(); first += blockSize)
+  {
+    const size_t count{std::min(blockSize, pairs.size() - first)};
+    // NOTE: One event per block in a trace, so slow blocks stand out
+    TimeBandwidth("distanceBlock", 4u * count * sizeof(double));
+    computeDistances(pairs, first, count, fastKernel, distances);
+    for(size_t index{0u}; index < count; index++)
+    {
+      totals.sum+=distances[index]*sumCoefficient;
+      totals.referenceSum+=answers[first + index]*sumCoefficient;
+      totals.maxError = std::max(totals.maxError, std::fabs(distances[index] - answers[first + index]));
+    }
+  }
+  totals.pairCount += pairs.size();
 }
 
-//C style file reading
-std::vector<double> readBinFile(const std::string &binFilePath, size_t numberOfPairs)
+// Times both kernels over the same pairs, for the speedup the validation output reports
+double fastKernelSpeedup(const HaversinePairsView& pairs)
 {
-  FILE *file = fopen(binFilePath.c_str(), "rb");
-  if (!file) {
-    throw std::runtime_error("Failed to open file");
+  TimeFunction;
+  std::vector<double> distances(pairs.size());
+  double seconds[2]{};
+  {
+    TimeBandwidth("referenceKernel", pairs.byteCount());
+    const auto start = std::chrono::steady_clock::now();
+    computeDistances(pairs, 0u, pairs.size(), false, distances.data());
+    seconds[0] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  {
+    TimeBandwidth("fastKernel", pairs.byteCount());
+    const auto start = std::chrono::steady_clock::now();
+    computeDistances(pairs, 0u, pairs.size(), true, distances.data());
+    seconds[1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
   }
+  return seconds[1] > 0.0 ? seconds[0] / seconds[1] : 0.0;
+}
 
-  std::vector<double> data;
-  fseek(file, 0, SEEK_END);
-  long fileSize = ftell(file);
-  fseek(file, 0, SEEK_SET);
+size_t readChunk(FILE* file, char* destination, size_t size)
+{
+  TimeBandwidth(__func__, size);
+  return fread(destination, 1, size, file);
+}
 
-  size_t numElements = fileSize / sizeof(double);
-  data.resize(numElements);
+// What a stream needs from one chunk to the next: the parser's place in the document and the answers read so far
+struct PairStream
+{
+  JSONPairsStreamParser parser;
+  HaversinePairs batch;
+  std::vector<double> answers;
+  std::unique_ptr<FILE, int(*)(FILE*)> answersFile{nullptr, fclose};
+  size_t answerCount{0u};
+  double sumCoefficient{0.0};
+};
 
-  TimeBandwidth(__func__, fileSize);
-  if (fread(data.data(), sizeof(double), numElements, file) != numElements)
+bool openPairStream(const CliOptions& options, PairStream& stream)
+{
+  stream.answersFile.reset(fopen(options.binFilePath.c_str(), "rb"));
+  if(!stream.answersFile)
   {
-    fclose(file);
-    throw std::runtime_error("Failed to read file");
+    std::cerr << "Error: Could not open " << options.binFilePath << std::endl;
+    return false;
   }
 
-  fclose(file);
-  return data;
+  fseek(stream.answersFile.get(), 0, SEEK_END);
+  stream.answerCount = static_cast<size_t>(ftell(stream.answersFile.get())) / sizeof(double);
+  fseek(stream.answersFile.get(), 0, SEEK_SET);
+  stream.sumCoefficient = 1.0 / static_cast<double>(stream.answerCount);
+  return true;
 }
 
+// Parses the complete records at the front of text and sums their pairs against the answers that go with them.
+// consumed is how much of text they took. Returns false, after saying why, when the input is not a pairs file or
+// the pairs and answers don't match up.
+bool sumStreamChunk(const CliOptions& options, PairStream& stream, std::string_view text, bool isFinal,
+                    HaversineTotals& totals, size_t& consumed, bool& done)
+{
+  stream.batch.clear();
+  consumed = 0u;
+  JSONPairsStreamParser::Status status;
+  {
+    TimeBandwidth("parseChunk", text.size());
+    status = stream.parser.parse(text, isFinal, stream.batch, consumed);
+  }
+  if(status == JSONPairsStreamParser::Status::INVALID)
+  {
+    std::cerr << "Error: " << options.jsonFilePath << " is not a valid pairs file" << std::endl;
+    return false;
+  }
 
-int main(int argc, char* argv[])
+  stream.answers.resize(stream.batch.size());
+  {
+    TimeBandwidth("readAnswers", stream.answers.size() * sizeof(double));
+    if(totals.pairCount + stream.batch.size() > stream.answerCount ||
+       fread(stream.answers.data(), sizeof(double), stream.answers.size(), stream.answersFile.get()) !=
+           stream.answers.size())
+    {
+      std::cerr << "Error: The number of pairs does not match the number of answers" << std::endl;
+      return false;
+    }
+  }
+  sumHaversine(stream.batch, stream.answers.data(), stream.sumCoefficient, options, totals);
+
+  done = (status == JSONPairsStreamParser::Status::DONE);
+  return true;
+}
+
+bool finishPairStream(const PairStream& stream, const HaversineTotals& totals)
 {
-  BeginProfile();
-  if (!isCliArgsValid(argc, argv))
+  if(totals.pairCount != stream.answerCount)
   {
-    return 1;
+    std::cerr << "Error: The number of pairs does not match the number of answers" << std::endl;
+    return false;
   }
+  return true;
+}
 
-  std::string jsonFilePath = argv[1];
-  std::string binFilePath = argv[2];
-  std::string jsonString;
+// Reads the JSON a chunk at a time and sums each chunk's pairs as soon as they are parsed, against answers read in
+// step with them. The tail of a chunk that holds an incomplete record is carried over to the front of the buffer.
+// Memory use is the chunk buffer plus one chunk's worth of pairs and answers, whatever the input size.
+bool streamPairs(const CliOptions& options, HaversineTotals& totals, size_t& inputSize)
+{
+  TimeFunction;
+  std::unique_ptr<FILE, int(*)(FILE*)> jsonFile(fopen(options.jsonFilePath.c_str(), "rb"), fclose);
+  PairStream stream;
+  if(!jsonFile)
+  {
+    std::cerr << "Error: Could not open " << options.jsonFilePath << std::endl;
+    return false;
+  }
+  if(!openPairStream(options, stream))
+  {
+    return false;
+  }
+
+  std::vector<char> buffer(options.chunkSize);
+  size_t carried{0u};
+
+  for(;;)
+  {
+    const size_t bytesRead{readChunk(jsonFile.get(), buffer.data() + carried, buffer.size() - carried)};
+    if(ferror(jsonFile.get()))
+    {
+      std::cerr << "Error: Failed to read " << options.jsonFilePath << std::endl;
+      return false;
+    }
+    inputSize += bytesRead;
+
+    // NOTE: A short read means end of file, an exactly full one finds out on the next (empty) read
+    const size_t available{carried + bytesRead};
+    const bool isFinal{bytesRead < buffer.size() - carried};
+
+    size_t consumed{0u};
+    bool done{false};
+    if(!sumStreamChunk(options, stream, std::string_view(buffer.data(), available), isFinal, totals, consumed, done))
+    {
+      return false;
+    }
+    if(done)
+    {
+      break;
+    }
+
+    carried = available - consumed;
+    if(carried == buffer.size())
+    {
+      std::cerr << "Error: A record does not fit in a " << buffer.size() << " byte chunk" << std::endl;
+      return false;
+    }
+    std::memmove(buffer.data(), buffer.data() + consumed, carried);
+  }
+
+  return finishPairStream(stream, totals);
+}
+
+struct AsyncIoReport
+{
+  AsyncReadBackend backend{AsyncReadBackend::READ_THREAD};
+  double seconds{0.0};     // the whole stream, reading, parsing and summing
+  double waitSeconds{0.0}; // parsing stalled on reads
+  double readSeconds{0.0};
+};
+
+// streamPairs with the reads queued ahead: while one chunk is parsed the next ioDepth - 1 are being read. A chunk's
+// unparsed tail is copied into the headroom in front of the next chunk, so only the tail moves, never the chunk.
+bool streamPairsAsync(const CliOptions& options, HaversineTotals& totals, size_t& inputSize, AsyncIoReport& report)
+{
+  TimeFunction;
+  PairStream stream;
+  if(!openPairStream(options, stream))
+  {
+    return false;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  // NOTE: A tail is less than one record, and a record has to fit in a chunk
+  const size_t headroom{options.chunkSize};
+  std::unique_ptr<AsyncFileReader> reader;
+  try
+  {
+    reader = std::make_unique<AsyncFileReader>(options.jsonFilePath, options.chunkSize, options.ioDepth, headroom);
+  }
+  catch(const std::exception&)
+  {
+    std::cerr << "Error: Could not open " << options.jsonFilePath << std::endl;
+    return false;
+  }
+
+  std::vector<char> tail;
+  bool done{false};
+  try
+  {
+    AsyncFileReader::Block block;
+    bool more{reader->next(block)};
+    while(!done)
+    {
+      // NOTE: The stream parser needs an empty final call to finish a document that ends exactly on a chunk border
+      const bool isFinal{!more || block.offset + block.size == reader->fileSize()};
+      char* text{more ? block.data - tail.size() : tail.data()};
+      const size_t available{tail.size() + (more ? block.size : 0u)};
+      if(more)
+      {
+        std::memcpy(text, tail.data(), tail.size());
+        inputSize += block.size;
+      }
+
+      size_t consumed{0u};
+      if(!sumStreamChunk(options, stream, std::string_view(text, available), isFinal, totals, consumed, done))
+      {
+        return false;
+      }
+      if(done || !more)
+      {
+        break;
+      }
+
+      if(available - consumed > headroom)
+      {
+        std::cerr << "Error: A record does not fit in a " << options.chunkSize << " byte chunk" << std::endl;
+        return false;
+      }
+      tail.assign(text + consumed, text + available);
+      reader->release();
+      more = reader->next(block);
+    }
+  }
+  catch(const std::runtime_error& error)
+  {
+    std::cerr << "Error: Failed to read " << options.jsonFilePath << " (" << error.what() << ")" << std::endl;
+    return false;
+  }
+  if(!done)
+  {
+    std::cerr << "Error: " << options.jsonFilePath << " is not a valid pairs file" << std::endl;
+    return false;
+  }
+
+  report.backend = reader->backend();
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  report.waitSeconds = reader->waitSeconds();
+  report.readSeconds = reader->readSeconds();
+  return finishPairStream(stream, totals);
+}
+
+// Parallel version of parsePairs + sumHaversine. The reference sum only reads the answers so it stays on this thread.
+bool sumParallel(std::string_view json, const double* answers, size_t answerCount, const CliOptions& options,
+                 HaversineTotals& totals, ParallelHaversineResult& result)
+{
+  const double sumCoefficient{1.0 / static_cast<double>(answerCount)};
+  {
+    TimeBandwidth("sumHaversineParallel", json.size());
+    result = sumHaversineParallel(json, options.threadCount, sumCoefficient, options.fastKernel);
+  }
+  if(!result.valid)
+  {
+    std::cerr << "Error: --threads needs a pairs file, the input is not one" << std::endl;
+    return false;
+  }
+  if(result.pairCount != answerCount)
+  {
+    std::cerr << "Error: The number of pairs does not match the number of answers" << std::endl;
+    return false;
+  }
+
+  totals.sum = result.sum;
+  totals.pairCount = result.pairCount;
+  TimeBandwidth("sumReference", answerCount * sizeof(double));
+  for(size_t answerIndex{0u}; answerIndex < answerCount; answerIndex++)
+  {
+    totals.referenceSum += answers[answerIndex] * sumCoefficient;
+  }
+  return true;
+}
+
+void printThreadReports(const ParallelHaversineResult& result)
+{
+  const double gigabyte{1024.0 * 1024.0 * 1024.0};
+  fprintf(stdout, "Threads: %llu (%.3fms)\n", result.threads.size(), result.seconds * 1000.0);
+  for(size_t threadIndex{0u}; threadIndex < result.threads.size(); threadIndex++)
+  {
+    const HaversineThreadReport& report{result.threads[threadIndex]};
+    const double bandwidth{report.seconds > 0.0 ? static_cast<double>(report.byteCount) / gigabyte / report.seconds
+                                                : 0.0};
+    fprintf(stdout, "  Thread %llu: %llu pairs, %llu bytes in %.3fms (%.3fgb/s)\n", threadIndex, report.pairCount,
+            report.byteCount, report.seconds * 1000.0, bandwidth);
+  }
+}
+
+// Reruns the parallel sum for every thread count up to maxThreads. The sums differ from each other in the last bits,
+// the ranges are added up in a different grouping for each count.
+void printScalingTable(std::string_view json, size_t answerCount, size_t maxThreads, bool fastKernel)
+{
+  TimeFunction;
+  const double gigabyte{1024.0 * 1024.0 * 1024.0};
+  const double sumCoefficient{1.0 / static_cast<double>(answerCount)};
+  double baseSeconds{0.0};
+
+  fprintf(stdout, "\nScaling (%llu cores reported):\n", static_cast<size_t>(std::thread::hardware_concurrency()));
+  fprintf(stdout, "%8s %12s %10s %9s\n", "threads", "ms", "gb/s", "speedup");
+  for(size_t threadCount{1u}; threadCount <= maxThreads; threadCount++)
+  {
+    const ParallelHaversineResult result{sumHaversineParallel(json, threadCount, sumCoefficient, fastKernel)};
+    if(threadCount == 1u)
+    {
+      baseSeconds = result.seconds;
+    }
+    fprintf(stdout, "%8llu %12.3f %10.3f %8.2fx\n", threadCount, result.seconds * 1000.0,
+            static_cast<double>(json.size()) / gigabyte / result.seconds, baseSeconds / result.seconds);
+  }
+}
+
+struct BatchEntry
+{
+  std::string pairsPath;
+  std::string answersPath;
+  size_t pairsSize{0u};
+  size_t answersSize{0u};
+};
+
+bool fileSize(const std::string& path, size_t& size)
+{
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if(!file)
+  {
+    return false;
+  }
+  size = static_cast<size_t>(file.tellg());
+  return true;
+}
 
-  jsonString = readJsonFile(jsonFilePath);
+// The generator writes distance_answers.f64 next to its pairs files, renamed runs keep name.json with name.f64
+std::string answersPathFor(const std::string& pairsPath)
+{
+  const size_t nameStart{pairsPath.find_last_of("/\\") + 1u};
+  const size_t extension{pairsPath.find_last_of('.')};
+  if(extension != std::string::npos && extension > nameStart)
+  {
+    const std::string sameName{pairsPath.substr(0u, extension) + ".f64"};
+    if(std::ifstream(sameName, std::ios::binary))
+    {
+      return sameName;
+    }
+  }
+  return pairsPath.substr(0u, nameStart) + "distance_answers.f64";
+}
 
-  auto json = JSONParser::parse(jsonString);
+std::vector<std::string> expandGlob(const std::string& pattern)
+{
+#ifdef _WIN32
+  // NOTE: No glob on Windows, the name is taken as it is
+  return {pattern};
+#else
+  std::vector<std::string> paths;
+  glob_t matches{};
+  if(glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+  {
+    paths.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+  }
+  globfree(&matches);
+  return paths;
+#endif
+}
 
-  auto pairs = json["pairs"].getArray();
+// Reads the batch list and checks every file it names exists. Blank lines and lines starting with # are skipped.
+bool readBatchList(const std::string& listPath, std::vector<BatchEntry>& entries)
+{
+  std::ifstream list(listPath);
+  if(!list)
+  {
+    std::cerr << "Error: The file " << listPath << " does not exist" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(list, line))
+  {
+    std::istringstream fields(line);
+    std::string pairsPath;
+    std::string answersPath;
+    if(!(fields >> pairsPath) || pairsPath[0] == '#')
+    {
+      continue;
+    }
+    fields >> answersPath;
 
-  auto answers = readBinFile(binFilePath, pairs.size());
+    const std::vector<std::string> pairsPaths{answersPath.empty() ? expandGlob(pairsPath)
+                                                                  : std::vector<std::string>{pairsPath}};
+    if(pairsPaths.empty())
+    {
+      std::cerr << "Error: Nothing matches " << pairsPath << std::endl;
+      return false;
+    }
+    for(const std::string& path : pairsPaths)
+    {
+      BatchEntry entry;
+      entry.pairsPath = path;
+      entry.answersPath = answersPath.empty() ? answersPathFor(path) : answersPath;
+      for(const auto& [filePath, size] : {std::pair{&entry.pairsPath, &entry.pairsSize},
+                                          std::pair{&entry.answersPath, &entry.answersSize}})
+      {
+        if(!fileSize(*filePath, *size))
+        {
+          std::cerr << "Error: The file " << *filePath << " does not exist" << std::endl;
+          return false;
+        }
+      }
+      entries.push_back(entry);
+    }
+  }
+
+  if(entries.empty())
+  {
+    std::cerr << "Error: " << listPath << " lists no files" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Reads, parses and sums one file of a batch into the pool. Returns false, after saying why, when it can't.
+bool sumBatchEntry(const BatchEntry& entry, const CliOptions& options, InputBufferPool& pool, HaversineTotals& totals)
+{
+  TimeFunction;
+  std::string_view input;
+  const double* answers{nullptr};
+  size_t answerCount{0u};
+  try
+  {
+    input = pool.readInput(entry.pairsPath);
+    answers = pool.readAnswers(entry.answersPath, answerCount);
+  }
+  catch(const std::runtime_error& error)
+  {
+    std::cerr << "Error: " << error.what() << std::endl;
+    return false;
+  }
+
+  HaversinePairsView pairsView;
+  if(!pairsFromBatchInput(input, options.forceTree, pool.pairs(), pairsView))
+  {
+    return false;
+  }
 
-  if(answers.size()!= pairs.size())
+  if(answerCount != pairsView.size())
   {
     std::cerr << "Error: The number of pairs does not match the number of answers" << std::endl;
+    return false;
+  }
+  sumHaversine(pairsView, answers, 1.0 / static_cast<double>(answerCount), options, totals);
+  return true;
+}
+
+// Runs every file of the batch through one pool sized for the largest of them, so only the first file pays for
+// allocating and faulting in the buffers. Prints a line per file and the totals. Returns false when any file failed,
+// the rest are still processed.
+bool runBatch(const CliOptions& options)
+{
+  TimeFunction;
+  std::vector<BatchEntry> entries;
+  if(!readBatchList(options.batchListPath, entries))
+  {
+    return false;
+  }
+
+  const double gigabyte{1024.0 * 1024.0 * 1024.0};
+  const double megabyte{1024.0 * 1024.0};
+  BufferPoolOptions poolOptions;
+  poolOptions.hugePages = options.mapOptions.hugePages;
+  InputBufferPool pool(poolOptions);
+
+  size_t largestPairs{0u};
+  size_t largestAnswers{0u};
+  for(const BatchEntry& entry : entries)
+  {
+    largestPairs = std::max(largestPairs, entry.pairsSize);
+    largestAnswers = std::max(largestAnswers, entry.answersSize);
+  }
+  const size_t faultsBeforeReserve{pageFaultCount()};
+  const auto reserveStart = std::chrono::steady_clock::now();
+  try
+  {
+    pool.reserve(largestPairs, largestAnswers);
+  }
+  catch(const std::runtime_error& error)
+  {
+    std::cerr << "Error: " << error.what() << std::endl;
+    return false;
+  }
+  const double reserveSeconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - reserveStart).count()};
+
+  fprintf(stdout, "Batch: %llu files, buffers of %.3fmb and %.3fmb%s, faulted in in %.3fms (%llu page faults)\n",
+          entries.size(), static_cast<double>(largestPairs) / megabyte, static_cast<double>(largestAnswers) / megabyte,
+          poolOptions.hugePages ? " with huge pages" : "", reserveSeconds * 1000.0,
+          pageFaultCount() - faultsBeforeReserve);
+
+  size_t failedCount{0u};
+  size_t totalBytes{0u};
+  size_t totalPairs{0u};
+  size_t totalFaults{0u};
+  double totalSeconds{0.0};
+  for(const BatchEntry& entry : entries)
+  {
+    HaversineTotals totals;
+    const size_t faultsBefore{pageFaultCount()};
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok{sumBatchEntry(entry, options, pool, totals)};
+    const double seconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    const size_t faults{pageFaultCount() - faultsBefore};
+
+    totalSeconds += seconds;
+    totalFaults += faults;
+    if(!ok)
+    {
+      failedCount++;
+      fprintf(stdout, "  %s: failed\n", entry.pairsPath.c_str());
+      continue;
+    }
+    totalBytes += entry.pairsSize;
+    totalPairs += totals.pairCount;
+    fprintf(stdout, "  %s: %llu pairs, %llu bytes in %.3fms (%.3fgb/s), %llu page faults, difference %s\n",
+            entry.pairsPath.c_str(), totals.pairCount, entry.pairsSize, seconds * 1000.0,
+            static_cast<double>(entry.pairsSize) / gigabyte / seconds, faults,
+            FixedDouble(totals.sum - totals.referenceSum, 16).text);
+  }
+
+  fprintf(stdout, "Total: %llu pairs, %llu bytes in %.3fms (%.3fgb/s), %llu page faults, %llu of %llu files failed\n",
+          totalPairs, totalBytes, totalSeconds * 1000.0,
+          totalSeconds > 0.0 ? static_cast<double>(totalBytes) / gigabyte / totalSeconds : 0.0, totalFaults,
+          failedCount, entries.size());
+  fprintf(stdout, "Pool: %.3fmb in %llu allocations\n", static_cast<double>(pool.capacityBytes()) / megabyte,
+          pool.allocationCount());
+  fprintf(stdout, "Peak memory: %.3fmb\n", static_cast<double>(peakMemoryBytes()) / megabyte);
+  return failedCount == 0u;
+}
+
+int main(int argc, char* argv[])
+{
+  BeginProfile();
+  CliOptions options;
+  if (!parseCliArgs(argc, argv, options))
+  {
     return 1;
   }
+  if(!options.tracePath.empty() && !BeginProfileTrace(options.tracePath.c_str(), options.traceEvents))
+  {
+    std::cerr << "Error: Could not create the trace file " << options.tracePath << std::endl;
+    return 1;
+  }
+  if(!options.profileOutPath.empty())
+  {
+    const std::string& path{options.profileOutPath};
+    const bool json{path.size() >= 5u && path.compare(path.size() - 5u, 5u, ".json") == 0};
+    if(!BeginProfileExport(path.c_str(), json))
+    {
+      std::cerr << "Error: Could not create the profile file " << path << std::endl;
+      return 1;
+    }
+  }
+  if(!options.machineProfilePath.empty())
+  {
+    fprintf(stdout, "Machine profile: %s (read buffer %llu, stream chunks %llu, distance blocks of %llu pairs)\n",
+            options.machineProfilePath.c_str(), options.readBufferSize, options.chunkSize, options.distanceBlockSize);
+  }
+  if(!options.batchListPath.empty())
+  {
+    const bool batchOk{runBatch(options)};
+    EndAndPrintProfile();
+    return batchOk ? 0 : 1;
+  }
 
-  size_t answersIter{0u};
-  double sum{0.0};
-  double referenceSum{0.0};
-  double sumCoefficient{1.0/static_cast<double>(answers.size())};
-  for(const auto& pair : pairs)
+  HaversineTotals totals;
+  size_t inputSize{0u};
+  size_t pairBytes{0u};
+  size_t documentBytes{0u};
+  bool usedFastPath{false};
+  PairLayout pairFileLayout{PairLayout::SOA};
+  ParallelHaversineResult parallelResult;
+  AsyncIoReport ioReport;
+  double speedup{0.0};
+  std::string jsonString;
+  MappedFile jsonMapping;
+  std::string_view json;
+
+  if(options.stream)
+  {
+    if(options.asyncIo ? !streamPairsAsync(options, totals, inputSize, ioReport) :
+                         !streamPairs(options, totals, inputSize))
+    {
+      return 1;
+    }
+  }
+  else
   {
-    auto x0 = pair["x0"].get<double>();
-    auto y0 = pair["y0"].get<double>();
-    auto x1 = pair["x1"].get<double>();
-    auto y1 = pair["y1"].get<double>();
+    // NOTE: The input is either owned by jsonString or mapped, the parser and the answer check only see views. The
+    // JSON ones are declared above, the scaling table reruns on it after the results are printed.
+    std::vector<double> answersVector;
+    MappedFile answersMapping;
 
-    double distance = ReferenceHaversine(x0, y0, x1, y1, 6372.8);
-    sum+=distance*sumCoefficient;
-    referenceSum+=answers[answersIter]*sumCoefficient;
-    answersIter++;
+    if(options.useMmap)
+    {
+      jsonMapping = mapInputFile(options.jsonFilePath, options.mapOptions);
+      json = jsonMapping.view();
+    }
+    else
+    {
+      jsonString = readJsonFile(options.jsonFilePath, options.readBufferSize);
+      json = jsonString;
+    }
+    inputSize = json.size();
+
+    // NOTE: The answers come first, the parallel path scales each distance by 1/count while summing
+    const double* answers{nullptr};
+    size_t answerCount{0u};
+    if(options.useMmap)
+    {
+      answersMapping = mapInputFile(options.binFilePath, options.mapOptions);
+      answers = reinterpret_cast<const double*>(answersMapping.data());
+      answerCount = answersMapping.size() / sizeof(double);
+    }
+    else
+    {
+      answersVector = readBinFile(options.binFilePath);
+      answers = answersVector.data();
+      answerCount = answersVector.size();
+    }
+
+    if(options.parallel)
+    {
+      if(!sumParallel(json, answers, answerCount, options, totals, parallelResult))
+      {
+        return 1;
+      }
+    }
+    else
+    {
+      // NOTE: Pairs from a pair file may point into the input, the view is what the sums read
+      HaversinePairs pairs;
+      HaversinePairsView pairsView;
+      if(options.pairFile)
+      {
+        if(!pairsFromPairFile(json, pairs, pairsView, pairFileLayout))
+        {
+          return 1;
+        }
+      }
+      else
+      {
+        TimeBandwidth("parseJson", json.size());
+        usedFastPath = !options.forceTree && JSONParser::parsePairs(json, pairs);
+        if(!usedFastPath)
+        {
+          documentBytes = pairsFromDocument(json, pairs);
+        }
+        pairsView = pairs;
+      }
+      pairBytes = pairs.byteCount();
+
+      if(answerCount != pairsView.size())
+      {
+        std::cerr << "Error: The number of pairs does not match the number of answers" << std::endl;
+        return 1;
+      }
+
+      sumHaversine(pairsView, answers, 1.0/static_cast<double>(answerCount), options, totals);
+      if(options.fastKernel)
+      {
+        speedup = fastKernelSpeedup(pairsView);
+      }
+    }
   }
 
-  fprintf(stdout, "Input size: %llu\n", jsonString.size());
-  fprintf(stdout, "Pair count: %llu\n", pairs.size());
-  fprintf(stdout, "Haversine sum: %.16f\n", sum);
+  const double millionsOfPairs{static_cast<double>(totals.pairCount) / 1000000.0};
+  const double megabyte{1024.0 * 1024.0};
+  const double peakMegabytes{static_cast<double>(peakMemoryBytes()) / megabyte};
+
+  fprintf(stdout, "Input size: %llu\n", inputSize);
+  fprintf(stdout, "Input mode: %s\n", options.stream ? "stream" : (options.useMmap ? "mmap" : "read"));
+  fprintf(stdout, "Pair count: %llu\n", totals.pairCount);
+  if(options.parallel)
+  {
+    fprintf(stdout, "Parse path: pairs fast path, parallel\n");
+    printThreadReports(parallelResult);
+  }
+  else if(options.stream)
+  {
+    fprintf(stdout, "Parse path: pairs stream (%llu byte chunks)\n", options.chunkSize);
+    if(options.asyncIo)
+    {
+      // NOTE: Read time that parsing didn't wait for ran alongside it
+      const double hidden{ioReport.readSeconds > 0.0 ? 1.0 - ioReport.waitSeconds / ioReport.readSeconds : 1.0};
+      fprintf(stdout, "Async reads: %s, %llu in flight\n", asyncReadBackendName(ioReport.backend), options.ioDepth);
+      fprintf(stdout, "Read time hidden behind parsing: %.1f%% (waited %.3fms for %.3fms of reads, stream %.3fms)\n",
+              100.0 * std::max(hidden, 0.0), ioReport.waitSeconds * 1000.0, ioReport.readSeconds * 1000.0,
+              ioReport.seconds * 1000.0);
+    }
+  }
+  else if(options.pairFile)
+  {
+    fprintf(stdout, "Parse path: binary pair file (%s)\n",
+            pairFileLayout == PairLayout::SOA ? "soa, used in place" : "aos, unpacked");
+    fprintf(stdout, "Pair storage: %.3fmb\n", static_cast<double>(pairBytes) / megabyte);
+  }
+  else
+  {
+    fprintf(stdout, "Parse path: %s\n", usedFastPath ? "pairs fast path" : "generic document");
+    if(!usedFastPath)
+    {
+      fprintf(stdout, "Document nodes: %.3fmb\n", static_cast<double>(documentBytes) / megabyte);
+    }
+    fprintf(stdout, "Pair storage: %.3fmb\n", static_cast<double>(pairBytes) / megabyte);
+  }
+  fprintf(stdout, "Peak memory: %.3fmb", peakMegabytes);
+  if(millionsOfPairs > 0.0)
+  {
+    fprintf(stdout, " (%.3fmb per million pairs)", peakMegabytes / millionsOfPairs);
+  }
+  fprintf(stdout, "\n");
+  if(options.fastKernel)
+  {
+    fprintf(stdout, "Haversine kernel: fast (%s)\n", haversineKernelName(bestHaversineKernel()));
+  }
+  else
+  {
+    fprintf(stdout, "Haversine kernel: reference\n");
+  }
+  fprintf(stdout, "Haversine sum: %s\n", FixedDouble(totals.sum, 16).text);
   fprintf(stdout, "Validation:\n");
-  fprintf(stdout, "Reference sum: %.16f\n", referenceSum);
-  fprintf(stdout, "Difference: %.16f\n", sum - referenceSum);
+  fprintf(stdout, "Reference sum: %s\n", FixedDouble(totals.referenceSum, 16).text);
+  fprintf(stdout, "Difference: %s\n", FixedDouble(totals.sum - totals.referenceSum, 16).text);
+  // NOTE: The parallel workers only hand back their sums, not the distances
+  if(!options.parallel)
+  {
+    fprintf(stdout, "Max error: %.16e\n", totals.maxError);
+  }
+  if(speedup > 0.0)
+  {
+    fprintf(stdout, "Kernel speedup: %.2fx over reference\n", speedup);
+  }
+
+  if(options.scaling)
+  {
+    printScalingTable(json, totals.pairCount, options.threadCount, options.fastKernel);
+  }
 
   EndAndPrintProfile();
   return 0;
 
 }
-
-ProfilerEndOfCompilationUnit;
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "input_buffer_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+#include "profiler.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// NOTE: The transparent huge page size on x64 and arm64 Linux; the buffer is only aligned to it, the kernel decides
+constexpr size_t HUGE_PAGE_SIZE{2u * 1024u * 1024u};
+
+static size_t pageSize()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info{};
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static size_t roundUp(size_t size, size_t alignment)
+{
+  return (size + alignment - 1u) / alignment * alignment;
+}
+
+PooledBuffer::~PooledBuffer()
+{
+  release();
+}
+
+#ifdef _WIN32
+
+char* PooledBuffer::reserve(size_t size, const BufferPoolOptions&)
+{
+  if(size <= _capacity)
+  {
+    return _data;
+  }
+
+  release();
+  const size_t capacity{roundUp(size, pageSize())};
+  _mapping = VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if(!_mapping)
+  {
+    throw std::runtime_error("Could not allocate the input buffer");
+  }
+  _mappingSize = capacity;
+  _data = static_cast<char*>(_mapping);
+  _capacity = capacity;
+  _allocationCount++;
+
+  TimeBandwidth("prefaultBuffer", capacity);
+  const size_t stride{pageSize()};
+  for(size_t offset{0u}; offset < capacity; offset += stride)
+  {
+    _data[offset] = 0;
+  }
+  return _data;
+}
+
+void PooledBuffer::release()
+{
+  if(_mapping)
+  {
+    VirtualFree(_mapping, 0, MEM_RELEASE);
+  }
+  _mapping = nullptr;
+  _mappingSize = 0u;
+  _data = nullptr;
+  _capacity = 0u;
+}
+
+#else
+
+char* PooledBuffer::reserve(size_t size, const BufferPoolOptions& options)
+{
+  if(size <= _capacity)
+  {
+    return _data;
+  }
+
+  release();
+  // NOTE: Only whole huge pages at huge page aligned addresses can be backed by one, so map one extra and start the
+  // data at the first boundary inside
+  const size_t alignment{options.hugePages ? HUGE_PAGE_SIZE : pageSize()};
+  const size_t capacity{roundUp(size, alignment)};
+  const size_t mappingSize{options.hugePages ? capacity + HUGE_PAGE_SIZE : capacity};
+  void* mapping{mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+  if(mapping == MAP_FAILED)
+  {
+    throw std::runtime_error("Could not allocate the input buffer");
+  }
+  _mapping = mapping;
+  _mappingSize = mappingSize;
+  _data = reinterpret_cast<char*>(roundUp(reinterpret_cast<uintptr_t>(mapping), alignment));
+  _capacity = capacity;
+  _allocationCount++;
+
+#ifdef MADV_HUGEPAGE
+  if(options.hugePages)
+  {
+    madvise(_data, _capacity, MADV_HUGEPAGE);
+  }
+#endif
+
+  // NOTE: Written, not read - a read would only map the shared zero page and the first real write would fault again.
+  // Touched by hand rather than with MAP_POPULATE, which would fault everything in before the madvise.
+  TimeBandwidth("prefaultBuffer", _capacity);
+  const size_t stride{pageSize()};
+  for(size_t offset{0u}; offset < _capacity; offset += stride)
+  {
+    _data[offset] = 0;
+  }
+  return _data;
+}
+
+void PooledBuffer::release()
+{
+  if(_mapping)
+  {
+    munmap(_mapping, _mappingSize);
+  }
+  _mapping = nullptr;
+  _mappingSize = 0u;
+  _data = nullptr;
+  _capacity = 0u;
+}
+
+#endif // _WIN32
+
+// Reads all of path into buffer, grown to fit. Returns the file size.
+static size_t readWholeFile(const std::string& path, PooledBuffer& buffer, const BufferPoolOptions& options)
+{
+  std::unique_ptr<FILE, int(*)(FILE*)> file(fopen(path.c_str(), "rb"), fclose);
+  if(!file)
+  {
+    throw std::runtime_error("Could not open " + path);
+  }
+  fseek(file.get(), 0, SEEK_END);
+  const size_t fileSize{static_cast<size_t>(ftell(file.get()))};
+  fseek(file.get(), 0, SEEK_SET);
+
+  char* destination{buffer.reserve(fileSize, options)};
+  TimeBandwidth("readPooled", fileSize);
+  if(fread(destination, 1, fileSize, file.get()) != fileSize)
+  {
+    throw std::runtime_error("Could not read " + path);
+  }
+  return fileSize;
+}
+
+void InputBufferPool::reserve(size_t inputSize, size_t answersSize)
+{
+  TimeFunction;
+  _input.reserve(inputSize, _options);
+  _answers.reserve(answersSize, _options);
+
+  // NOTE: As much capacity as parsePairs would reserve, so it never reallocates, and as many pairs as there are
+  // answers written once so their pages are faulted in - the rest of the capacity is never touched
+  TimeBandwidth("prefaultPairs", answersSize * 4u);
+  _pairs.reserve(JSONParser::pairCapacityFor(inputSize));
+  const size_t pairCount{std::min(answersSize / sizeof(double), JSONParser::pairCapacityFor(inputSize))};
+  _pairs.x0.resize(pairCount);
+  _pairs.y0.resize(pairCount);
+  _pairs.x1.resize(pairCount);
+  _pairs.y1.resize(pairCount);
+  _pairs.clear();
+}
+
+std::string_view InputBufferPool::readInput(const std::string& path)
+{
+  const size_t size{readWholeFile(path, _input, _options)};
+  return {_input.data(), size};
+}
+
+const double* InputBufferPool::readAnswers(const std::string& path, size_t& count)
+{
+  count = readWholeFile(path, _answers, _options) / sizeof(double);
+  return reinterpret_cast<const double*>(_answers.data());
+}
+
+size_t InputBufferPool::capacityBytes() const
+{
+  return _input.capacity() + _answers.capacity() + _pairs.x0.capacity() * 4u * sizeof(double);
+}
+
+size_t InputBufferPool::allocationCount() const
+{
+  return _input.allocationCount() + _answers.allocationCount();
+}
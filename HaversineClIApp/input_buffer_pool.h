@@ -0,0 +1,75 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_BUFFER_POOL_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "json_parser.h"
+
+struct BufferPoolOptions
+{
+  bool hugePages{false}; // ask for transparent huge pages, Linux only - Windows large pages need a privilege
+};
+
+// Writable memory that only ever grows. Comes straight from the OS rather than the heap, so it is not zero-filled by
+// the caller, and every page is written once when it is allocated so no later use takes a page fault. Growing
+// drops the contents.
+class PooledBuffer
+{
+ public:
+  PooledBuffer() = default;
+  ~PooledBuffer();
+
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+  // Makes room for at least size bytes and returns it. Throws std::runtime_error when the memory can't be had.
+  char* reserve(size_t size, const BufferPoolOptions& options);
+
+  [[nodiscard]] char* data() const { return _data; }
+  [[nodiscard]] size_t capacity() const { return _capacity; }
+  // How many times reserve had to allocate
+  [[nodiscard]] size_t allocationCount() const { return _allocationCount; }
+
+ private:
+  void release();
+
+  char* _data{nullptr};
+  size_t _capacity{0u};
+  size_t _allocationCount{0u};
+  // NOTE: What the OS handed out, more than the capacity when the data had to be moved up to a huge page boundary
+  void* _mapping{nullptr};
+  size_t _mappingSize{0u};
+};
+
+// Everything a file of a batch is read and parsed into, kept from one file to the next: the pairs file, the answers
+// and the parsed pairs. The file buffers are sized once to the largest files of the batch and the pairs grow to the
+// largest parse, after that nothing is allocated, zeroed or faulted in per file.
+class InputBufferPool
+{
+ public:
+  explicit InputBufferPool(const BufferPoolOptions& options) : _options(options) {}
+
+  // Grows the file buffers to hold the largest inputs up front, and the pairs to what parsing the largest input needs
+  void reserve(size_t inputSize, size_t answersSize);
+
+  // Read the whole file into its buffer and return a view of it, valid until the next read of the same kind. Throw
+  // std::runtime_error when the file can't be read.
+  std::string_view readInput(const std::string& path);
+  const double* readAnswers(const std::string& path, size_t& count);
+
+  // Cleared by every parse, the vectors keep their capacity
+  HaversinePairs& pairs() { return _pairs; }
+
+  [[nodiscard]] size_t capacityBytes() const;
+  [[nodiscard]] size_t allocationCount() const;
+
+ private:
+  BufferPoolOptions _options;
+  PooledBuffer _input;
+  PooledBuffer _answers;
+  HaversinePairs _pairs;
+};
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_BUFFER_POOL_H_
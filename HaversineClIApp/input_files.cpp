@@ -0,0 +1,159 @@
+#include "input_files.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "haversine_pair_file.h"
+#include "json_document.h"
+#include "profiler.h"
+
+//C++ style file reading
+std::string readJsonFile(const std::string& jsonFilePath, size_t buffer_size)
+{
+  std::ifstream jsonFile(jsonFilePath, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!jsonFile)
+  {
+    throw std::runtime_error("Could not open file");
+  }
+
+  std::streamsize fileSize = jsonFile.tellg();
+  jsonFile.seekg(0, std::ios::beg);
+  std::string fileContent(fileSize, '\0');
+
+  std::vector<char> buffer(buffer_size);
+  jsonFile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+
+  TimeBandwidth(__func__, fileSize);
+  if (!jsonFile.read(&fileContent[0], fileSize)) {
+    std::cerr << "Failed to read the entire file!" << std::endl;
+    return "";
+  }
+
+  return fileContent;
+}
+
+//C style file reading
+std::vector<double> readBinFile(const std::string &binFilePath)
+{
+  FILE *file = fopen(binFilePath.c_str(), "rb");
+  if (!file) {
+    throw std::runtime_error("Failed to open file");
+  }
+
+  std::vector<double> data;
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  size_t numElements = fileSize / sizeof(double);
+  data.resize(numElements);
+
+  TimeBandwidth(__func__, fileSize);
+  if (fread(data.data(), sizeof(double), numElements, file) != numElements)
+  {
+    fclose(file);
+    throw std::runtime_error("Failed to read file");
+  }
+
+  fclose(file);
+  return data;
+}
+
+size_t pairsFromDocument(std::string_view jsonString, HaversinePairs& pairs)
+{
+  TimeFunction;
+  JSONDocument document = JSONDocument::parse(jsonString);
+  auto jsonPairs = document.root()["pairs"].getArray();
+
+  pairs.reserve(jsonPairs.size());
+  for(auto pair : jsonPairs)
+  {
+    pairs.push_back(pair["x0"].get<double>(), pair["y0"].get<double>(),
+                    pair["x1"].get<double>(), pair["y1"].get<double>());
+  }
+  return document.byteCount();
+}
+
+// Binary pair file path. The header is checked and the checksum verified, then SOA coordinates are used where they
+// are - in the mapping or the read buffer - and AOS ones are unpacked into pairs. Returns false when the file is
+// damaged or doesn't match its header.
+bool pairsFromPairFile(std::string_view input, HaversinePairs& unpacked, HaversinePairsView& pairs,
+                       PairLayout& layout)
+{
+  TimeFunction;
+  HaversinePairFileHeader header{};
+  if(const char* error{readHaversinePairFileHeader(input.data(), input.size(), header)})
+  {
+    std::cerr << "Error: Bad pair file, " << error << std::endl;
+    return false;
+  }
+
+  // NOTE: The header size is a multiple of 8 and both the read buffer and the mapping are at least that aligned
+  const double* coordinates{reinterpret_cast<const double*>(input.data() + header.headerSize)};
+  const size_t count{header.pairCount};
+  layout = header.layout;
+  if(layout == PairLayout::SOA)
+  {
+    pairs = HaversinePairsView(coordinates, coordinates + count, coordinates + 2u * count, coordinates + 3u * count,
+                               count);
+  }
+  else
+  {
+    TimeBandwidth("unpackPairs", 4u * count * sizeof(double));
+    // NOTE: In a batch unpacked is the pool's, still holding the previous file's pairs
+    unpacked.clear();
+    unpacked.reserve(count);
+    for(size_t pairIndex{0u}; pairIndex < count; pairIndex++)
+    {
+      const double* pair{coordinates + 4u * pairIndex};
+      unpacked.push_back(pair[0], pair[1], pair[2], pair[3]);
+    }
+    pairs = unpacked;
+  }
+
+  uint64_t checksum{0u};
+  {
+    TimeBandwidth("verifyChecksum", pairs.byteCount());
+    for(size_t pairIndex{0u}; pairIndex < count; pairIndex++)
+    {
+      checksum += haversinePairChecksum(pairIndex, pairs.x0[pairIndex], pairs.y0[pairIndex], pairs.x1[pairIndex],
+                                        pairs.y1[pairIndex]);
+    }
+  }
+  if(checksum != header.checksum)
+  {
+    std::cerr << "Error: Bad pair file, checksum mismatch" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool pairsFromBatchInput(std::string_view input, bool forceTree, HaversinePairs& pairs,
+                         HaversinePairsView& pairsView)
+{
+  if(isHaversinePairFile(input.data(), input.size()))
+  {
+    PairLayout layout{PairLayout::SOA};
+    return pairsFromPairFile(input, pairs, pairsView, layout);
+  }
+
+  TimeBandwidth("parseJson", input.size());
+  if(forceTree || !JSONParser::parsePairs(input, pairs))
+  {
+    pairs.clear();
+    try
+    {
+      pairsFromDocument(input, pairs);
+    }
+    catch(const std::runtime_error& error)
+    {
+      std::cerr << "Error: Not a pairs document, " << error.what() << std::endl;
+      pairs.clear();
+      return false;
+    }
+  }
+  pairsView = pairs;
+  return true;
+}
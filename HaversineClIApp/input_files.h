@@ -0,0 +1,38 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_FILES_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_FILES_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "haversine_pair_file.h"
+#include "json_parser.h"
+
+// Stream buffer readJsonFile hands the ifstream, unless a machine profile sizes it
+constexpr size_t DEFAULT_READ_BUFFER_SIZE{256u * 1024u};
+
+// Reads the whole file into a string through an ifstream with a buffer_size byte stream buffer. Throws
+// std::runtime_error when the file can't be opened, returns an empty string when it can't be read to the end.
+std::string readJsonFile(const std::string& jsonFilePath, size_t buffer_size);
+
+// Reads the whole answers file as doubles with fread, the file size gives the count.
+// Throws std::runtime_error when the file can't be opened or read.
+std::vector<double> readBinFile(const std::string &binFilePath);
+
+// Generic path for inputs the pairs fast path doesn't recognise. Appends to pairs and returns the document's arena
+// size. Throws std::runtime_error when the JSON isn't an object with a "pairs" array of pair objects.
+size_t pairsFromDocument(std::string_view jsonString, HaversinePairs& pairs);
+
+// Binary pair file path. SOA coordinates are used where they are in input, AOS ones are unpacked into unpacked, which
+// is cleared first. Returns false, after saying why, when the file is damaged or doesn't match its header.
+bool pairsFromPairFile(std::string_view input, HaversinePairs& unpacked, HaversinePairsView& pairs,
+                       PairLayout& layout);
+
+// Decodes one --batch input, a pair file or JSON, into pairs, the buffer the batch reuses for every file. pairsView
+// ends up on whichever holds the coordinates. Returns false, after saying why, when the input can't be used - a
+// damaged pair file or JSON without a "pairs" array of pairs - so the batch can go on with its next file.
+bool pairsFromBatchInput(std::string_view input, bool forceTree, HaversinePairs& pairs,
+                         HaversinePairsView& pairsView);
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_INPUT_FILES_H_
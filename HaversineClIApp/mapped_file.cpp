@@ -0,0 +1,191 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t pageSize()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info{};
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path, const MapOptions& options)
+{
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    throw std::runtime_error("Could not open file");
+  }
+
+  LARGE_INTEGER fileSize{};
+  GetFileSizeEx(file, &fileSize);
+  _size = static_cast<size_t>(fileSize.QuadPart);
+
+  // NOTE: Empty files can't be mapped, they just stay an empty view
+  if(_size > 0u)
+  {
+    _mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(_mappingHandle)
+    {
+      _data = static_cast<const char*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+  }
+  CloseHandle(file);
+
+  if(_size > 0u && !_data)
+  {
+    unmap();
+    throw std::runtime_error("Could not map file");
+  }
+
+  // NOTE: Large pages only exist for pagefile-backed sections on Windows, so hugePages has nothing to ask for here
+  if(_data && options.populate)
+  {
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<char*>(_data), _size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+  }
+}
+
+void MappedFile::unmap()
+{
+  if(_data)
+  {
+    UnmapViewOfFile(_data);
+  }
+  if(_mappingHandle)
+  {
+    CloseHandle(_mappingHandle);
+  }
+  _data = nullptr;
+  _mappingHandle = nullptr;
+  _size = 0u;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0u)),
+    _mappingHandle(std::exchange(other._mappingHandle, nullptr))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if(this != &other)
+  {
+    unmap();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0u);
+    _mappingHandle = std::exchange(other._mappingHandle, nullptr);
+  }
+  return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path, const MapOptions& options)
+{
+  const int file{::open(path.c_str(), O_RDONLY)};
+  if(file < 0)
+  {
+    throw std::runtime_error("Could not open file");
+  }
+
+  struct stat fileStat{};
+  if(fstat(file, &fileStat) != 0)
+  {
+    close(file);
+    throw std::runtime_error("Could not open file");
+  }
+  _size = static_cast<size_t>(fileStat.st_size);
+
+  // NOTE: Empty files can't be mapped, they just stay an empty view
+  if(_size > 0u)
+  {
+    int flags{MAP_PRIVATE};
+#ifdef MAP_POPULATE
+    if(options.populate)
+    {
+      flags |= MAP_POPULATE;
+    }
+#endif
+    void* mapping{mmap(nullptr, _size, PROT_READ, flags, file, 0)};
+    if(mapping == MAP_FAILED)
+    {
+      close(file);
+      _size = 0u;
+      throw std::runtime_error("Could not map file");
+    }
+    _data = static_cast<const char*>(mapping);
+
+    madvise(mapping, _size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    if(options.hugePages)
+    {
+      madvise(mapping, _size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  // NOTE: The mapping keeps its own reference to the file
+  close(file);
+}
+
+void MappedFile::unmap()
+{
+  if(_data)
+  {
+    munmap(const_cast<char*>(_data), _size);
+  }
+  _data = nullptr;
+  _size = 0u;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0u))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if(this != &other)
+  {
+    unmap();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0u);
+  }
+  return *this;
+}
+
+#endif // _WIN32
+
+MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+size_t MappedFile::touchPages() const
+{
+  const size_t stride{pageSize()};
+  size_t sum{0u};
+  for(size_t offset{0u}; offset < _size; offset += stride)
+  {
+    sum += static_cast<unsigned char>(_data[offset]);
+  }
+  return sum;
+}
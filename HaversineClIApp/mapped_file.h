@@ -0,0 +1,47 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_MAPPED_FILE_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+struct MapOptions
+{
+  bool populate{false};  // fault every page in while mapping (MAP_POPULATE / PrefetchVirtualMemory)
+  bool hugePages{false}; // ask for transparent huge pages, only a hint - most filesystems ignore it
+};
+
+// Read-only view of a whole file, mapped instead of copied. The pages are faulted in on first touch unless
+// MapOptions::populate is set, and the kernel is told the access is sequential so it reads ahead aggressively.
+class MappedFile
+{
+ public:
+  MappedFile() = default;
+  // Throws std::runtime_error when the file can't be opened or mapped
+  MappedFile(const std::string& path, const MapOptions& options);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  [[nodiscard]] const char* data() const { return _data; }
+  [[nodiscard]] size_t size() const { return _size; }
+  [[nodiscard]] std::string_view view() const { return {_data, _size}; }
+
+  // Reads one byte per page so every page is resident before the caller starts on it. Returns the sum of the bytes
+  // read, only so the loads can't be optimized away.
+  size_t touchPages() const;
+
+ private:
+  void unmap();
+
+  const char* _data{nullptr};
+  size_t _size{0u};
+#ifdef _WIN32
+  void* _mappingHandle{nullptr};
+#endif
+};
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_MAPPED_FILE_H_
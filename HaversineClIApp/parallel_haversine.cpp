@@ -0,0 +1,123 @@
+#include "parallel_haversine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "fast_haversine.h"
+#include "haversine_formula.cpp"
+#include "json_parser.h"
+#include "profiler.h"
+
+struct WorkerRange
+{
+  std::string_view records;
+  bool valid{false};
+  bool endsWithComma{false};
+};
+
+static void sumRange(WorkerRange& range, double sumCoefficient, bool fastKernel, HaversineThreadReport& report)
+{
+  TimeBandwidth(__func__, range.records.size());
+  const auto start = std::chrono::steady_clock::now();
+
+  HaversinePairs pairs;
+  range.valid = JSONParser::parsePairRecords(range.records, pairs, range.endsWithComma);
+
+  std::vector<double> distances(range.valid ? pairs.size() : 0u);
+  if(fastKernel)
+  {
+    fastHaversine(pairs.x0.data(), pairs.y0.data(), pairs.x1.data(), pairs.y1.data(), distances.size(), 6372.8,
+                  distances.data());
+  }
+  else
+  {
+    for(size_t pairIndex{0u}; pairIndex < distances.size(); pairIndex++)
+    {
+      distances[pairIndex] = ReferenceHaversine(pairs.x0[pairIndex], pairs.y0[pairIndex], pairs.x1[pairIndex],
+                                                pairs.y1[pairIndex], 6372.8);
+    }
+  }
+
+  double sum{0.0};
+  for(double distance : distances)
+  {
+    sum += distance * sumCoefficient;
+  }
+
+  report.byteCount = range.records.size();
+  report.pairCount = pairs.size();
+  report.sum = sum;
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+ParallelHaversineResult sumHaversineParallel(std::string_view json, size_t threadCount, double sumCoefficient,
+                                             bool fastKernel)
+{
+  ParallelHaversineResult result;
+  size_t arrayBegin{0u};
+  size_t arrayEnd{0u};
+  if(threadCount == 0u || !JSONParser::findPairsArray(json, arrayBegin, arrayEnd))
+  {
+    return result;
+  }
+
+  // NOTE: Every '{' inside the array starts a record. A '{' inside a string would put a split in the wrong place,
+  // but strings that could hold one make the document invalid anyway and the range fails to parse.
+  std::vector<size_t> splits(threadCount + 1u);
+  splits[0] = arrayBegin;
+  splits[threadCount] = arrayEnd;
+  const size_t arraySize{arrayEnd - arrayBegin};
+  for(size_t threadIndex{1u}; threadIndex < threadCount; threadIndex++)
+  {
+    const size_t target{std::max(arrayBegin + arraySize / threadCount * threadIndex, splits[threadIndex - 1u])};
+    const size_t recordStart{json.find('{', target)};
+    splits[threadIndex] = (recordStart == std::string_view::npos || recordStart > arrayEnd) ? arrayEnd : recordStart;
+  }
+
+  std::vector<WorkerRange> ranges(threadCount);
+  result.threads.resize(threadCount);
+  for(size_t threadIndex{0u}; threadIndex < threadCount; threadIndex++)
+  {
+    ranges[threadIndex].records = json.substr(splits[threadIndex], splits[threadIndex + 1u] - splits[threadIndex]);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  workers.reserve(threadCount - 1u);
+  for(size_t threadIndex{1u}; threadIndex < threadCount; threadIndex++)
+  {
+    workers.emplace_back(sumRange, std::ref(ranges[threadIndex]), sumCoefficient, fastKernel,
+                         std::ref(result.threads[threadIndex]));
+  }
+  // NOTE: The calling thread takes the first range instead of idling
+  sumRange(ranges[0], sumCoefficient, fastKernel, result.threads[0]);
+  for(std::thread& worker : workers)
+  {
+    worker.join();
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // NOTE: Joined back together the ranges must be one run of records - every non-empty range but the last ends in
+  // the comma that separates it from the next
+  result.valid = true;
+  const WorkerRange* previous{nullptr};
+  for(size_t threadIndex{0u}; threadIndex < threadCount; threadIndex++)
+  {
+    const WorkerRange& range{ranges[threadIndex]};
+    result.valid = result.valid && range.valid;
+    if(result.threads[threadIndex].pairCount == 0u)
+    {
+      continue;
+    }
+    result.valid = result.valid && (!previous || previous->endsWithComma);
+    previous = &range;
+
+    result.sum += result.threads[threadIndex].sum;
+    result.pairCount += result.threads[threadIndex].pairCount;
+  }
+  result.valid = result.valid && (!previous || !previous->endsWithComma);
+
+  return result;
+}
@@ -0,0 +1,36 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECLIAPP_PARALLEL_HAVERSINE_H_
+#define PERFAWARE_PROFILING_HAVERSINECLIAPP_PARALLEL_HAVERSINE_H_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+struct HaversineThreadReport
+{
+  size_t byteCount{0u};
+  size_t pairCount{0u};
+  double seconds{0.0};
+  double sum{0.0};
+};
+
+struct ParallelHaversineResult
+{
+  bool valid{false};
+  size_t pairCount{0u};
+  double sum{0.0};
+  double seconds{0.0};
+  std::vector<HaversineThreadReport> threads;
+};
+
+// Splits the pairs array of a pairs format document into threadCount byte ranges, moves each split forward to the
+// next record start, and parses and sums every range on its own thread. Each distance is scaled by sumCoefficient.
+// The partial sums are added up in range order, so the result only depends on the input and the thread count, never
+// on scheduling. fastKernel uses fastHaversine instead of ReferenceHaversine. valid is false when the document isn't in
+// the pairs format.
+//
+// NOTE: Each range is timed on its worker's own profiler table, the profile shows them per thread. Print it only
+// after this returns.
+ParallelHaversineResult sumHaversineParallel(std::string_view json, size_t threadCount, double sumCoefficient,
+                                             bool fastKernel);
+
+#endif //PERFAWARE_PROFILING_HAVERSINECLIAPP_PARALLEL_HAVERSINE_H_
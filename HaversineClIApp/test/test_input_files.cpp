@@ -0,0 +1,107 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "input_files.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+// A .hvb pair file in memory. Held as doubles so the coordinates are as aligned as in a read buffer or a mapping.
+struct PairFileBuffer
+{
+  std::vector<double> storage;
+
+  PairFileBuffer(PairLayout layout, const std::vector<std::vector<double>>& coordinates)
+  {
+    const size_t count{coordinates.size()};
+    const size_t headerDoubles{sizeof(HaversinePairFileHeader) / sizeof(double)};
+    storage.resize(headerDoubles + 4u * count);
+
+    uint64_t checksum{0u};
+    for(size_t pairIndex{0u}; pairIndex < count; pairIndex++)
+    {
+      const std::vector<double>& pair{coordinates[pairIndex]};
+      checksum += haversinePairChecksum(pairIndex, pair[0], pair[1], pair[2], pair[3]);
+      for(size_t coordinate{0u}; coordinate < 4u; coordinate++)
+      {
+        const size_t index{layout == PairLayout::AOS ? 4u * pairIndex + coordinate : coordinate * count + pairIndex};
+        storage[headerDoubles + index] = pair[coordinate];
+      }
+    }
+
+    const HaversinePairFileHeader header{makeHaversinePairFileHeader(count, 0u, PairDistribution::UNIFORM, layout,
+                                                                     checksum)};
+    std::memcpy(storage.data(), &header, sizeof(header));
+  }
+
+  [[nodiscard]] std::string_view input() const
+  {
+    return {reinterpret_cast<const char*>(storage.data()), storage.size() * sizeof(double)};
+  }
+};
+} // namespace
+
+TEST_CASE("pairsFromBatchInput reuses one pairs buffer across JSON and pair files")
+{
+  const std::string json{R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4},)"
+                         R"({"x0":5, "y0":6, "x1":7, "y1":8},)"
+                         R"({"x0":9, "y0":10, "x1":11, "y1":12}]})"};
+  const PairFileBuffer aos(PairLayout::AOS, {{-1.0, -2.0, -3.0, -4.0}, {-5.0, -6.0, -7.0, -8.0}});
+  const PairFileBuffer soa(PairLayout::SOA, {{20.0, 21.0, 22.0, 23.0}});
+
+  // NOTE: One buffer for every entry, the way --batch uses the pool's
+  HaversinePairs pairs;
+  HaversinePairsView pairsView;
+
+  REQUIRE(pairsFromBatchInput(json, false, pairs, pairsView));
+  REQUIRE(pairsView.size() == 3u);
+  REQUIRE(pairsView.y1[2] == 12.0);
+
+  SECTION("AOS after JSON holds only the pair file's pairs")
+  {
+    REQUIRE(pairsFromBatchInput(aos.input(), false, pairs, pairsView));
+    REQUIRE(pairsView.size() == 2u);
+    REQUIRE(pairs.size() == 2u);
+    REQUIRE(pairsView.x0[0] == -1.0);
+    REQUIRE(pairsView.y1[1] == -8.0);
+
+    REQUIRE(pairsFromBatchInput(json, true, pairs, pairsView));
+    REQUIRE(pairsView.size() == 3u);
+    REQUIRE(pairsView.x0[1] == 5.0);
+  }
+
+  SECTION("SOA is used in place")
+  {
+    REQUIRE(pairsFromBatchInput(soa.input(), false, pairs, pairsView));
+    REQUIRE(pairsView.size() == 1u);
+    REQUIRE(pairsView.x1[0] == 22.0);
+    REQUIRE(reinterpret_cast<const char*>(pairsView.x0) == soa.input().data() + sizeof(HaversinePairFileHeader));
+  }
+}
+
+TEST_CASE("pairsFromBatchInput rejects a bad entry without throwing")
+{
+  HaversinePairs pairs;
+  HaversinePairsView pairsView;
+  std::vector<std::string> inputs = {
+    "",
+    R"({"pairs":3})",
+    R"({"points":[{"x0":1, "y0":2, "x1":3, "y1":4}]})",
+    R"({"pairs":[{"x0":"1", "y0":2, "x1":3, "y1":4}]})"
+  };
+
+  for(const auto& json : inputs)
+  {
+    for(bool forceTree : {false, true})
+    {
+      REQUIRE_FALSE(pairsFromBatchInput(json, forceTree, pairs, pairsView));
+      REQUIRE(pairs.size() == 0u);
+    }
+  }
+
+  // NOTE: A truncated pair file is caught by its header
+  const PairFileBuffer aos(PairLayout::AOS, {{1.0, 2.0, 3.0, 4.0}});
+  REQUIRE_FALSE(pairsFromBatchInput(aos.input().substr(0u, aos.input().size() - 8u), false, pairs, pairsView));
+}
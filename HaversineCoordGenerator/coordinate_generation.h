@@ -0,0 +1,120 @@
+#ifndef PERFAWARE_PROFILING_HAVERSINECOORDGENERATOR_COORDINATE_GENERATION_H_
+#define PERFAWARE_PROFILING_HAVERSINECOORDGENERATOR_COORDINATE_GENERATION_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+
+#include "json_number.h"
+
+// The generator's pair distributions and JSON record format, shared with the benchmarks that build the same input
+// in memory instead of reading it from the generator's files.
+constexpr double UNIFORM_MIN_LATITUDE = -90.0;
+constexpr double UNIFORM_MAX_LATITUDE = 90.0;
+constexpr double UNIFORM_MIN_LONGITUDE = -180.0;
+constexpr double UNIFORM_MAX_LONGITUDE = 180.0;
+constexpr size_t CLUSTER_NUMBER = 64U;
+constexpr double CLUSTER_LATITUDE_SPREAD = 5.0;
+constexpr double CLUSTER_LONGITUDE_SPREAD = 5.0;
+constexpr std::string_view JSON_HEADER = "{\"pairs\":[\n";
+constexpr std::string_view JSON_TRAILER = "]}";
+constexpr int COORDINATE_PRECISION = 16;
+// Longest pair record: four coordinates plus the keys, separators and indentation
+constexpr size_t MAX_RECORD_LENGTH = 4U * MAX_FORMATTED_DOUBLE_LENGTH + 64U;
+
+// Writes one line of the pairs array at out and returns its end. The fixed format is the historical
+// std::fixed/setprecision(16) text, which rounds away the last bits of values below ~0.1; the shortest one reads
+// back exactly.
+inline char* formatPairRecord(char* out, double X0, double Y0, double X1, double Y1, bool last, bool shortest)
+{
+  auto appendText = [&out](std::string_view text) {
+    std::memcpy(out, text.data(), text.size());
+    out += text.size();
+  };
+  auto appendCoordinate = [&out, shortest](double value) {
+    out = shortest ? formatShortest(value, out) : formatFixed(value, COORDINATE_PRECISION, out);
+  };
+
+  appendText("    {\"x0\":");
+  appendCoordinate(X0);
+  appendText(", \"y0\":");
+  appendCoordinate(Y0);
+  appendText(", \"x1\":");
+  appendCoordinate(X1);
+  appendText(", \"y1\":");
+  appendCoordinate(Y1);
+  if(last)
+  {
+    appendText("}\n");
+  }
+  else
+  {
+    appendText("},\n");
+  }
+  return out;
+}
+
+// SplitMix64 evaluated at an arbitrary position of its sequence: every draw is a pure function of (key, counter), so
+// any thread can produce any part of the output without generating what comes before it
+inline uint64_t counterRandom(uint64_t key, uint64_t counter)
+{
+  uint64_t z = key + (counter + 1U) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31U);
+}
+
+inline double counterUniform(uint64_t key, uint64_t counter, double min, double max)
+{
+  const double unit = static_cast<double>(counterRandom(key, counter) >> 11U) * 0x1.0p-53;
+  return min + (max - min) * unit;
+}
+
+// Separate streams for the pairs and the cluster parameters, both derived from the seed
+struct CounterStreams
+{
+  uint64_t pairKey;
+  uint64_t clusterKey;
+
+  explicit CounterStreams(uint64_t seed) : pairKey(counterRandom(seed, 1U)), clusterKey(counterRandom(seed, 2U)) {}
+};
+
+// Same distributions as generateUniformCoordinate/generateClusterCoordinate, drawn from pair index pairIndex's own
+// counters instead of a shared engine
+inline std::tuple<double,double,double,double> generateCounterCoordinate(const CounterStreams& streams, bool cluster,
+                                                                         size_t pointsPerCluster, uint64_t pairIndex)
+{
+  double minLatitude = UNIFORM_MIN_LATITUDE;
+  double maxLatitude = UNIFORM_MAX_LATITUDE;
+  double minLongitude = UNIFORM_MIN_LONGITUDE;
+  double maxLongitude = UNIFORM_MAX_LONGITUDE;
+
+  if(cluster)
+  {
+    const uint64_t clusterCounter = (pairIndex / pointsPerCluster) * 4U;
+    const double centerLatitude = counterUniform(streams.clusterKey, clusterCounter, UNIFORM_MIN_LATITUDE, UNIFORM_MAX_LATITUDE);
+    const double centerLongitude = counterUniform(streams.clusterKey, clusterCounter + 1U, UNIFORM_MIN_LONGITUDE, UNIFORM_MAX_LONGITUDE);
+    const double offsetLatitude = counterUniform(streams.clusterKey, clusterCounter + 2U, 0.0, CLUSTER_LATITUDE_SPREAD);
+    const double offsetLongitude = counterUniform(streams.clusterKey, clusterCounter + 3U, 0.0, CLUSTER_LONGITUDE_SPREAD);
+
+    const double latitudeWithOffset = std::clamp(centerLatitude + offsetLatitude, UNIFORM_MIN_LATITUDE, UNIFORM_MAX_LATITUDE);
+    const double longitudeWithOffset = std::clamp(centerLongitude + offsetLongitude, UNIFORM_MIN_LONGITUDE, UNIFORM_MAX_LONGITUDE);
+    minLatitude = std::min(centerLatitude, latitudeWithOffset);
+    maxLatitude = std::max(centerLatitude, latitudeWithOffset);
+    minLongitude = std::min(centerLongitude, longitudeWithOffset);
+    maxLongitude = std::max(centerLongitude, longitudeWithOffset);
+  }
+
+  const uint64_t pairCounter = pairIndex * 4U;
+  return {
+    counterUniform(streams.pairKey, pairCounter, minLatitude, maxLatitude),
+    counterUniform(streams.pairKey, pairCounter + 1U, minLongitude, maxLongitude),
+    counterUniform(streams.pairKey, pairCounter + 2U, minLatitude, maxLatitude),
+    counterUniform(streams.pairKey, pairCounter + 3U, minLongitude, maxLongitude)
+  };
+}
+
+#endif //PERFAWARE_PROFILING_HAVERSINECOORDGENERATOR_COORDINATE_GENERATION_H_
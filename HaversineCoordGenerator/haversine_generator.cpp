@@ -1,33 +1,66 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <random>
 #include <array>
 #include <fstream>
-#include <iomanip>
-#include <bits/stl_algo.h>
-
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "coordinate_generation.h"
 #include "haversine_formula.cpp"
+#include "haversine_pair_file.h"
+#include "json_number.h"
 
 namespace
 {
-  const double UNIFORM_MIN_LATITUDE = -90.0;
-  const double UNIFORM_MAX_LATITUDE = 90.0;
-  const double UNIFORM_MIN_LONGITUDE = -180.0;
-  const double UNIFORM_MAX_LONGITUDE = 180.0;
-  const size_t CLUSTER_NUMBER = 64U;
-  const double CLUSTER_LATITUDE_SPREAD = 5.0;
-  const double CLUSTER_LONGITUDE_SPREAD = 5.0;
   const double EARTH_RADIUS = 6372.8;
   const std::string FILE_NAME = "coordinates.json";
+  const std::string PAIR_FILE_NAME = "coordinates.hvb";
   const size_t BATCH_SIZE = 100000U;
   const std::string DISTANCE_ANSWERS_FILE_NAME = "distance_answers.f64";
+  // Pairs per unit of parallel work. Also the grouping of the expected sum, which is what keeps it independent of
+  // the thread count.
+  const size_t PARALLEL_BLOCK_SIZE = 65536U;
 }
 
+// What the generator writes besides distance_answers.f64
+struct OutputOptions
+{
+  bool json = true;                     // coordinates.json
+  bool pairFile = false;                // coordinates.hvb
+  bool shortest = false;                // shortest round trip text in the JSON instead of 16 decimals
+  PairLayout layout = PairLayout::SOA;  // of the .hvb coordinates
+};
+
 void PrintUsage() {
-  std::cout << "Usage: ./haversine_generator [uniform/cluster] [random seed] [number of coordinates to generate]" << std::endl;
+  std::cout << "Usage: ./haversine_generator [uniform/cluster] [random seed] [number of coordinates to generate] [--threads=<count>] [--shortest] [--format=json|hvb|both] [--layout=soa|aos]" << std::endl;
+  std::cout << "  --threads=<count>  generate on count threads (0 uses every core) with the counter-based generator."
+            << " The output depends only on the seed and the pair count, not on count" << std::endl;
+  std::cout << "  --shortest         write each coordinate as the shortest text that parses back to the same double,"
+            << " instead of 16 fixed decimals" << std::endl;
+  std::cout << "  --format=<format>  json writes " << FILE_NAME << " (default), hvb the binary " << PAIR_FILE_NAME
+            << " with the same pairs, both writes both" << std::endl;
+  std::cout << "  --layout=<layout>  " << PAIR_FILE_NAME << " coordinates pair by pair (aos) or as four arrays (soa,"
+            << " default)" << std::endl;
 }
 
-
 std::pair<double,double> generateClusterCenter(std::mt19937& RandomNumberGenerator)
 {
   std::uniform_real_distribution<double> LatitudeDistribution(UNIFORM_MIN_LATITUDE, UNIFORM_MAX_LATITUDE);
@@ -94,7 +127,8 @@ std::tuple<double,double,double,double> generateUniformCoordinate(std::mt19937&
   return twoPointsCoord;
 }
 
-void writeCoordToFileInButches(std::vector<std::tuple<double, double, double, double>>& coordinates, bool lastBatch)
+void writeCoordToFileInButches(std::vector<std::tuple<double, double, double, double>>& coordinates, bool lastBatch,
+                               const OutputOptions& output)
 {
   std::ofstream file(FILE_NAME, std::ios::app);
 
@@ -104,16 +138,18 @@ void writeCoordToFileInButches(std::vector<std::tuple<double, double, double, do
     return;
   }
 
+  // NOTE: The whole batch is formatted into one buffer and written at once, the per value stream insertions were
+  // most of the generator's run time
+  std::string text;
+  char record[MAX_RECORD_LENGTH];
   for(auto coord{0u}; coord < coordinates.size(); coord++)
   {
     auto [X0, Y0, X1, Y1] = coordinates[coord];
-    file << "    {\"x0\":" << std::fixed << std::setprecision(16) << X0
-         << ", \"y0\":" << Y0
-         << ", \"x1\":" << X1
-         << ", \"y1\":" << Y1
-         << "}" << (coord == coordinates.size() - 1 && lastBatch ? "\n" : ",\n");
+    char* end = formatPairRecord(record, X0, Y0, X1, Y1, coord == coordinates.size() - 1 && lastBatch,
+                                 output.shortest);
+    text.append(record, static_cast<size_t>(end - record));
   }
-
+  file.write(text.data(), static_cast<std::streamsize>(text.size()));
 }
 
 void writeHaversineDistanceToFileBatchesBIN(std::vector<double>& distances)
@@ -141,6 +177,10 @@ void deletePreviousFiles()
   if (std::ifstream(DISTANCE_ANSWERS_FILE_NAME)) {
     std::remove(DISTANCE_ANSWERS_FILE_NAME.c_str());
   }
+
+  if (std::ifstream(PAIR_FILE_NAME)) {
+    std::remove(PAIR_FILE_NAME.c_str());
+  }
 }
 
 void openJsonFile()
@@ -163,35 +203,437 @@ void closeJsonFile()
   file << "]}";
 }
 
+class OutputFile
+{
+ public:
+  explicit OutputFile(const std::string& path)
+  {
+#ifdef _WIN32
+    _handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+    _file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+  }
+
+  ~OutputFile()
+  {
+#ifdef _WIN32
+    if(_handle != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(_handle);
+    }
+#else
+    if(_file >= 0)
+    {
+      close(_file);
+    }
+#endif
+  }
+
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+
+  bool isOpen() const
+  {
+#ifdef _WIN32
+    return _handle != INVALID_HANDLE_VALUE;
+#else
+    return _file >= 0;
+#endif
+  }
+
+  // Positional write, safe to call from several threads at once as long as the ranges don't overlap
+  bool writeAt(const char* data, size_t size, uint64_t offset)
+  {
+    while(size > 0U)
+    {
+#ifdef _WIN32
+      OVERLAPPED overlapped{};
+      overlapped.Offset = static_cast<DWORD>(offset);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32U);
+      DWORD written = 0;
+      const DWORD request = static_cast<DWORD>(std::min<size_t>(size, 1U << 30U));
+      if(!WriteFile(_handle, data, request, &written, &overlapped) || written == 0)
+      {
+        return false;
+      }
+#else
+      const ssize_t written = pwrite(_file, data, size, static_cast<off_t>(offset));
+      if(written <= 0)
+      {
+        return false;
+      }
+#endif
+      data += written;
+      size -= static_cast<size_t>(written);
+      offset += static_cast<uint64_t>(written);
+    }
+    return true;
+  }
+
+ private:
+#ifdef _WIN32
+  HANDLE _handle{INVALID_HANDLE_VALUE};
+#else
+  int _file{-1};
+#endif
+};
+
+// Writes a .hvb pair file a block of pairs at a time. Every pair has a fixed place in either layout, so blocks can be
+// written in any order and from several threads at once. The header goes in last, once the checksum is complete.
+class PairFileWriter
+{
+ public:
+  PairFileWriter(const std::string& path, size_t pairCount, PairLayout layout)
+    : _file(path), _pairCount(pairCount), _layout(layout)
+  {
+  }
+
+  bool isOpen() const { return _file.isOpen(); }
+
+  // Writes pairs [firstPair, firstPair + count), given as four arrays
+  bool writeBlock(size_t firstPair, const double* x0, const double* y0, const double* x1, const double* y1,
+                  size_t count)
+  {
+    uint64_t checksum = 0U;
+    for(size_t index = 0U; index < count; index++)
+    {
+      checksum += haversinePairChecksum(firstPair + index, x0[index], y0[index], x1[index], y1[index]);
+    }
+    _checksum += checksum;
+
+    const uint64_t dataOffset = sizeof(HaversinePairFileHeader);
+    if(_layout == PairLayout::SOA)
+    {
+      const double* arrays[4] = {x0, y0, x1, y1};
+      for(size_t arrayIndex = 0U; arrayIndex < 4U; arrayIndex++)
+      {
+        const uint64_t offset = dataOffset + (arrayIndex * _pairCount + firstPair) * sizeof(double);
+        if(!_file.writeAt(reinterpret_cast<const char*>(arrays[arrayIndex]), count * sizeof(double), offset))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    std::vector<double> records(4U * count);
+    for(size_t index = 0U; index < count; index++)
+    {
+      records[4U * index] = x0[index];
+      records[4U * index + 1U] = y0[index];
+      records[4U * index + 2U] = x1[index];
+      records[4U * index + 3U] = y1[index];
+    }
+    return _file.writeAt(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(double),
+                         dataOffset + firstPair * 4U * sizeof(double));
+  }
+
+  bool writeHeader(uint64_t seed, PairDistribution distribution)
+  {
+    const HaversinePairFileHeader header = makeHaversinePairFileHeader(_pairCount, seed, distribution, _layout,
+                                                                       _checksum);
+    return _file.writeAt(reinterpret_cast<const char*>(&header), sizeof(header), 0U);
+  }
+
+ private:
+  OutputFile _file;
+  size_t _pairCount;
+  PairLayout _layout;
+  std::atomic<uint64_t> _checksum{0U};
+};
+
+// Hands out JSON file offsets in block order. A block's records can only be placed once the sizes of all the blocks
+// before it are known, so each worker formats its block first and then waits here for its turn - only the claim is
+// serialized, the formatting and the writes overlap.
+class OrderedOffsets
+{
+ public:
+  explicit OrderedOffsets(uint64_t firstOffset) : _nextOffset(firstOffset) {}
+
+  uint64_t claim(size_t block, size_t size)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _turn.wait(lock, [&]() { return _nextBlock == block; });
+    const uint64_t offset = _nextOffset;
+    _nextOffset += size;
+    _nextBlock++;
+    _turn.notify_all();
+    return offset;
+  }
+
+  uint64_t end()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _nextOffset;
+  }
+
+ private:
+  std::mutex _mutex;
+  std::condition_variable _turn;
+  size_t _nextBlock{0U};
+  uint64_t _nextOffset;
+};
+
+struct ParallelGeneratorState
+{
+  ParallelGeneratorState(bool clusterMethod, uint64_t seed, size_t count, const OutputOptions& outputOptions)
+    : streams(seed), cluster(clusterMethod), output(outputOptions),
+      pointsPerCluster(std::max<size_t>(count / CLUSTER_NUMBER, 1U)), pairCount(count), sumCoefficient(1.0 / static_cast<double>(count)),
+      blockCount((count + PARALLEL_BLOCK_SIZE - 1U) / PARALLEL_BLOCK_SIZE), jsonOffsets(JSON_HEADER.size()),
+      answersFile(DISTANCE_ANSWERS_FILE_NAME), blockSums(blockCount)
+  {
+    if(output.json)
+    {
+      jsonFile = std::make_unique<OutputFile>(FILE_NAME);
+    }
+    if(output.pairFile)
+    {
+      pairFile = std::make_unique<PairFileWriter>(PAIR_FILE_NAME, count, output.layout);
+    }
+  }
+
+  CounterStreams streams;
+  bool cluster;
+  OutputOptions output;
+  size_t pointsPerCluster;
+  size_t pairCount;
+  double sumCoefficient;
+  size_t blockCount;
+
+  std::atomic<size_t> nextBlock{0U};
+  OrderedOffsets jsonOffsets;
+  std::unique_ptr<OutputFile> jsonFile;
+  std::unique_ptr<PairFileWriter> pairFile;
+  OutputFile answersFile;
+  std::vector<double> blockSums;
+  std::atomic<bool> failed{false};
+};
+
+void generateBlocks(ParallelGeneratorState& state)
+{
+  std::string json;
+  std::vector<double> distances;
+  std::vector<double> blockX0, blockY0, blockX1, blockY1;
+  char record[MAX_RECORD_LENGTH];
+
+  for(size_t block = state.nextBlock.fetch_add(1U); block < state.blockCount; block = state.nextBlock.fetch_add(1U))
+  {
+    const size_t firstPair = block * PARALLEL_BLOCK_SIZE;
+    const size_t endPair = std::min(firstPair + PARALLEL_BLOCK_SIZE, state.pairCount);
+
+    json.clear();
+    distances.clear();
+    blockX0.clear();
+    blockY0.clear();
+    blockX1.clear();
+    blockY1.clear();
+    double blockSum = 0.0;
+    for(size_t pairIndex = firstPair; pairIndex < endPair; pairIndex++)
+    {
+      auto [X0, Y0, X1, Y1] = generateCounterCoordinate(state.streams, state.cluster, state.pointsPerCluster, pairIndex);
+      distances.push_back(ReferenceHaversine(X0, Y0, X1, Y1, EARTH_RADIUS));
+      blockSum += distances.back() * state.sumCoefficient;
+
+      if(state.jsonFile)
+      {
+        char* end = formatPairRecord(record, X0, Y0, X1, Y1, pairIndex == state.pairCount - 1U, state.output.shortest);
+        json.append(record, static_cast<size_t>(end - record));
+      }
+      if(state.pairFile)
+      {
+        blockX0.push_back(X0);
+        blockY0.push_back(Y0);
+        blockX1.push_back(X1);
+        blockY1.push_back(Y1);
+      }
+    }
+    state.blockSums[block] = blockSum;
+
+    bool written = state.answersFile.writeAt(reinterpret_cast<const char*>(distances.data()),
+                                             distances.size() * sizeof(double), firstPair * sizeof(double));
+    if(state.pairFile)
+    {
+      written = state.pairFile->writeBlock(firstPair, blockX0.data(), blockY0.data(), blockX1.data(), blockY1.data(),
+                                           blockX0.size()) && written;
+    }
+    if(state.jsonFile)
+    {
+      // NOTE: A failed worker still claims its offset, the blocks after it would wait for it forever otherwise
+      const uint64_t jsonOffset = state.jsonOffsets.claim(block, json.size());
+      written = state.jsonFile->writeAt(json.data(), json.size(), jsonOffset) && written;
+    }
+    if(!written)
+    {
+      state.failed = true;
+    }
+  }
+}
+
+// Generates the same files as the sequential loop in main, but every pair is drawn from its own counters, so the
+// pairs can be produced, formatted and written by any number of threads in any order. Blocks of
+// PARALLEL_BLOCK_SIZE pairs go to whichever thread is free, get formatted into that thread's buffer and are written
+// at their final offsets. The output and the expected sum are the same for every thread count.
+bool generateParallel(bool cluster, uint64_t seed, size_t pairCount, size_t threadCount, const OutputOptions& output,
+                      double& expectedSum, uint64_t& outputSize)
+{
+  ParallelGeneratorState state(cluster, seed, pairCount, output);
+  if((state.jsonFile && !state.jsonFile->isOpen()) || (state.pairFile && !state.pairFile->isOpen()) ||
+     !state.answersFile.isOpen())
+  {
+    std::cerr << "Error: Could not open the output files" << std::endl;
+    return false;
+  }
+
+  std::vector<std::thread> workers;
+  for(size_t threadIndex = 1U; threadIndex < threadCount; threadIndex++)
+  {
+    workers.emplace_back(generateBlocks, std::ref(state));
+  }
+  generateBlocks(state);
+  for(auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  bool written = !state.failed;
+  outputSize = 0U;
+  if(state.jsonFile)
+  {
+    const uint64_t jsonSize = state.jsonOffsets.end();
+    written = written && state.jsonFile->writeAt(JSON_HEADER.data(), JSON_HEADER.size(), 0U) &&
+              state.jsonFile->writeAt(JSON_TRAILER.data(), JSON_TRAILER.size(), jsonSize);
+    outputSize += jsonSize + JSON_TRAILER.size();
+  }
+  if(state.pairFile)
+  {
+    written = written && state.pairFile->writeHeader(seed, cluster ? PairDistribution::CLUSTER : PairDistribution::UNIFORM);
+    outputSize += sizeof(HaversinePairFileHeader) + pairCount * 4U * sizeof(double);
+  }
+  if(!written)
+  {
+    std::cerr << "Error: Could not write the output files" << std::endl;
+    return false;
+  }
+
+  // NOTE: Block by block in block order, the grouping doesn't depend on which thread did which block
+  expectedSum = 0.0;
+  for(double blockSum : state.blockSums)
+  {
+    expectedSum += blockSum;
+  }
+  return true;
+}
+
+void writePairFileBatch(PairFileWriter& pairFile, size_t firstPair,
+                        const std::vector<std::tuple<double, double, double, double>>& coordinates)
+{
+  std::vector<double> X0(coordinates.size()), Y0(coordinates.size()), X1(coordinates.size()), Y1(coordinates.size());
+  for(size_t coord = 0U; coord < coordinates.size(); coord++)
+  {
+    std::tie(X0[coord], Y0[coord], X1[coord], Y1[coord]) = coordinates[coord];
+  }
+  if(!pairFile.writeBlock(firstPair, X0.data(), Y0.data(), X1.data(), Y1.data(), coordinates.size()))
+  {
+    std::cerr << "Error: Could not write " << PAIR_FILE_NAME << std::endl;
+  }
+}
+
 int main(int argc, char* argv[]) {
 
-  if (argc != 4) {
+  if (argc < 4) {
     PrintUsage();
     return 1;
   }
 
   std::string option = argv[1];
   int randomSeed = std::stoi(argv[2]);
-  int numCoordinates = std::stoi(argv[3]);
+  size_t numCoordinates = std::stoull(argv[3]);
 
   if (option != "uniform" && option != "cluster") {
     PrintUsage();
     return 1;
   }
 
+  bool parallel = false;
+  OutputOptions output;
+  size_t threadCount = 1U;
+  for(int argIndex = 4; argIndex < argc; argIndex++)
+  {
+    const std::string flag = argv[argIndex];
+    const std::string prefix = "--threads=";
+    if(flag == "--shortest")
+    {
+      output.shortest = true;
+    }
+    else if(flag == "--format=json" || flag == "--format=hvb" || flag == "--format=both")
+    {
+      output.json = (flag != "--format=hvb");
+      output.pairFile = (flag != "--format=json");
+    }
+    else if(flag == "--layout=soa" || flag == "--layout=aos")
+    {
+      output.layout = (flag == "--layout=soa") ? PairLayout::SOA : PairLayout::AOS;
+    }
+    else if(flag.rfind(prefix, 0) == 0 && flag.size() > prefix.size() &&
+            flag.find_first_not_of("0123456789", prefix.size()) == std::string::npos)
+    {
+      parallel = true;
+      threadCount = std::stoull(flag.substr(prefix.size()));
+      if(threadCount == 0U)
+      {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+      }
+    }
+    else
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
   double expectedSum = 0.0;
   double sumCoefficient = 1.0 / numCoordinates;
 
+  if(parallel)
+  {
+    uint64_t outputSize = 0U;
+    const auto start = std::chrono::steady_clock::now();
+    deletePreviousFiles();
+    if(!generateParallel(option == "cluster", static_cast<uint64_t>(randomSeed), numCoordinates, threadCount, output,
+                         expectedSum, outputSize))
+    {
+      return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stdout, "Method: %s (counter-based, %zu threads)\n", option.c_str(), threadCount);
+    fprintf(stdout, "Random seed: %d\n", randomSeed);
+    fprintf(stdout, "Pair count: %zu\n", numCoordinates);
+    fprintf(stdout, "Expected sum: %s\n", FixedDouble(expectedSum, 16).text);
+    fprintf(stdout, "Generated %.3fmb in %.3fs (%.3f million pairs/s)\n", static_cast<double>(outputSize) / (1024.0 * 1024.0),
+            seconds, static_cast<double>(numCoordinates) / seconds / 1000000.0);
+    return 0;
+  }
+
   std::mt19937 RandomNumberGenerator(randomSeed);
   std::vector<std::tuple<double,double,double,double>> coordinates;
   std::vector<double> distances;
   coordinates.reserve(BATCH_SIZE + 10);
   distances.reserve(BATCH_SIZE + 10);
   deletePreviousFiles();
-  openJsonFile();
+  if(output.json)
+  {
+    openJsonFile();
+  }
+  std::unique_ptr<PairFileWriter> pairFile;
+  if(output.pairFile)
+  {
+    pairFile = std::make_unique<PairFileWriter>(PAIR_FILE_NAME, numCoordinates, output.layout);
+  }
 
   auto count = 0;
-  for (int genCoordNumber = 0; genCoordNumber < numCoordinates; genCoordNumber++)
+  for (size_t genCoordNumber = 0; genCoordNumber < numCoordinates; genCoordNumber++)
   {
       std::tuple<double,double,double,double> twoPointsCoord;
       twoPointsCoord = (option == "uniform") ? generateUniformCoordinate(RandomNumberGenerator):
@@ -204,7 +646,14 @@ int main(int argc, char* argv[]) {
 
     if ((genCoordNumber + 1) % BATCH_SIZE == 0 || genCoordNumber == numCoordinates - 1)
     {
-      writeCoordToFileInButches(coordinates, genCoordNumber == numCoordinates - 1);
+      if(output.json)
+      {
+        writeCoordToFileInButches(coordinates, genCoordNumber == numCoordinates - 1, output);
+      }
+      if(pairFile)
+      {
+        writePairFileBatch(*pairFile, genCoordNumber + 1 - coordinates.size(), coordinates);
+      }
       writeHaversineDistanceToFileBatchesBIN(distances);
       count += distances.size();
       coordinates.clear();
@@ -212,13 +661,21 @@ int main(int argc, char* argv[]) {
     }
 
   }
-  closeJsonFile();
-
+  if(output.json)
+  {
+    closeJsonFile();
+  }
+  if(pairFile && !pairFile->writeHeader(static_cast<uint64_t>(randomSeed),
+                                        option == "cluster" ? PairDistribution::CLUSTER : PairDistribution::UNIFORM))
+  {
+    std::cerr << "Error: Could not write " << PAIR_FILE_NAME << std::endl;
+    return 1;
+  }
 
   fprintf(stdout, "Method: %s\n", option.c_str());
   fprintf(stdout, "Random seed: %d\n", randomSeed);
-  fprintf(stdout, "Pair count: %d\n", numCoordinates);
-  fprintf(stdout, "Expected sum: %.16f\n", expectedSum);
+  fprintf(stdout, "Pair count: %zu\n", numCoordinates);
+  fprintf(stdout, "Expected sum: %s\n", FixedDouble(expectedSum, 16).text);
 
   return 0;
 }
\ No newline at end of file
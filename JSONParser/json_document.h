@@ -0,0 +1,156 @@
+#ifndef PERFAWARE_PROFILING_JSONPARSER_JSON_DOCUMENT_H_
+#define PERFAWARE_PROFILING_JSONPARSER_JSON_DOCUMENT_H_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "json_parser.h"
+
+// One value of a JSONDocument. The children of an array or object are stored next to each other in the document's
+// arena, an object's as key/value node pairs, so a container is just the index of its first child and a count.
+struct JSONDocumentNode
+{
+  JSONType type;
+  uint32_t count; // string length, array element count or object member count
+  union
+  {
+    double number;
+    bool boolean;
+    size_t first; // string: offset into the source, array/object: arena index of the first child
+  };
+};
+static_assert(sizeof(JSONDocumentNode) == 16u, "JSONDocumentNode is meant to stay 16 bytes");
+
+// Arena-backed alternative to the JSONNode tree: all nodes live in one vector and strings are views into the source
+// buffer, which has to outlive the document. Escape sequences are left as they are, like JSONParser::parse does.
+// Freeing the document is a single deallocation however many values it holds.
+class JSONDocument
+{
+ public:
+  class ArrayRange;
+
+  // A read-only handle to one node, cheap to copy. Accessors throw std::runtime_error on a type mismatch, like
+  // JSONNode's.
+  class Element
+  {
+   public:
+    Element(const JSONDocument* document, const JSONDocumentNode* node) : _document(document), _node(node) {}
+
+    [[nodiscard]] JSONType type() const { return _node->type; }
+
+    // Missing keys give a NULLT element
+    Element operator[](std::string_view key) const
+    {
+      requireType(JSONType::OBJECT);
+      const JSONDocumentNode* member{_document->_nodes.data() + _node->first};
+      for(uint32_t memberIndex{0u}; memberIndex < _node->count; memberIndex++, member += 2)
+      {
+        if(_document->text(*member) == key)
+        {
+          return {_document, member + 1};
+        }
+      }
+      return {_document, &NULL_NODE};
+    }
+
+    [[nodiscard]] ArrayRange getArray() const
+    {
+      requireType(JSONType::ARRAY);
+      return {_document, _document->_nodes.data() + _node->first, _node->count};
+    }
+
+    template<typename type>
+    [[nodiscard]] type get() const
+    {
+      if constexpr(std::is_same_v<type, double>)
+      {
+        requireType(JSONType::NUMBER);
+        return _node->number;
+      }
+      else if constexpr(std::is_same_v<type, bool>)
+      {
+        requireType(JSONType::BOOL);
+        return _node->boolean;
+      }
+      else
+      {
+        static_assert(std::is_same_v<type, std::string_view> || std::is_same_v<type, std::string>,
+                      "JSONDocument values are double, bool or strings");
+        requireType(JSONType::STRING);
+        return type(_document->text(*_node));
+      }
+    }
+
+   private:
+    void requireType(JSONType expected) const
+    {
+      if(_node->type != expected)
+      {
+        throw std::runtime_error("Invalid type");
+      }
+    }
+
+    const JSONDocument* _document;
+    const JSONDocumentNode* _node;
+  };
+
+  class ArrayRange
+  {
+   public:
+    class Iterator
+    {
+     public:
+      Iterator(const JSONDocument* document, const JSONDocumentNode* node) : _document(document), _node(node) {}
+
+      Element operator*() const { return {_document, _node}; }
+      Iterator& operator++()
+      {
+        _node++;
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const { return _node != other._node; }
+
+     private:
+      const JSONDocument* _document;
+      const JSONDocumentNode* _node;
+    };
+
+    ArrayRange(const JSONDocument* document, const JSONDocumentNode* first, size_t count)
+      : _document(document), _first(first), _count(count) {}
+
+    [[nodiscard]] size_t size() const { return _count; }
+    [[nodiscard]] bool empty() const { return _count == 0u; }
+    Element operator[](size_t index) const { return {_document, _first + index}; }
+    [[nodiscard]] Iterator begin() const { return {_document, _first}; }
+    [[nodiscard]] Iterator end() const { return {_document, _first + _count}; }
+
+   private:
+    const JSONDocument* _document;
+    const JSONDocumentNode* _first;
+    size_t _count;
+  };
+
+  // Returns a document whose root is NULLT when the input is not valid JSON
+  static JSONDocument parse(std::string_view json);
+
+  // NOTE: Elements point into the arena, so they are invalidated when the document is moved or destroyed
+  [[nodiscard]] Element root() const { return {this, _nodes.empty() ? &NULL_NODE : &_nodes.back()}; }
+
+  [[nodiscard]] size_t nodeCount() const { return _nodes.size(); }
+  [[nodiscard]] size_t byteCount() const { return _nodes.size() * sizeof(JSONDocumentNode); }
+
+ private:
+  static inline const JSONDocumentNode NULL_NODE{JSONType::NULLT, 0u, {0.0}};
+
+  [[nodiscard]] std::string_view text(const JSONDocumentNode& node) const { return _source.substr(node.first, node.count); }
+
+  std::string_view _source;
+  // NOTE: Every container's children come before it and the root is the last node
+  std::vector<JSONDocumentNode> _nodes;
+};
+
+#endif //PERFAWARE_PROFILING_JSONPARSER_JSON_DOCUMENT_H_
@@ -0,0 +1,252 @@
+#ifndef PERFAWARE_PROFILING_JSONPARSER_JSON_LEXER_H_
+#define PERFAWARE_PROFILING_JSONPARSER_JSON_LEXER_H_
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "json_structural_index.h"
+
+enum class JSONTokenType : uint8_t
+{
+  OPEN_OBJECT,
+  CLOSE_OBJECT,
+  OPEN_ARRAY,
+  CLOSE_ARRAY,
+  COLON,
+  COMMA,
+  STRING,
+  NUMBER,
+  TRUE,
+  FALSE,
+  NULLT,
+  END,
+  INVALID
+};
+
+// A token never owns text - it is a (type, offset, length) view into the buffer the lexer was built on.
+// For STRING tokens the range excludes the surrounding quotes and escape sequences are left as they are.
+struct JSONToken
+{
+  size_t offset;
+  uint32_t length;
+  JSONTokenType type;
+};
+
+class JSONLexer
+{
+ public:
+  explicit JSONLexer(std::string_view json) : _json(json) {}
+
+  // NOTE: With a structural kernel the lexer jumps from one indexed position to the next instead of scanning for
+  // tokens. Same tokens either way for valid JSON.
+  JSONLexer(std::string_view json, StructuralKernel kernel) : _json(json), _indexer(std::in_place, json, kernel)
+  {
+  }
+
+  [[nodiscard]] std::string_view text(const JSONToken& token) const { return _json.substr(token.offset, token.length); }
+  [[nodiscard]] size_t position() const { return _position; }
+
+  JSONToken next()
+  {
+    if(_indexer)
+    {
+      return nextIndexed();
+    }
+
+    skipWhiteSpace();
+
+    if(_position >= _json.size())
+    {
+      return {_position, 0u, JSONTokenType::END};
+    }
+
+    const size_t start{_position};
+    switch(_json[_position])
+    {
+      case '{': return punctuation(JSONTokenType::OPEN_OBJECT);
+      case '}': return punctuation(JSONTokenType::CLOSE_OBJECT);
+      case '[': return punctuation(JSONTokenType::OPEN_ARRAY);
+      case ']': return punctuation(JSONTokenType::CLOSE_ARRAY);
+      case ':': return punctuation(JSONTokenType::COLON);
+      case ',': return punctuation(JSONTokenType::COMMA);
+      case '\"': return string();
+      case 't': return literal("true", JSONTokenType::TRUE);
+      case 'f': return literal("false", JSONTokenType::FALSE);
+      case 'n': return literal("null", JSONTokenType::NULLT);
+      default: break;
+    }
+
+    if(isNumberCharacter(_json[_position]))
+    {
+      while(_position < _json.size() && isNumberCharacter(_json[_position]))
+      {
+        _position++;
+      }
+      return {start, static_cast<uint32_t>(_position - start), JSONTokenType::NUMBER};
+    }
+
+    return {start, 1u, JSONTokenType::INVALID};
+  }
+
+ private:
+  static bool isNumberCharacter(char c)
+  {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+  }
+
+  static bool isWhiteSpace(char c)
+  {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+  }
+
+  // NOTE: Refills the position buffer from the indexer once it runs dry
+  bool peekPosition(size_t& position)
+  {
+    while(_nextPosition >= _positionCount)
+    {
+      if(_indexer->done())
+      {
+        return false;
+      }
+      _positionCount = _indexer->nextBatch(_positions);
+      _nextPosition = 0u;
+    }
+
+    position = _positions[_nextPosition];
+    return true;
+  }
+
+  bool nextPosition(size_t& position)
+  {
+    if(!peekPosition(position))
+    {
+      return false;
+    }
+    _nextPosition++;
+    return true;
+  }
+
+  JSONToken nextIndexed()
+  {
+    if(!nextPosition(_position))
+    {
+      _position = _json.size();
+      return {_position, 0u, JSONTokenType::END};
+    }
+
+    const size_t start{_position};
+    switch(_json[_position])
+    {
+      case '{': return punctuation(JSONTokenType::OPEN_OBJECT);
+      case '}': return punctuation(JSONTokenType::CLOSE_OBJECT);
+      case '[': return punctuation(JSONTokenType::OPEN_ARRAY);
+      case ']': return punctuation(JSONTokenType::CLOSE_ARRAY);
+      case ':': return punctuation(JSONTokenType::COLON);
+      case ',': return punctuation(JSONTokenType::COMMA);
+      case '\"':
+      {
+        // NOTE: Nothing inside a string is indexed, so the next position is its closing quote
+        size_t closingQuote;
+        if(!nextPosition(closingQuote))
+        {
+          return {start, 1u, JSONTokenType::INVALID};
+        }
+        _position = closingQuote + 1u;
+        return {start + 1u, static_cast<uint32_t>(_position - start - 2u), JSONTokenType::STRING};
+      }
+      default: break;
+    }
+
+    // NOTE: Only the start of a number/literal is indexed. It runs up to the next position minus any whitespace in
+    // between, which is never more than a character or two, so the scalar itself is never scanned. The run can't
+    // contain whitespace, a quote or {}[]:, (those would have started a new position) but anything else is taken
+    // as part of it - "1x" is one NUMBER that fails to convert where the plain lexer gives NUMBER then INVALID.
+    size_t end;
+    if(!peekPosition(end))
+    {
+      end = _json.size();
+    }
+    while(end > start && isWhiteSpace(_json[end - 1u]))
+    {
+      end--;
+    }
+    _position = end;
+
+    const std::string_view scalar{_json.substr(start, end - start)};
+    switch(scalar[0])
+    {
+      case 't': return indexedLiteral(scalar, "true", start, JSONTokenType::TRUE);
+      case 'f': return indexedLiteral(scalar, "false", start, JSONTokenType::FALSE);
+      case 'n': return indexedLiteral(scalar, "null", start, JSONTokenType::NULLT);
+      default: break;
+    }
+
+    if(!isNumberCharacter(scalar[0]))
+    {
+      return {start, 1u, JSONTokenType::INVALID};
+    }
+    return {start, static_cast<uint32_t>(scalar.size()), JSONTokenType::NUMBER};
+  }
+
+  static JSONToken indexedLiteral(std::string_view scalar, std::string_view word, size_t start, JSONTokenType type)
+  {
+    if(scalar != word)
+    {
+      return {start, 1u, JSONTokenType::INVALID};
+    }
+    return {start, static_cast<uint32_t>(word.size()), type};
+  }
+
+  void skipWhiteSpace()
+  {
+    while(_position < _json.size() && isWhiteSpace(_json[_position]))
+    {
+      _position++;
+    }
+  }
+
+  JSONToken punctuation(JSONTokenType type)
+  {
+    return {_position++, 1u, type};
+  }
+
+  JSONToken string()
+  {
+    const size_t start{++_position};
+    while(_position < _json.size() && _json[_position] != '\"')
+    {
+      // NOTE: Skip whatever follows a backslash so an escaped quote does not end the string.
+      _position += (_json[_position] == '\\') ? 2u : 1u;
+    }
+
+    if(_position >= _json.size())
+    {
+      return {start - 1u, 1u, JSONTokenType::INVALID};
+    }
+
+    return {start, static_cast<uint32_t>(_position++ - start), JSONTokenType::STRING};
+  }
+
+  JSONToken literal(std::string_view word, JSONTokenType type)
+  {
+    const size_t start{_position};
+    if(_json.compare(_position, word.size(), word) != 0)
+    {
+      return {start, 1u, JSONTokenType::INVALID};
+    }
+
+    _position += word.size();
+    return {start, static_cast<uint32_t>(word.size()), type};
+  }
+
+  std::string_view _json;
+  size_t _position{0u};
+
+  std::optional<JSONStructuralIndexer> _indexer;
+  size_t _positions[STRUCTURAL_BATCH_SIZE];
+  size_t _positionCount{0u};
+  size_t _nextPosition{0u};
+};
+
+#endif //PERFAWARE_PROFILING_JSONPARSER_JSON_LEXER_H_
@@ -0,0 +1,718 @@
+#include "json_number.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "integer_intrinsics.h"
+
+static constexpr int MIN_FAST_EXPONENT{-22};
+static constexpr int MAX_FAST_EXPONENT{22};
+static constexpr uint64_t MAX_EXACT_MANTISSA{uint64_t(1) << 53};
+
+// NOTE: Exactly representable powers of ten, used by the exact (Clinger) case
+static constexpr double EXACT_POWERS_OF_TEN[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// NOTE: 10^q normalized to [2^127, 2^128) and truncated, as {high, low} 64 bit halves, for q in [-22, 22]
+struct PowerOfTenMantissa
+{
+  uint64_t high;
+  uint64_t low;
+};
+
+static constexpr PowerOfTenMantissa POWER_OF_TEN_MANTISSAS[] = {
+  {0xF1C90080BAF72CB1ULL, 0x5324C68B12DD6338ULL}, // 1e-22
+  {0x971DA05074DA7BEEULL, 0xD3F6FC16EBCA5E03ULL}, // 1e-21
+  {0xBCE5086492111AEAULL, 0x88F4BB1CA6BCF584ULL}, // 1e-20
+  {0xEC1E4A7DB69561A5ULL, 0x2B31E9E3D06C32E5ULL}, // 1e-19
+  {0x9392EE8E921D5D07ULL, 0x3AFF322E62439FCFULL}, // 1e-18
+  {0xB877AA3236A4B449ULL, 0x09BEFEB9FAD487C2ULL}, // 1e-17
+  {0xE69594BEC44DE15BULL, 0x4C2EBE687989A9B3ULL}, // 1e-16
+  {0x901D7CF73AB0ACD9ULL, 0x0F9D37014BF60A10ULL}, // 1e-15
+  {0xB424DC35095CD80FULL, 0x538484C19EF38C94ULL}, // 1e-14
+  {0xE12E13424BB40E13ULL, 0x2865A5F206B06FB9ULL}, // 1e-13
+  {0x8CBCCC096F5088CBULL, 0xF93F87B7442E45D3ULL}, // 1e-12
+  {0xAFEBFF0BCB24AAFEULL, 0xF78F69A51539D748ULL}, // 1e-11
+  {0xDBE6FECEBDEDD5BEULL, 0xB573440E5A884D1BULL}, // 1e-10
+  {0x89705F4136B4A597ULL, 0x31680A88F8953030ULL}, // 1e-9
+  {0xABCC77118461CEFCULL, 0xFDC20D2B36BA7C3DULL}, // 1e-8
+  {0xD6BF94D5E57A42BCULL, 0x3D32907604691B4CULL}, // 1e-7
+  {0x8637BD05AF6C69B5ULL, 0xA63F9A49C2C1B10FULL}, // 1e-6
+  {0xA7C5AC471B478423ULL, 0x0FCF80DC33721D53ULL}, // 1e-5
+  {0xD1B71758E219652BULL, 0xD3C36113404EA4A8ULL}, // 1e-4
+  {0x83126E978D4FDF3BULL, 0x645A1CAC083126E9ULL}, // 1e-3
+  {0xA3D70A3D70A3D70AULL, 0x3D70A3D70A3D70A3ULL}, // 1e-2
+  {0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL}, // 1e-1
+  {0x8000000000000000ULL, 0x0000000000000000ULL}, // 1e0
+  {0xA000000000000000ULL, 0x0000000000000000ULL}, // 1e1
+  {0xC800000000000000ULL, 0x0000000000000000ULL}, // 1e2
+  {0xFA00000000000000ULL, 0x0000000000000000ULL}, // 1e3
+  {0x9C40000000000000ULL, 0x0000000000000000ULL}, // 1e4
+  {0xC350000000000000ULL, 0x0000000000000000ULL}, // 1e5
+  {0xF424000000000000ULL, 0x0000000000000000ULL}, // 1e6
+  {0x9896800000000000ULL, 0x0000000000000000ULL}, // 1e7
+  {0xBEBC200000000000ULL, 0x0000000000000000ULL}, // 1e8
+  {0xEE6B280000000000ULL, 0x0000000000000000ULL}, // 1e9
+  {0x9502F90000000000ULL, 0x0000000000000000ULL}, // 1e10
+  {0xBA43B74000000000ULL, 0x0000000000000000ULL}, // 1e11
+  {0xE8D4A51000000000ULL, 0x0000000000000000ULL}, // 1e12
+  {0x9184E72A00000000ULL, 0x0000000000000000ULL}, // 1e13
+  {0xB5E620F480000000ULL, 0x0000000000000000ULL}, // 1e14
+  {0xE35FA931A0000000ULL, 0x0000000000000000ULL}, // 1e15
+  {0x8E1BC9BF04000000ULL, 0x0000000000000000ULL}, // 1e16
+  {0xB1A2BC2EC5000000ULL, 0x0000000000000000ULL}, // 1e17
+  {0xDE0B6B3A76400000ULL, 0x0000000000000000ULL}, // 1e18
+  {0x8AC7230489E80000ULL, 0x0000000000000000ULL}, // 1e19
+  {0xAD78EBC5AC620000ULL, 0x0000000000000000ULL}, // 1e20
+  {0xD8D726B7177A8000ULL, 0x0000000000000000ULL}, // 1e21
+  {0x878678326EAC9000ULL, 0x0000000000000000ULL}, // 1e22
+};
+
+static bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool isEightDigits(uint64_t chunk)
+{
+  return ((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+
+// NOTE: Little-endian SWAR: combines 8 ASCII digits pairwise into 2, 4 and finally 8 digit numbers
+static uint32_t parseEightDigits(uint64_t chunk)
+{
+  chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561u) >> 8;
+  chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601u) >> 16;
+  return static_cast<uint32_t>(((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+static uint64_t loadEightBytes(const char* at)
+{
+  uint64_t chunk;
+  std::memcpy(&chunk, at, sizeof(chunk));
+  return chunk;
+}
+
+// strtod needs a terminated copy of the number. Numbers too long for the stack buffer - long mantissas, many leading
+// zeros - are rare but valid, they get a heap copy.
+static bool slowPath(const char* first, const char* last, double& value)
+{
+  char buffer[128];
+  std::string longNumber;
+  const size_t length{static_cast<size_t>(last - first)};
+  char* text{buffer};
+  if(length < sizeof(buffer))
+  {
+    std::memcpy(buffer, first, length);
+    buffer[length] = '\0';
+  }
+  else
+  {
+    longNumber.assign(first, length);
+    text = longNumber.data();
+  }
+
+  char* end{nullptr};
+  value = std::strtod(text, &end);
+  return end == text + length;
+}
+
+// NOTE: Eisel-Lemire with a 128 bit power of ten. Returns false when the truncated product can't decide the
+// rounding, the caller then takes the slow path. See Lemire, "Number Parsing at a Gigabyte per Second".
+static bool eiselLemire(uint64_t mantissa, int exponent, bool negative, double& value)
+{
+  if(mantissa == 0u)
+  {
+    value = negative ? -0.0 : 0.0;
+    return true;
+  }
+
+  const PowerOfTenMantissa factor{POWER_OF_TEN_MANTISSAS[exponent - MIN_FAST_EXPONENT]};
+  const int64_t binaryExponent{(((152170 + 65536) * static_cast<int64_t>(exponent)) >> 16) + 1024 + 63};
+
+  int leadingZeros{leadingZeros64(mantissa)};
+  mantissa <<= leadingZeros;
+
+  const UInt128 product{multiply64x64(mantissa, factor.high)};
+  uint64_t lower{product.low};
+  uint64_t upper{product.high};
+
+  // NOTE: The bits below the result are all ones and the truncated low half of the power could still carry into
+  // them. Decimals printed from a double land here often, they sit right next to a representable value.
+  if((upper & 0x1FFu) == 0x1FFu && lower + mantissa < lower)
+  {
+    const UInt128 lowProduct{multiply64x64(mantissa, factor.low)};
+    const uint64_t productLow{lowProduct.low};
+    const uint64_t productMiddle{lower + lowProduct.high};
+    upper += (productMiddle < lower) ? 1u : 0u;
+
+    if(productMiddle + 1u == 0u && (upper & 0x1FFu) == 0x1FFu && productLow + mantissa < productLow)
+    {
+      return false;
+    }
+    lower = productMiddle;
+  }
+
+  const uint64_t upperBit{upper >> 63};
+  uint64_t result{upper >> (upperBit + 9)};
+  leadingZeros += static_cast<int>(1u ^ upperBit);
+
+  if(lower == 0u && (upper & 0x1FFu) == 0u && (result & 3u) == 1u)
+  {
+    return false;
+  }
+
+  result += result & 1u;
+  result >>= 1;
+  if(result >= MAX_EXACT_MANTISSA)
+  {
+    result = MAX_EXACT_MANTISSA >> 1;
+    leadingZeros--;
+  }
+  result &= ~(MAX_EXACT_MANTISSA >> 1);
+
+  const int64_t realExponent{binaryExponent - leadingZeros};
+  if(realExponent < 1 || realExponent > 2046)
+  {
+    return false;
+  }
+
+  result |= static_cast<uint64_t>(realExponent) << 52;
+  result |= static_cast<uint64_t>(negative) << 63;
+  std::memcpy(&value, &result, sizeof(value));
+  return true;
+}
+
+static bool convert(uint64_t mantissa, int exponent, bool negative, double& value)
+{
+  if(mantissa <= MAX_EXACT_MANTISSA)
+  {
+    // NOTE: Both operands are exact, so the single rounding of the multiply/divide is the correct one
+    double result{static_cast<double>(mantissa)};
+    result = (exponent < 0) ? result / EXACT_POWERS_OF_TEN[-exponent] : result * EXACT_POWERS_OF_TEN[exponent];
+    value = negative ? -result : result;
+    return true;
+  }
+
+  return eiselLemire(mantissa, exponent, negative, value);
+}
+
+bool parseDouble(const char* first, const char* last, double& value)
+{
+  const char* at{first};
+  const bool negative{at < last && *at == '-'};
+  at += negative ? 1 : 0;
+
+  uint64_t mantissa{0u};
+  const char* integerStart{at};
+  while(at < last && isDigit(*at))
+  {
+    mantissa = mantissa * 10u + static_cast<uint64_t>(*at - '0');
+    at++;
+  }
+  size_t digitCount{static_cast<size_t>(at - integerStart)};
+
+  int exponent{0};
+  if(at < last && *at == '.')
+  {
+    at++;
+    const char* fractionStart{at};
+
+    // NOTE: The generator's fixed format - 16 fractional digits read as two 8 digit chunks
+    if(digitCount <= 3u && last - at >= 16 && isEightDigits(loadEightBytes(at)) && isEightDigits(loadEightBytes(at + 8)) &&
+       (last - at == 16 || !isDigit(at[16])))
+    {
+      mantissa = mantissa * 10000000000000000ULL + parseEightDigits(loadEightBytes(at)) * 100000000ULL +
+                 parseEightDigits(loadEightBytes(at + 8));
+      at += 16;
+    }
+    else
+    {
+      while(at < last && isDigit(*at))
+      {
+        mantissa = mantissa * 10u + static_cast<uint64_t>(*at - '0');
+        at++;
+      }
+    }
+
+    exponent = -static_cast<int>(at - fractionStart);
+    digitCount += static_cast<size_t>(at - fractionStart);
+  }
+
+  if(digitCount == 0u)
+  {
+    return false;
+  }
+
+  if(at < last && (*at == 'e' || *at == 'E'))
+  {
+    at++;
+    const bool negativeExponent{at < last && *at == '-'};
+    at += (at < last && (*at == '-' || *at == '+')) ? 1 : 0;
+
+    const char* exponentStart{at};
+    int explicitExponent{0};
+    while(at < last && isDigit(*at))
+    {
+      if(explicitExponent < 100000)
+      {
+        explicitExponent = explicitExponent * 10 + (*at - '0');
+      }
+      at++;
+    }
+
+    if(at == exponentStart)
+    {
+      return false;
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if(at != last)
+  {
+    return false;
+  }
+
+  // NOTE: Leading zeros don't count towards the 19 digits that fit in 64 bits
+  size_t significantDigits{digitCount};
+  for(const char* digit{integerStart}; digit < last && (*digit == '0' || *digit == '.') && significantDigits > 1u; digit++)
+  {
+    significantDigits -= (*digit == '0') ? 1u : 0u;
+  }
+
+  if(significantDigits <= 19u && exponent >= MIN_FAST_EXPONENT && exponent <= MAX_FAST_EXPONENT &&
+     convert(mantissa, exponent, negative, value))
+  {
+    return true;
+  }
+
+  return slowPath(first, last, value);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Formatting
+
+static constexpr uint64_t POWERS_OF_TEN[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+  10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+  10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static constexpr char DIGIT_PAIRS[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static int countDigits(uint64_t value)
+{
+  int count{1};
+  while(count < 20 && value >= POWERS_OF_TEN[count])
+  {
+    count++;
+  }
+  return count;
+}
+
+// Writes exactly digitCount digits of value to out, zero padded on the left, two at a time from the end
+static void writeDigits(uint64_t value, int digitCount, char* out)
+{
+  char* at{out + digitCount};
+  for(; digitCount >= 2; digitCount -= 2)
+  {
+    at -= 2;
+    std::memcpy(at, DIGIT_PAIRS + (value % 100u) * 2u, 2u);
+    value /= 100u;
+  }
+  if(digitCount == 1)
+  {
+    *--at = static_cast<char>('0' + value % 10u);
+  }
+}
+
+// The double as mantissa * 2^exponent, with the hidden bit made explicit
+struct DecodedDouble
+{
+  uint64_t mantissa;
+  int exponent;
+  bool negative;
+  bool finite;
+};
+
+static DecodedDouble decode(double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint64_t fraction{bits & ((uint64_t(1) << 52) - 1u)};
+  const int biasedExponent{static_cast<int>((bits >> 52) & 0x7FFu)};
+
+  DecodedDouble decoded{};
+  decoded.negative = (bits >> 63) != 0u;
+  decoded.finite = biasedExponent != 0x7FF;
+  decoded.mantissa = (biasedExponent == 0) ? fraction : (fraction | (uint64_t(1) << 52));
+  decoded.exponent = (biasedExponent == 0) ? -1074 : biasedExponent - 1075;
+  return decoded;
+}
+
+static char* formatWithPrintf(const char* format, int precision, double value, char* out)
+{
+  char text[MAX_FORMATTED_DOUBLE_LENGTH + 1u];
+  const int length{std::snprintf(text, sizeof(text), format, precision, value)};
+  const size_t written{std::min(static_cast<size_t>(length), sizeof(text) - 1u)};
+  std::memcpy(out, text, written);
+  return out + written;
+}
+
+char* formatFixed(double value, int precision, char* out)
+{
+  const DecodedDouble decoded{decode(value)};
+
+  // NOTE: mantissa * 10^precision < 2^117, so the scaled value fits 128 bits as long as the exponent stays <= 10.
+  // Larger values (above 2^63) and non-finite ones are rare enough to leave to printf.
+  if(!decoded.finite || decoded.exponent > 10 || precision < 0 || precision > MAX_FIXED_PRECISION)
+  {
+    return formatWithPrintf("%.*f", precision, value, out);
+  }
+
+  // value * 10^precision, rounded to an integer half to even like printf - exact, no intermediate double rounding
+  const UInt128 scaled{multiply64x64(decoded.mantissa, POWERS_OF_TEN[precision])};
+  UInt128 rounded{0u, 0u};
+  if(decoded.exponent >= 0)
+  {
+    rounded = shiftLeft128(scaled, decoded.exponent);
+  }
+  else if(decoded.exponent > -118)
+  {
+    // NOTE: The dropped bits are above half when the half bit is set and any below it is, exactly half without them
+    const int shift{-decoded.exponent};
+    const bool halfBit{(shiftRight128(scaled, shift - 1).low & 1u) != 0u};
+    const UInt128 belowHalf{shift > 1 ? shiftLeft128(scaled, 129 - shift) : UInt128{0u, 0u}};
+    rounded = shiftRight128(scaled, shift);
+    if(halfBit && ((belowHalf.high | belowHalf.low) != 0u || (rounded.low & 1u) != 0u))
+    {
+      rounded.low++;
+      rounded.high += (rounded.low == 0u) ? 1u : 0u;
+    }
+  }
+  // NOTE: Below 2^-117 the scaled value is under 2^116 / 2^117 = 1/2, which rounds to 0
+
+  // NOTE: value < 2^63, so the integer part always fits 64 bits. The division by a constant stays 64 bit for the
+  // common case of a scaled value under 2^64.
+  uint64_t integerPart;
+  uint64_t fractionPart;
+  if(rounded.high == 0u)
+  {
+    integerPart = rounded.low / POWERS_OF_TEN[precision];
+    fractionPart = rounded.low % POWERS_OF_TEN[precision];
+  }
+  else
+  {
+    integerPart = divide128By64(rounded, POWERS_OF_TEN[precision], fractionPart);
+  }
+
+  // NOTE: printf keeps the sign of values that round to zero, "-0.00"
+  if(decoded.negative)
+  {
+    *out++ = '-';
+  }
+  const int integerDigits{countDigits(integerPart)};
+  writeDigits(integerPart, integerDigits, out);
+  out += integerDigits;
+  if(precision > 0)
+  {
+    *out++ = '.';
+    writeDigits(fractionPart, precision, out);
+    out += precision;
+  }
+  return out;
+}
+
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010). Works on 64 bit
+// "do-it-yourself" floats f * 2^e scaled by a cached power of ten into a range where the digits come out of integer
+// division. The digits always lie inside the value's rounding interval, so they read back to the same double; they
+// are the shortest such digits for all but about 0.1% of values, which get one more.
+struct DiyFloat
+{
+  uint64_t f;
+  int e;
+};
+
+static DiyFloat subtract(DiyFloat x, DiyFloat y)
+{
+  return {x.f - y.f, x.e};
+}
+
+// Upper 64 bits of the 128 bit product, rounded
+static DiyFloat multiply(DiyFloat x, DiyFloat y)
+{
+  const UInt128 product{multiply64x64(x.f, y.f)};
+  const uint64_t roundBit{(product.low >> 63) & 1u};
+  return {product.high + roundBit, x.e + y.e + 64};
+}
+
+static DiyFloat normalize(DiyFloat x)
+{
+  const int shift{leadingZeros64(x.f)};
+  return {x.f << shift, x.e - shift};
+}
+
+struct CachedPower
+{
+  uint64_t f;
+  int e;
+  int k;
+};
+
+// NOTE: 10^k normalized to [2^63, 2^64) and rounded, for k = -300, -292, ..., 324
+static constexpr int CACHED_POWERS_MIN_EXPONENT{-300};
+static constexpr int CACHED_POWERS_STEP{8};
+static constexpr CachedPower CACHED_POWERS[] = {
+  {0xAB70FE17C79AC6CAULL, -1060, -300},
+  {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+  {0xBE5691EF416BD60CULL, -1007, -284},
+  {0x8DD01FAD907FFC3CULL, -980, -276},
+  {0xD3515C2831559A83ULL, -954, -268},
+  {0x9D71AC8FADA6C9B5ULL, -927, -260},
+  {0xEA9C227723EE8BCBULL, -901, -252},
+  {0xAECC49914078536DULL, -874, -244},
+  {0x823C12795DB6CE57ULL, -847, -236},
+  {0xC21094364DFB5637ULL, -821, -228},
+  {0x9096EA6F3848984FULL, -794, -220},
+  {0xD77485CB25823AC7ULL, -768, -212},
+  {0xA086CFCD97BF97F4ULL, -741, -204},
+  {0xEF340A98172AACE5ULL, -715, -196},
+  {0xB23867FB2A35B28EULL, -688, -188},
+  {0x84C8D4DFD2C63F3BULL, -661, -180},
+  {0xC5DD44271AD3CDBAULL, -635, -172},
+  {0x936B9FCEBB25C996ULL, -608, -164},
+  {0xDBAC6C247D62A584ULL, -582, -156},
+  {0xA3AB66580D5FDAF6ULL, -555, -148},
+  {0xF3E2F893DEC3F126ULL, -529, -140},
+  {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+  {0x87625F056C7C4A8BULL, -475, -124},
+  {0xC9BCFF6034C13053ULL, -449, -116},
+  {0x964E858C91BA2655ULL, -422, -108},
+  {0xDFF9772470297EBDULL, -396, -100},
+  {0xA6DFBD9FB8E5B88FULL, -369, -92},
+  {0xF8A95FCF88747D94ULL, -343, -84},
+  {0xB94470938FA89BCFULL, -316, -76},
+  {0x8A08F0F8BF0F156BULL, -289, -68},
+  {0xCDB02555653131B6ULL, -263, -60},
+  {0x993FE2C6D07B7FACULL, -236, -52},
+  {0xE45C10C42A2B3B06ULL, -210, -44},
+  {0xAA242499697392D3ULL, -183, -36},
+  {0xFD87B5F28300CA0EULL, -157, -28},
+  {0xBCE5086492111AEBULL, -130, -20},
+  {0x8CBCCC096F5088CCULL, -103, -12},
+  {0xD1B71758E219652CULL, -77, -4},
+  {0x9C40000000000000ULL, -50, 4},
+  {0xE8D4A51000000000ULL, -24, 12},
+  {0xAD78EBC5AC620000ULL, 3, 20},
+  {0x813F3978F8940984ULL, 30, 28},
+  {0xC097CE7BC90715B3ULL, 56, 36},
+  {0x8F7E32CE7BEA5C70ULL, 83, 44},
+  {0xD5D238A4ABE98068ULL, 109, 52},
+  {0x9F4F2726179A2245ULL, 136, 60},
+  {0xED63A231D4C4FB27ULL, 162, 68},
+  {0xB0DE65388CC8ADA8ULL, 189, 76},
+  {0x83C7088E1AAB65DBULL, 216, 84},
+  {0xC45D1DF942711D9AULL, 242, 92},
+  {0x924D692CA61BE758ULL, 269, 100},
+  {0xDA01EE641A708DEAULL, 295, 108},
+  {0xA26DA3999AEF774AULL, 322, 116},
+  {0xF209787BB47D6B85ULL, 348, 124},
+  {0xB454E4A179DD1877ULL, 375, 132},
+  {0x865B86925B9BC5C2ULL, 402, 140},
+  {0xC83553C5C8965D3DULL, 428, 148},
+  {0x952AB45CFA97A0B3ULL, 455, 156},
+  {0xDE469FBD99A05FE3ULL, 481, 164},
+  {0xA59BC234DB398C25ULL, 508, 172},
+  {0xF6C69A72A3989F5CULL, 534, 180},
+  {0xB7DCBF5354E9BECEULL, 561, 188},
+  {0x88FCF317F22241E2ULL, 588, 196},
+  {0xCC20CE9BD35C78A5ULL, 614, 204},
+  {0x98165AF37B2153DFULL, 641, 212},
+  {0xE2A0B5DC971F303AULL, 667, 220},
+  {0xA8D9D1535CE3B396ULL, 694, 228},
+  {0xFB9B7CD9A4A7443CULL, 720, 236},
+  {0xBB764C4CA7A44410ULL, 747, 244},
+  {0x8BAB8EEFB6409C1AULL, 774, 252},
+  {0xD01FEF10A657842CULL, 800, 260},
+  {0x9B10A4E5E9913129ULL, 827, 268},
+  {0xE7109BFBA19C0C9DULL, 853, 276},
+  {0xAC2820D9623BF429ULL, 880, 284},
+  {0x80444B5E7AA7CF85ULL, 907, 292},
+  {0xBF21E44003ACDD2DULL, 933, 300},
+  {0x8E679C2F5E44FF8FULL, 960, 308},
+  {0xD433179D9C8CB841ULL, 986, 316},
+  {0x9E19DB92B4E31BA9ULL, 1013, 324},
+};
+
+// NOTE: Scaling brings the binary exponent into [-60, -32], which keeps the integer part within 32 bits for the digit
+// loop. The step of 8 in the table is what that range allows.
+static constexpr int MIN_TARGET_EXPONENT{-60};
+
+static CachedPower cachedPowerFor(int binaryExponent)
+{
+  // NOTE: ceil((MIN_TARGET_EXPONENT - e - 1) * log10(2)), 78913 / 2^18 being log10(2) to enough bits
+  const int f{MIN_TARGET_EXPONENT - binaryExponent - 1};
+  const int k{(f * 78913) / (1 << 18) + (f > 0 ? 1 : 0)};
+  const int index{(k - CACHED_POWERS_MIN_EXPONENT + CACHED_POWERS_STEP - 1) / CACHED_POWERS_STEP};
+  return CACHED_POWERS[index];
+}
+
+// Moves the last digit down while that brings the digits closer to w and keeps them inside the interval
+static void roundLastDigit(char* digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t tenK)
+{
+  while(rest < distance && delta - rest >= tenK && (rest + tenK < distance || distance - rest > rest + tenK - distance))
+  {
+    digits[length - 1]--;
+    rest += tenK;
+  }
+}
+
+// Digits of the value between low and high closest to w, value = digits * 10^decimalExponent
+static int generateDigits(DiyFloat low, DiyFloat w, DiyFloat high, char* digits, int& decimalExponent)
+{
+  uint64_t delta{subtract(high, low).f};
+  uint64_t distance{subtract(high, w).f};
+
+  const int shift{-high.e};
+  const uint64_t oneMask{(uint64_t(1) << shift) - 1u};
+  uint32_t integral{static_cast<uint32_t>(high.f >> shift)};
+  uint64_t fractional{high.f & oneMask};
+
+  int length{0};
+  int remainingDigits{countDigits(integral)};
+  uint64_t divisor{POWERS_OF_TEN[remainingDigits - 1]};
+  while(remainingDigits > 0)
+  {
+    digits[length++] = static_cast<char>('0' + integral / divisor);
+    integral %= divisor;
+    remainingDigits--;
+
+    const uint64_t rest{(static_cast<uint64_t>(integral) << shift) + fractional};
+    if(rest <= delta)
+    {
+      decimalExponent += remainingDigits;
+      roundLastDigit(digits, length, distance, delta, rest, divisor << shift);
+      return length;
+    }
+    divisor /= 10u;
+  }
+
+  int fractionalDigits{0};
+  for(;;)
+  {
+    fractional *= 10u;
+    delta *= 10u;
+    distance *= 10u;
+    digits[length++] = static_cast<char>('0' + (fractional >> shift));
+    fractional &= oneMask;
+    fractionalDigits++;
+    if(fractional <= delta)
+    {
+      break;
+    }
+  }
+  decimalExponent -= fractionalDigits;
+  roundLastDigit(digits, length, distance, delta, fractional, uint64_t(1) << shift);
+  return length;
+}
+
+// Shortest digits for a positive, finite, non-zero double
+static int shortestDigits(const DecodedDouble& decoded, char* digits, int& decimalExponent)
+{
+  // NOTE: The rounding interval is half way to the neighbours, and closer below for powers of two (except the
+  // smallest normal, whose lower neighbour is the same distance away)
+  const bool closerBelow{decoded.mantissa == (uint64_t(1) << 52) && decoded.exponent > -1074};
+  const DiyFloat upper{normalize({(decoded.mantissa << 1) + 1u, decoded.exponent - 1})};
+  DiyFloat lower{closerBelow ? DiyFloat{(decoded.mantissa << 2) - 1u, decoded.exponent - 2}
+                             : DiyFloat{(decoded.mantissa << 1) - 1u, decoded.exponent - 1}};
+  lower = {lower.f << (lower.e - upper.e), upper.e};
+  const DiyFloat w{normalize({decoded.mantissa, decoded.exponent})};
+
+  const CachedPower cached{cachedPowerFor(upper.e)};
+  const DiyFloat power{cached.f, cached.e};
+  const DiyFloat scaledW{multiply(w, power)};
+  const DiyFloat scaledLower{multiply(lower, power)};
+  const DiyFloat scaledUpper{multiply(upper, power)};
+
+  // NOTE: Shrink the interval by one unit on each side, to stay inside it despite the rounding of the products
+  decimalExponent = -cached.k;
+  return generateDigits({scaledLower.f + 1u, scaledLower.e}, scaledW, {scaledUpper.f - 1u, scaledUpper.e}, digits,
+                        decimalExponent);
+}
+
+char* formatShortest(double value, char* out)
+{
+  const DecodedDouble decoded{decode(value)};
+  if(!decoded.finite)
+  {
+    return formatWithPrintf("%.*g", 0, value, out);
+  }
+
+  if(decoded.negative)
+  {
+    *out++ = '-';
+  }
+  if(decoded.mantissa == 0u)
+  {
+    *out++ = '0';
+    return out;
+  }
+
+  char digits[20];
+  int decimalExponent{0};
+  const int length{shortestDigits(decoded, digits, decimalExponent)};
+
+  // value = 0.d1d2d3... * 10^point. Plain notation within 1e-6 <= value < 1e21, exponent notation outside.
+  const int point{length + decimalExponent};
+  if(point > 21 || point < -5)
+  {
+    *out++ = digits[0];
+    if(length > 1)
+    {
+      *out++ = '.';
+      std::memcpy(out, digits + 1, static_cast<size_t>(length - 1));
+      out += length - 1;
+    }
+    const int exponent{point - 1};
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    const uint64_t magnitude{static_cast<uint64_t>(exponent < 0 ? -exponent : exponent)};
+    const int exponentDigits{countDigits(magnitude)};
+    writeDigits(magnitude, exponentDigits, out);
+    return out + exponentDigits;
+  }
+
+  if(point <= 0)
+  {
+    *out++ = '0';
+    *out++ = '.';
+    std::memset(out, '0', static_cast<size_t>(-point));
+    out += -point;
+    std::memcpy(out, digits, static_cast<size_t>(length));
+    return out + length;
+  }
+
+  if(point >= length)
+  {
+    std::memcpy(out, digits, static_cast<size_t>(length));
+    out += length;
+    std::memset(out, '0', static_cast<size_t>(point - length));
+    return out + (point - length);
+  }
+
+  std::memcpy(out, digits, static_cast<size_t>(point));
+  out += point;
+  *out++ = '.';
+  std::memcpy(out, digits + point, static_cast<size_t>(length - point));
+  return out + (length - point);
+}
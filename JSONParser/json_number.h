@@ -0,0 +1,42 @@
+#ifndef PERFAWARE_PROFILING_JSONPARSER_JSON_NUMBER_H_
+#define PERFAWARE_PROFILING_JSONPARSER_JSON_NUMBER_H_
+
+#include <cstddef>
+
+// Converts the decimal number in [first, last) - an optional '-', digits with an optional fraction and an optional
+// exponent - to the nearest double, the same value strtod gives. Returns false when the range is not exactly one
+// such number. No allocation, no locale and no exceptions.
+//
+// Numbers shaped like the generator's output (at most 3 integer digits and exactly 16 fractional ones) are read 8
+// digits at a time. Anything with at most 19 significant digits and a decimal exponent within +-22 is converted with
+// one or two 64x64 bit multiplies (Clinger's exact case or Eisel-Lemire). The rest, and the rare products
+// Eisel-Lemire can't round with certainty, go to strtod.
+bool parseDouble(const char* first, const char* last, double& value);
+
+// NOTE: The longest text either formatter writes, a sign, 309 integer digits, the point and 19 fractional digits
+constexpr size_t MAX_FORMATTED_DOUBLE_LENGTH{330u};
+constexpr int MAX_FIXED_PRECISION{19};
+
+// Writes value with precision digits after the point, exactly what printf("%.*f") writes - same rounding (the exact
+// binary value, ties to even), "-0.00" for small negatives, "nan" and "inf". Returns the end of the text, no
+// terminator is written. precision is 0 to MAX_FIXED_PRECISION.
+//
+// Values below 2^63 are converted with 128 bit integer arithmetic, the rest go to snprintf.
+char* formatFixed(double value, int precision, char* out);
+
+// Writes the shortest decimal text that parses back to value (Grisu2) - "0.1" rather than "0.1000000000000000055".
+// Plain notation from 1e-6 up to 1e21, exponent notation ("1.5e-7", "2e+21") outside it. Returns the end of the
+// text, no terminator is written.
+//
+// The text always round trips. For about 0.1% of values it is one digit longer than the shortest possible.
+char* formatShortest(double value, char* out);
+
+// Fixed precision text for printf style reports, printf("%s", FixedDouble(sum, 16).text)
+struct FixedDouble
+{
+  char text[MAX_FORMATTED_DOUBLE_LENGTH + 1u];
+
+  FixedDouble(double value, int precision) { *formatFixed(value, precision, text) = '\0'; }
+};
+
+#endif //PERFAWARE_PROFILING_JSONPARSER_JSON_NUMBER_H_
@@ -1,253 +1,360 @@
 #include "json_parser.h"
 
-static std::variant<std::string, bool, double> getValueFromString(const std::string &value)
+#include "json_lexer.h"
+#include "json_number.h"
+
+static bool parseNumber(std::string_view text, double &value)
 {
-  if(value == "true")
-  {
-    return true;
-  }
-  else if(value == "false")
-  {
-    return false;
-  }
+  return parseDouble(text.data(), text.data() + text.size(), value);
+}
 
-  bool isDouble{false};
-  for(auto &c : value)
+static bool parseScalar(const JSONLexer &lexer, const JSONToken &token, JSONNode &node)
+{
+  switch(token.type)
   {
-    if(!isdigit(c) && c != '.' && c != '-')
+    case JSONTokenType::STRING:
     {
-      isDouble = false;
-      break;
-    }
+      node = JSONNode(std::string(lexer.text(token)));
+    } break;
 
-    isDouble = true;
-  }
+    case JSONTokenType::NUMBER:
+    {
+      double value{0.0};
+      if(!parseNumber(lexer.text(token), value))
+      {
+        return false;
+      }
+      node = JSONNode(value);
+    } break;
 
-  if(isDouble)
-  {
-    return std::stod(value);
+    case JSONTokenType::TRUE: node = JSONNode(true); break;
+    case JSONTokenType::FALSE: node = JSONNode(false); break;
+    case JSONTokenType::NULLT: node = JSONNode(); break;
+    default: return false;
   }
 
-  return value;
-
+  return true;
 }
 
-static void skipWhiteSpace(const std::string &json, size_t &jsonIter)
+JSONNode JSONParser::parse(std::string_view json)
 {
-  while(json[jsonIter] == '\t' || json[jsonIter] == ' ' || json[jsonIter] == '\n')
-  {
-    jsonIter++;
-  }
-}
+  TimeFunction;
+  JSONLexer lexer(json, bestStructuralKernel());
+  JSONNode rootNode;
 
-static std::string searchKey(const std::string &json, size_t &jsonIter)
-{
-  std::string key;
-  jsonIter++;
+  // NOTE: Containers that are still open. Only the innermost one is ever appended to, so the pointers stay valid
+  // even when an outer array grows.
+  std::vector<JSONNode*> openContainers;
+  JSONNode *target{&rootNode};
+  JSONToken token{lexer.next()};
 
-  while(json[jsonIter] != '\"' && jsonIter < json.size())
+  if(token.type == JSONTokenType::END)
   {
-    key += json[jsonIter];
-    jsonIter++;
+    return {};
   }
 
-  return key;
-}
-
-static void searchForSemiColon(const std::string &json, size_t &jsonIter)
-{
-  skipWhiteSpace(json, jsonIter);
-  while(json[jsonIter] != ':' && jsonIter < json.size())
+  for(;;)
   {
-    jsonIter++;
-  }
-}
+    // NOTE: Expecting a value, it goes into target
+    bool valueComplete{true};
+    if(token.type == JSONTokenType::OPEN_OBJECT || token.type == JSONTokenType::OPEN_ARRAY)
+    {
+      const bool isObject{token.type == JSONTokenType::OPEN_OBJECT};
+      *target = JSONNode(isObject ? JSONType::OBJECT : JSONType::ARRAY);
+      openContainers.push_back(target);
 
-static void searchForEndOfValue(const std::string &json, size_t &jsonIter)
-{
-  while(json[jsonIter] != ',' && jsonIter < json.size())
-  {
-    jsonIter++;
-  }
-}
+      token = lexer.next();
+      if(token.type == (isObject ? JSONTokenType::CLOSE_OBJECT : JSONTokenType::CLOSE_ARRAY))
+      {
+        openContainers.pop_back();
+      }
+      else if(isObject)
+      {
+        if(token.type != JSONTokenType::STRING || lexer.next().type != JSONTokenType::COLON)
+        {
+          return {};
+        }
+        target = &(*target)[std::string(lexer.text(token))];
+        token = lexer.next();
+        valueComplete = false;
+      }
+      else
+      {
+        target = &target->getArray().emplace_back();
+        valueComplete = false;
+      }
+    }
+    else if(!parseScalar(lexer, token, *target))
+    {
+      return {};
+    }
 
-static std::string searchForString(const std::string &json, size_t &jsonIter)
-{
-  std::string value;
-  jsonIter++;
+    if(!valueComplete)
+    {
+      continue;
+    }
 
-  skipWhiteSpace(json, jsonIter);
-  while(json[jsonIter] != '\"' && jsonIter < json.size())
-  {
-    value += json[jsonIter];
-    jsonIter++;
-  }
+    // NOTE: A value just finished, close as many containers as the input closes and find where the next value goes
+    for(;;)
+    {
+      token = lexer.next();
+      if(openContainers.empty())
+      {
+        return (token.type == JSONTokenType::END) ? std::move(rootNode) : JSONNode();
+      }
 
-  return value;
-}
+      JSONNode *container{openContainers.back()};
+      const bool isObject{container->type() == JSONType::OBJECT};
 
-static std::string searchForBool(const std::string &json, size_t &jsonIter)
-{
-  std::string value;
+      if(token.type == (isObject ? JSONTokenType::CLOSE_OBJECT : JSONTokenType::CLOSE_ARRAY))
+      {
+        openContainers.pop_back();
+        continue;
+      }
 
-  skipWhiteSpace(json, jsonIter);
-  while(json[jsonIter] != ',' && jsonIter < json.size() && json[jsonIter] != '}')
-  {
-    value += json[jsonIter];
-    jsonIter++;
-  }
+      if(token.type != JSONTokenType::COMMA)
+      {
+        return {};
+      }
 
-  return value;
-}
+      if(isObject)
+      {
+        JSONToken key{lexer.next()};
+        if(key.type != JSONTokenType::STRING || lexer.next().type != JSONTokenType::COLON)
+        {
+          return {};
+        }
+        target = &(*container)[std::string(lexer.text(key))];
+      }
+      else
+      {
+        target = &container->getArray().emplace_back();
+      }
 
-static std::string searchForNumber(const std::string &json, size_t &jsonIter)
-{
-  std::string value;
-  skipWhiteSpace(json, jsonIter);
-  while(json[jsonIter] != ',' && jsonIter < json.size() && json[jsonIter] != '}')
-  {
-    value += json[jsonIter];
-    jsonIter++;
+      token = lexer.next();
+      break;
+    }
   }
+}
+
+// NOTE: Smallest record the pairs format allows ({"x0":0,"y0":0,"x1":0,"y1":0} plus a comma). Reserving for that
+// many only costs address space, the pages past the real pair count are never touched.
+static constexpr size_t MIN_PAIR_RECORD_SIZE{30u};
 
-  return value;
+static bool expectToken(JSONLexer &lexer, JSONTokenType type)
+{
+  return lexer.next().type == type;
 }
 
-static JSONNode createJsonNodeFromVariant(std::variant<std::string, bool, double> &value)
+static bool parsePairRecord(JSONLexer &lexer, HaversinePairs &pairs)
 {
-  if(auto stringValue = std::get_if<std::string>(&value))
-  {
-    return JSONNode(*stringValue);
-  }
-  else if(auto boolValue = std::get_if<bool>(&value))
-  {
-    return JSONNode(*boolValue);
-  }
-  else if(auto doubleValue = std::get_if<double>(&value))
+  double values[4];
+  uint32_t seenFields{0u};
+
+  for(uint32_t field{0u}; field < 4u; field++)
   {
-    return JSONNode(*doubleValue);
-  }
-  return {};
-}
+    if(field > 0u && !expectToken(lexer, JSONTokenType::COMMA))
+    {
+      return false;
+    }
 
+    JSONToken key{lexer.next()};
+    std::string_view name{lexer.text(key)};
+    if(key.type != JSONTokenType::STRING || name.size() != 2u ||
+       (name[0] != 'x' && name[0] != 'y') || (name[1] != '0' && name[1] != '1'))
+    {
+      return false;
+    }
 
-JSONNode JSONParser::parse(const std::string &json)
-{
-  TimeFunction;
-  if(json.empty())
+    // NOTE: x0, y0, x1, y1 map to 0..3, in whatever order the record lists them
+    const uint32_t index{(name[0] == 'y' ? 1u : 0u) + (name[1] == '1' ? 2u : 0u)};
+    seenFields |= 1u << index;
+
+    JSONToken number;
+    if(!expectToken(lexer, JSONTokenType::COLON) || (number = lexer.next()).type != JSONTokenType::NUMBER ||
+       !parseNumber(lexer.text(number), values[index]))
+    {
+      return false;
+    }
+  }
+
+  if(seenFields != 0xFu || !expectToken(lexer, JSONTokenType::CLOSE_OBJECT))
   {
-    return {};
+    return false;
   }
 
-  JSONNode rootNode;
+  pairs.push_back(values[0], values[1], values[2], values[3]);
+  return true;
+}
 
-  if(*json.begin() == '{' && json.back() == '}')
+JSONPairsStreamParser::Status JSONPairsStreamParser::parse(std::string_view text, bool isFinal,
+                                                           HaversinePairs &pairs, size_t &consumed)
+{
+  consumed = 0u;
+  if(!isFinal)
   {
-     rootNode = JSONNode(JSONType::OBJECT);
+    // NOTE: Every token before the last '}' is followed by at least that '}', so none of them can be cut off. A '}'
+    // inside a string can't cut a valid document short - the pairs format has no strings that could hold one.
+    const size_t lastClose{text.rfind('}')};
+    text = (lastClose == std::string_view::npos) ? std::string_view() : text.substr(0u, lastClose + 1u);
   }
 
-  size_t jsonIter{0u};
-  bool arrayFlag{false};
-  std::string lastKey;
-  std::string arrayKey;
-  bool newJsonObject{false};
-
-  auto getArrayNode = [&rootNode, &lastKey, &arrayKey]() -> JSONNode&
+  JSONLexer lexer(text, bestStructuralKernel());
+  for(;;)
   {
-    if(arrayKey.empty())
+    const JSONToken token{lexer.next()};
+    if(token.type == JSONTokenType::END)
     {
-      return rootNode.getArray().back()[lastKey];
+      if(!isFinal)
+      {
+        return Status::NEED_MORE;
+      }
+      return (_state == State::END) ? Status::DONE : Status::INVALID;
     }
-    return rootNode[arrayKey].getArray().back()[lastKey];
-  };
 
-  while(jsonIter < json.size())
-  {
-    skipWhiteSpace(json, jsonIter);
-
-    if(json[jsonIter] == '\"')
+    switch(_state)
     {
-      lastKey = searchKey(json, jsonIter);
+      case State::HEADER:
+      {
+        JSONToken key;
+        if(token.type != JSONTokenType::OPEN_OBJECT || (key = lexer.next()).type != JSONTokenType::STRING ||
+           lexer.text(key) != "pairs" || !expectToken(lexer, JSONTokenType::COLON) ||
+           !expectToken(lexer, JSONTokenType::OPEN_ARRAY))
+        {
+          return Status::INVALID;
+        }
+        _state = State::FIRST_RECORD;
+      } break;
 
-      if(arrayFlag && newJsonObject)
+      case State::FIRST_RECORD:
+      case State::RECORD:
       {
-        if(arrayKey.empty())
+        if(_state == State::FIRST_RECORD && token.type == JSONTokenType::CLOSE_ARRAY)
         {
-          rootNode.getArray().emplace_back(JSONType::OBJECT);
-          rootNode.getArray().back()[lastKey] = JSONNode();
-          newJsonObject = false;
+          _state = State::TRAILER;
+        }
+        else if(token.type != JSONTokenType::OPEN_OBJECT || !parsePairRecord(lexer, pairs))
+        {
+          return Status::INVALID;
         }
         else
         {
-          rootNode[arrayKey].getArray().emplace_back(JSONType::OBJECT);
-          rootNode[arrayKey].getArray().back()[lastKey] = JSONNode();
-          newJsonObject = false;
+          _state = State::NEXT_RECORD;
         }
-      }
-      else
-      {
-        rootNode[lastKey] = JSONNode();
-      }
-
-      searchForSemiColon(json, jsonIter);
-
-      JSONNode& node = arrayFlag ? getArrayNode() : rootNode[lastKey];
+      } break;
 
-      if(json[jsonIter] == ':')
+      case State::NEXT_RECORD:
       {
-        jsonIter++;
-        skipWhiteSpace(json, jsonIter);
-
-        if(json[jsonIter] == '\"')
+        if(token.type == JSONTokenType::COMMA)
         {
-          std::string value = searchForString(json, jsonIter);
-          auto valueVariant = getValueFromString(value);
-          node = createJsonNodeFromVariant(valueVariant);
+          _state = State::RECORD;
         }
-        else if(json[jsonIter] == 't' || json[jsonIter] == 'f')
+        else if(token.type == JSONTokenType::CLOSE_ARRAY)
         {
-          std::string value = searchForBool(json, jsonIter);
-          auto valueVariant = getValueFromString(value);
-          node = createJsonNodeFromVariant(valueVariant);
+          _state = State::TRAILER;
         }
-        else if(std::isdigit(json[jsonIter]) || json[jsonIter] == '-')
+        else
         {
-          std::string value = searchForNumber(json, jsonIter);
-          auto valueVariant = getValueFromString(value);
-          node = createJsonNodeFromVariant(valueVariant);
+          return Status::INVALID;
         }
-      }
+      } break;
+
+      case State::TRAILER:
+      {
+        if(token.type != JSONTokenType::CLOSE_OBJECT)
+        {
+          return Status::INVALID;
+        }
+        _state = State::END;
+      } break;
+
+      case State::END: return Status::INVALID;
     }
 
-    if(json[jsonIter] == '[')
+    consumed = lexer.position();
+  }
+}
+
+bool JSONParser::parsePairs(std::string_view json, HaversinePairs &pairs)
+{
+  TimeFunction;
+  pairs.clear();
+  pairs.reserve(pairCapacityFor(json.size()));
+
+  JSONPairsStreamParser parser;
+  size_t consumed{0u};
+  if(parser.parse(json, true, pairs, consumed) != JSONPairsStreamParser::Status::DONE)
+  {
+    pairs.clear();
+    return false;
+  }
+
+  return true;
+}
+
+size_t JSONParser::pairCapacityFor(size_t jsonSize)
+{
+  return jsonSize / MIN_PAIR_RECORD_SIZE;
+}
+
+bool JSONParser::findPairsArray(std::string_view json, size_t &begin, size_t &end)
+{
+  JSONLexer lexer(json);
+  JSONToken key;
+  if(!expectToken(lexer, JSONTokenType::OPEN_OBJECT) || (key = lexer.next()).type != JSONTokenType::STRING ||
+     lexer.text(key) != "pairs" || !expectToken(lexer, JSONTokenType::COLON) ||
+     !expectToken(lexer, JSONTokenType::OPEN_ARRAY))
+  {
+    return false;
+  }
+  begin = lexer.position();
+
+  // NOTE: Walk back over the trailing "]}" and any whitespace around it
+  end = json.size();
+  for(char expected : {'}', ']'})
+  {
+    while(end > begin && (json[end - 1u] == ' ' || json[end - 1u] == '\n' || json[end - 1u] == '\t' ||
+                          json[end - 1u] == '\r'))
     {
-      arrayFlag = true;
-      if(rootNode.isEmpty())
-      {
-        rootNode = JSONNode(JSONType::ARRAY);
-      }
-      else if (!lastKey.empty())
-      {
-        rootNode[lastKey] = JSONNode(JSONType::ARRAY);
-        arrayKey = lastKey;
-      }
+      end--;
     }
-    else if(json[jsonIter] == ']')
+    if(end == begin || json[end - 1u] != expected)
     {
-      arrayFlag = false;
+      return false;
     }
+    end--;
+  }
 
-    if(json[jsonIter] == '{')
+  return true;
+}
+
+bool JSONParser::parsePairRecords(std::string_view records, HaversinePairs &pairs, bool &endsWithComma)
+{
+  TimeBandwidth(__func__, records.size());
+  JSONLexer lexer(records, bestStructuralKernel());
+  endsWithComma = false;
+
+  JSONToken token{lexer.next()};
+  while(token.type != JSONTokenType::END)
+  {
+    endsWithComma = false;
+    if(token.type != JSONTokenType::OPEN_OBJECT || !parsePairRecord(lexer, pairs))
     {
-      newJsonObject = true;
+      return false;
     }
-    else if(json[jsonIter] == '}')
+
+    token = lexer.next();
+    if(token.type == JSONTokenType::END)
     {
-      newJsonObject = false;
+      break;
     }
-
-    jsonIter++;
+    if(token.type != JSONTokenType::COMMA)
+    {
+      return false;
+    }
+    endsWithComma = true;
+    token = lexer.next();
   }
 
-  return rootNode;
+  return true;
 }
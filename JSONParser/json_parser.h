@@ -2,6 +2,7 @@
 #define PERFAWARE_PROFILING_JSONPARSER_JSON_PARSER_H_
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <stdexcept>
@@ -57,6 +58,12 @@ class JSONNode
   }
 
 
+    // NOTE: Spelled out because the user-declared destructor would otherwise suppress the implicit moves, which
+    // turned every vector growth and node assignment into a deep copy of the subtree.
+    JSONNode(const JSONNode&) = default;
+    JSONNode(JSONNode&&) noexcept = default;
+    JSONNode& operator=(const JSONNode&) = default;
+    JSONNode& operator=(JSONNode&&) noexcept = default;
     ~JSONNode() = default;
 
     [[nodiscard]] JSONType type() const { return _type;};
@@ -89,13 +96,120 @@ class JSONNode
    std::variant<std::string,bool,double> _dataValue;
 };
 
+// Struct-of-arrays storage for the generator's {"pairs":[{"x0":..,"y0":..,"x1":..,"y1":..}, ...]} documents
+struct HaversinePairs
+{
+  std::vector<double> x0;
+  std::vector<double> y0;
+  std::vector<double> x1;
+  std::vector<double> y1;
+
+  [[nodiscard]] size_t size() const { return x0.size(); }
+  [[nodiscard]] size_t byteCount() const { return 4u * size() * sizeof(double); }
+
+  void reserve(size_t count)
+  {
+    x0.reserve(count);
+    y0.reserve(count);
+    x1.reserve(count);
+    y1.reserve(count);
+  }
+
+  void clear()
+  {
+    x0.clear();
+    y0.clear();
+    x1.clear();
+    y1.clear();
+  }
+
+  void push_back(double pairX0, double pairY0, double pairX1, double pairY1)
+  {
+    x0.push_back(pairX0);
+    y0.push_back(pairY0);
+    x1.push_back(pairX1);
+    y1.push_back(pairY1);
+  }
+};
+
+// Read-only struct-of-arrays view of pairs stored elsewhere - a HaversinePairs, or coordinates used in place from a
+// mapped binary pair file
+struct HaversinePairsView
+{
+  const double* x0{nullptr};
+  const double* y0{nullptr};
+  const double* x1{nullptr};
+  const double* y1{nullptr};
+  size_t count{0u};
+
+  HaversinePairsView() = default;
+  HaversinePairsView(const double* pairX0, const double* pairY0, const double* pairX1, const double* pairY1,
+                     size_t pairCount)
+    : x0(pairX0), y0(pairY0), x1(pairX1), y1(pairY1), count(pairCount) {}
+  // NOTE: Implicit, anything that reads pairs takes a view and a HaversinePairs passes as one
+  HaversinePairsView(const HaversinePairs& pairs)
+    : HaversinePairsView(pairs.x0.data(), pairs.y0.data(), pairs.x1.data(), pairs.y1.data(), pairs.size()) {}
+
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t byteCount() const { return 4u * count * sizeof(double); }
+};
+
+// Incremental version of JSONParser::parsePairs for input that arrives in pieces. Each call parses the complete
+// records at the start of text and reports how much of it was used, the caller keeps the rest and passes it again with
+// more input appended. Memory use is whatever the caller's buffer is, however large the document.
+class JSONPairsStreamParser
+{
+ public:
+  enum class Status : uint8_t
+  {
+    NEED_MORE, // everything up to consumed is parsed, more input is needed to go on
+    DONE,      // the document is complete
+    INVALID    // not the pairs format, or malformed
+  };
+
+  // Appends the parsed pairs to pairs. isFinal says no input follows text, otherwise only the part up to the last
+  // '}' is parsed - tokens after it could be cut off.
+  Status parse(std::string_view text, bool isFinal, HaversinePairs& pairs, size_t& consumed);
+
+ private:
+  enum class State : uint8_t
+  {
+    HEADER,       // {"pairs":[
+    FIRST_RECORD, // a record or the ] of an empty array
+    RECORD,       // a record, after a comma
+    NEXT_RECORD,  // , or ]
+    TRAILER,      // the closing }
+    END
+  };
+
+  State _state{State::HEADER};
+};
+
 class JSONParser
 {
  public:
   JSONParser() = default;
   ~JSONParser() = default;
 
-  static JSONNode parse(const std::string& json);
+  static JSONNode parse(std::string_view json);
+
+  // Fast path for the generator's pairs format, fills the four arrays in one pass without building a tree.
+  // Returns false and leaves pairs empty, its capacity kept, when the document has any other shape, callers fall
+  // back to parse().
+  static bool parsePairs(std::string_view json, HaversinePairs& pairs);
+
+  // How many pairs parsePairs reserves room for in a document of jsonSize bytes. Pairs that already have that much
+  // capacity are parsed into without reallocating.
+  static size_t pairCapacityFor(size_t jsonSize);
+
+  // Finds the inside of the pairs array, [begin, end) between its brackets. Returns false when json doesn't start
+  // with {"pairs":[ and end with ]}. The records themselves are not looked at.
+  static bool findPairsArray(std::string_view json, size_t& begin, size_t& end);
+
+  // Parses a comma separated run of pair records, appending them to pairs. The run may end in a comma, reported in
+  // endsWithComma, so a pairs array can be split at record starts and the pieces parsed separately. Returns false
+  // on anything else.
+  static bool parsePairRecords(std::string_view records, HaversinePairs& pairs, bool& endsWithComma);
 };
 
 #endif //PERFAWARE_PROFILING_JSONPARSER_JSON_PARSER_H_
@@ -0,0 +1,285 @@
+#include "json_structural_index.h"
+
+#include <cstring>
+
+#include "cpu_features.h"
+#include "integer_intrinsics.h"
+
+// NOTE: The SSE4.2 and AVX2 kernels only exist on x86, elsewhere every kernel but the scalar one is unsupported
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define STRUCTURAL_INDEX_X86 1
+#include <immintrin.h>
+#else
+#define STRUCTURAL_INDEX_X86 0
+#endif
+
+// NOTE: GCC and Clang only emit SSE4.2 and AVX2 instructions in functions marked for them, MSVC emits any intrinsic
+// anywhere
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_SSE42
+#define TARGET_AVX2
+#define FORCE_INLINE __forceinline
+#else
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define FORCE_INLINE __attribute__((always_inline)) inline
+#endif
+
+static constexpr size_t BLOCK_SIZE{64u};
+
+// Per-byte classification of one 64 byte block, bit i describes block[i]
+struct BlockMasks
+{
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t whitespace;
+  uint64_t op;
+};
+
+static BlockMasks classifyScalar(const char *block)
+{
+  BlockMasks masks{};
+  for(size_t byteIndex{0u}; byteIndex < BLOCK_SIZE; byteIndex++)
+  {
+    const uint64_t bit{uint64_t(1) << byteIndex};
+    switch(block[byteIndex])
+    {
+      case '\"': masks.quote |= bit; break;
+      case '\\': masks.backslash |= bit; break;
+      case ' ': case '\t': case '\n': case '\r': masks.whitespace |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',': masks.op |= bit; break;
+      default: break;
+    }
+  }
+  return masks;
+}
+
+#if STRUCTURAL_INDEX_X86
+// NOTE: pcmpestrm matches each byte against a whole character set at once, one instruction per set per 16 bytes
+TARGET_SSE42
+static BlockMasks classifySse42(const char *block)
+{
+  const __m128i opSet{_mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)};
+  const __m128i whitespaceSet{_mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)};
+  const __m128i quote{_mm_set1_epi8('\"')};
+  const __m128i backslash{_mm_set1_epi8('\\')};
+  constexpr int mode{_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK};
+
+  BlockMasks masks{};
+  for(size_t chunk{0u}; chunk < BLOCK_SIZE / 16u; chunk++)
+  {
+    const __m128i data{_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + chunk * 16u))};
+    const uint32_t shift{static_cast<uint32_t>(chunk * 16u)};
+
+    masks.op |= static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_cmpestrm(opSet, 6, data, 16, mode)) & 0xFFFF) << shift;
+    masks.whitespace |=
+      static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_cmpestrm(whitespaceSet, 4, data, 16, mode)) & 0xFFFF) << shift;
+    masks.quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, quote))) << shift;
+    masks.backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, backslash))) << shift;
+  }
+  return masks;
+}
+
+TARGET_AVX2
+static BlockMasks classifyAvx2(const char *block)
+{
+  BlockMasks masks{};
+  for(size_t half{0u}; half < 2u; half++)
+  {
+    const __m256i data{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + half * 32u))};
+    const uint32_t shift{static_cast<uint32_t>(half * 32u)};
+
+    // NOTE: '[' and ']' are '{' and '}' with bit 5 cleared, so setting it folds brackets onto braces
+    const __m256i folded{_mm256_or_si256(data, _mm256_set1_epi8(0x20))};
+    const __m256i op{_mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8(','))))};
+    const __m256i whitespace{_mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\r'))))};
+
+    masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+    masks.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << shift;
+    masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('\"'))))) << shift;
+    masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('\\'))))) << shift;
+  }
+  return masks;
+}
+#endif
+
+// NOTE: Marks the characters escaped by an odd run of backslashes, carrying a run that ends a block into the next
+// one. Same trick as simdjson: runs starting on odd bits are added to themselves, the carry flips their parity.
+static uint64_t findEscaped(uint64_t backslash, uint64_t &previousEscaped)
+{
+  backslash &= ~previousEscaped;
+  const uint64_t followsEscape{(backslash << 1) | previousEscaped};
+  const uint64_t evenBits{0x5555555555555555ULL};
+
+  const uint64_t oddSequenceStarts{backslash & ~evenBits & ~followsEscape};
+  uint64_t sequencesStartingOnEvenBits;
+  previousEscaped = addWithCarry64(oddSequenceStarts, backslash, sequencesStartingOnEvenBits) ? 1u : 0u;
+  const uint64_t invertMask{sequencesStartingOnEvenBits << 1};
+
+  return (evenBits ^ invertMask) & followsEscape;
+}
+
+// NOTE: Bit i of the result is the XOR of bits 0..i - set between an opening quote (inclusive) and its closing quote
+static uint64_t prefixXor(uint64_t bits)
+{
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+static size_t nextSetBit(uint64_t bits)
+{
+  return bits ? static_cast<size_t>(trailingZeros64(bits)) : 0u;
+}
+
+// NOTE: Writes the offsets 8 at a time without checking how many bits are left, so the loop exit is only
+// mispredicted on the rare block with more than 8 (or 16) positions. The extra writes stay within the block's own 64
+// entries: a block never starts with more positions written than bytes before it.
+FORCE_INLINE size_t *flatten(uint64_t bits, size_t offset, size_t *out)
+{
+  const size_t count{static_cast<size_t>(popCount64(bits))};
+  for(size_t index{0u}; index < 8u; index++)
+  {
+    out[index] = offset + nextSetBit(bits);
+    bits &= bits - 1u;
+  }
+  if(count > 8u)
+  {
+    for(size_t index{8u}; index < 16u; index++)
+    {
+      out[index] = offset + nextSetBit(bits);
+      bits &= bits - 1u;
+    }
+    for(size_t index{16u}; bits; index++)
+    {
+      out[index] = offset + nextSetBit(bits);
+      bits &= bits - 1u;
+    }
+  }
+  return out + count;
+}
+
+// NOTE: Forced inline so each kernel's batch function below gets its own copy, compiled for that kernel's target
+// with the classification inlined into it.
+template<typename Classify>
+FORCE_INLINE size_t indexBlocks(std::string_view json, size_t offset, size_t end,
+                                JSONStructuralIndexer::BlockState &state, size_t *positions, Classify classify)
+{
+  size_t *out{positions};
+
+  for(; offset < end; offset += BLOCK_SIZE)
+  {
+    // NOTE: The tail is copied into a block padded with whitespace, which never adds a position
+    char padded[BLOCK_SIZE];
+    const char *block{json.data() + offset};
+    if(json.size() - offset < BLOCK_SIZE)
+    {
+      std::memset(padded, ' ', sizeof(padded));
+      std::memcpy(padded, block, json.size() - offset);
+      block = padded;
+    }
+
+    const BlockMasks masks{classify(block)};
+
+    const uint64_t quote{masks.quote & ~findEscaped(masks.backslash, state.previousEscaped)};
+    const uint64_t inString{prefixXor(quote) ^ state.previousInString};
+    state.previousInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+    const uint64_t scalar{~(masks.whitespace | masks.op | quote) & ~inString};
+    const uint64_t scalarStart{scalar & ~((scalar << 1) | state.previousScalar)};
+    state.previousScalar = scalar >> 63;
+
+    out = flatten((masks.op & ~inString) | quote | scalarStart, offset, out);
+  }
+
+  return static_cast<size_t>(out - positions);
+}
+
+static size_t indexBatchScalar(std::string_view json, size_t offset, size_t end,
+                               JSONStructuralIndexer::BlockState &state, size_t *positions)
+{
+  return indexBlocks(json, offset, end, state, positions, classifyScalar);
+}
+
+#if STRUCTURAL_INDEX_X86
+TARGET_SSE42
+static size_t indexBatchSse42(std::string_view json, size_t offset, size_t end,
+                              JSONStructuralIndexer::BlockState &state, size_t *positions)
+{
+  return indexBlocks(json, offset, end, state, positions, classifySse42);
+}
+
+TARGET_AVX2
+static size_t indexBatchAvx2(std::string_view json, size_t offset, size_t end,
+                             JSONStructuralIndexer::BlockState &state, size_t *positions)
+{
+  return indexBlocks(json, offset, end, state, positions, classifyAvx2);
+}
+#endif
+
+bool isStructuralKernelSupported(StructuralKernel kernel)
+{
+  switch(kernel)
+  {
+    case StructuralKernel::SCALAR: return true;
+    case StructuralKernel::SSE42: return STRUCTURAL_INDEX_X86 && getCpuFeatures().sse42;
+    case StructuralKernel::AVX2: return STRUCTURAL_INDEX_X86 && getCpuFeatures().avx2;
+  }
+  return false;
+}
+
+StructuralKernel bestStructuralKernel()
+{
+  if(isStructuralKernelSupported(StructuralKernel::AVX2))
+  {
+    return StructuralKernel::AVX2;
+  }
+  if(isStructuralKernelSupported(StructuralKernel::SSE42))
+  {
+    return StructuralKernel::SSE42;
+  }
+  return StructuralKernel::SCALAR;
+}
+
+const char *structuralKernelName(StructuralKernel kernel)
+{
+  switch(kernel)
+  {
+    case StructuralKernel::SCALAR: return "scalar";
+    case StructuralKernel::SSE42: return "sse4.2";
+    case StructuralKernel::AVX2: return "avx2";
+  }
+  return "unknown";
+}
+
+JSONStructuralIndexer::JSONStructuralIndexer(std::string_view json, StructuralKernel kernel)
+  : _json(json), _kernel(isStructuralKernelSupported(kernel) ? kernel : StructuralKernel::SCALAR)
+{
+}
+
+size_t JSONStructuralIndexer::nextBatch(size_t *positions)
+{
+  const size_t begin{_offset};
+  _offset = (_json.size() - begin < STRUCTURAL_BATCH_SIZE) ? _json.size() : begin + STRUCTURAL_BATCH_SIZE;
+
+  // NOTE: Off x86 the constructor has already turned every kernel into the scalar one
+  switch(_kernel)
+  {
+#if STRUCTURAL_INDEX_X86
+    case StructuralKernel::SSE42: return indexBatchSse42(_json, begin, _offset, _state, positions);
+    case StructuralKernel::AVX2: return indexBatchAvx2(_json, begin, _offset, _state, positions);
+#endif
+    default: break;
+  }
+  return indexBatchScalar(_json, begin, _offset, _state, positions);
+}
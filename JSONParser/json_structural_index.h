@@ -0,0 +1,57 @@
+#ifndef PERFAWARE_PROFILING_JSONPARSER_JSON_STRUCTURAL_INDEX_H_
+#define PERFAWARE_PROFILING_JSONPARSER_JSON_STRUCTURAL_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class StructuralKernel : uint8_t
+{
+  SCALAR,
+  SSE42,
+  AVX2
+};
+
+[[nodiscard]] bool isStructuralKernelSupported(StructuralKernel kernel);
+[[nodiscard]] StructuralKernel bestStructuralKernel();
+[[nodiscard]] const char* structuralKernelName(StructuralKernel kernel);
+
+// Input bytes indexed per batch, a multiple of the 64 byte block. A batch never yields more positions than bytes.
+constexpr size_t STRUCTURAL_BATCH_SIZE{1024u};
+
+// Finds, in input order, everything the lexer has to stop at: the structural characters {}[]:, outside strings,
+// every unescaped quote and the first character of every number/literal. Works 64 bytes at a time in the style of
+// simdjson's stage 1 - the kernels only classify bytes into bitmasks, escape and in-string tracking is plain bit
+// arithmetic shared by all of them, so every kernel produces the same positions.
+//
+// NOTE: The input is indexed one batch at a time rather than up front, so the positions stay in L1 instead of
+// needing a buffer (and its page faults) about as large as the input.
+class JSONStructuralIndexer
+{
+ public:
+  // An unsupported kernel falls back to the scalar one
+  explicit JSONStructuralIndexer(std::string_view json, StructuralKernel kernel = bestStructuralKernel());
+
+  [[nodiscard]] bool done() const { return _offset >= _json.size(); }
+  [[nodiscard]] StructuralKernel kernel() const { return _kernel; }
+
+  // Indexes the next STRUCTURAL_BATCH_SIZE bytes, writing their absolute offsets to positions (room for
+  // STRUCTURAL_BATCH_SIZE entries). Returns how many were written, which may be 0 while not done().
+  size_t nextBatch(size_t* positions);
+
+  // Carry-over from one 64 byte block to the next
+  struct BlockState
+  {
+    uint64_t previousEscaped;
+    uint64_t previousInString;
+    uint64_t previousScalar;
+  };
+
+ private:
+  std::string_view _json;
+  size_t _offset{0u};
+  BlockState _state{};
+  StructuralKernel _kernel;
+};
+
+#endif //PERFAWARE_PROFILING_JSONPARSER_JSON_STRUCTURAL_INDEX_H_
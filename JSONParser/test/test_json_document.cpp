@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "json_document.h"
+
+#include <string>
+
+TEST_CASE("JsonDocument empty and malformed input gives null")
+{
+  for(std::string_view json : {"", " \n", "{", "}", "{\"key\":}", "{\"key\" 1}", "[1, 2", "[1 2]", "{}}",
+                               "{\"key\":1.2.3}", "[tru]"})
+  {
+    INFO(json);
+    JSONDocument document = JSONDocument::parse(json);
+    REQUIRE(document.root().type() == JSONType::NULLT);
+  }
+}
+
+TEST_CASE("JsonDocument scalars")
+{
+  std::string json = R"({"string":"value", "number":-1.5e3, "int":4, "true":true, "false":false, "null":null})";
+  JSONDocument document = JSONDocument::parse(json);
+  auto root = document.root();
+
+  REQUIRE(root.type() == JSONType::OBJECT);
+  CHECK(root["string"].get<std::string>() == "value");
+  CHECK(root["string"].get<std::string_view>().data() == json.data() + 11);
+  CHECK(root["number"].get<double>() == -1500.0);
+  CHECK(root["int"].get<double>() == 4.0);
+  CHECK(root["true"].get<bool>() == true);
+  CHECK(root["false"].get<bool>() == false);
+  CHECK(root["null"].type() == JSONType::NULLT);
+  CHECK(root["missing"].type() == JSONType::NULLT);
+
+  CHECK_THROWS_AS(root["string"].get<double>(), std::runtime_error);
+  CHECK_THROWS_AS(root["number"].getArray(), std::runtime_error);
+  REQUIRE_THROWS_AS(root["number"]["key"], std::runtime_error);
+}
+
+TEST_CASE("JsonDocument scalar root")
+{
+  JSONDocument document = JSONDocument::parse(" 42 ");
+  REQUIRE(document.root().get<double>() == 42.0);
+  REQUIRE(document.nodeCount() == 1u);
+}
+
+TEST_CASE("JsonDocument nested containers")
+{
+  std::string json = R"({"outer":{"inner":[1, [2, 3], {"deep":"value"}], "empty":{}, "list":[]}, "flag":false})";
+  JSONDocument document = JSONDocument::parse(json);
+  auto root = document.root();
+
+  REQUIRE(root.type() == JSONType::OBJECT);
+  CHECK(root["flag"].get<bool>() == false);
+
+  auto inner = root["outer"]["inner"].getArray();
+  REQUIRE(inner.size() == 3);
+  CHECK(inner[0].get<double>() == 1.0);
+  REQUIRE(inner[1].getArray().size() == 2);
+  CHECK(inner[1].getArray()[1].get<double>() == 3.0);
+  REQUIRE(inner[2]["deep"].get<std::string>() == "value");
+
+  CHECK(root["outer"]["empty"].type() == JSONType::OBJECT);
+  REQUIRE(root["outer"]["list"].getArray().empty());
+}
+
+TEST_CASE("JsonDocument haversine pairs")
+{
+  std::string json = R"({"pairs":[{"x0":-71.3015509018757001, "y0":-176.9483879090714424, "x1":-68.8159353647142495, "y1":-177.4700140406496303},
+                           {"x0":34.052235, "y0":-118.243683, "x1":40.712776, "y1":-74.005974},
+                           {"x0":51.507351, "y0":-0.127758, "x1":48.856613, "y1":2.352222}]})";
+  JSONDocument document = JSONDocument::parse(json);
+  JSONNode tree = JSONParser::parse(json);
+
+  auto pairs = document.root()["pairs"].getArray();
+  auto& treePairs = tree["pairs"].getArray();
+  REQUIRE(pairs.size() == treePairs.size());
+
+  // NOTE: 1 root object + 1 array + 3 * (1 object + 4 keys + 4 values) + the "pairs" key
+  REQUIRE(document.nodeCount() == 30u);
+
+  size_t pairIndex{0u};
+  for(auto pair : pairs)
+  {
+    for(const char* key : {"x0", "y0", "x1", "y1"})
+    {
+      REQUIRE(pair[key].get<double>() == treePairs[pairIndex][key].get<double>());
+    }
+    pairIndex++;
+  }
+  REQUIRE(pairIndex == 3u);
+}
+
+TEST_CASE("JsonDocument very large array")
+{
+  std::string json = "{\"pairs\":[";
+  for(auto i{0}; i < 50000; i++)
+  {
+    json += "{\"key1\":\"value" + std::to_string(i) + "\"},";
+  }
+  json += "{\"key1\":\"last\"}]}";
+
+  JSONDocument document = JSONDocument::parse(json);
+  auto array = document.root()["pairs"].getArray();
+  REQUIRE(array.size() == 50001);
+  CHECK(array[12345]["key1"].get<std::string>() == "value12345");
+  REQUIRE(array[50000]["key1"].get<std::string>() == "last");
+}
@@ -0,0 +1,82 @@
+#include "catch.hpp"
+#include "json_lexer.h"
+
+#include <vector>
+
+static std::vector<JSONTokenType> tokenTypes(std::string_view json)
+{
+  JSONLexer lexer(json);
+  std::vector<JSONTokenType> types;
+  for(JSONToken token{lexer.next()}; token.type != JSONTokenType::END; token = lexer.next())
+  {
+    types.push_back(token.type);
+    if(token.type == JSONTokenType::INVALID)
+    {
+      break;
+    }
+  }
+  return types;
+}
+
+TEST_CASE("JsonLexer empty input")
+{
+  REQUIRE(tokenTypes("").empty());
+  REQUIRE(tokenTypes(" \t\r\n").empty());
+}
+
+TEST_CASE("JsonLexer token types")
+{
+  std::vector<JSONTokenType> expected = {
+    JSONTokenType::OPEN_OBJECT, JSONTokenType::STRING, JSONTokenType::COLON, JSONTokenType::OPEN_ARRAY,
+    JSONTokenType::NUMBER, JSONTokenType::COMMA, JSONTokenType::TRUE, JSONTokenType::COMMA,
+    JSONTokenType::FALSE, JSONTokenType::COMMA, JSONTokenType::NULLT, JSONTokenType::CLOSE_ARRAY,
+    JSONTokenType::CLOSE_OBJECT
+  };
+
+  REQUIRE(tokenTypes("{\"key\" : [-1.5e3, true,false ,null]}") == expected);
+}
+
+TEST_CASE("JsonLexer tokens are views into the input")
+{
+  std::string json = R"({"x0":-71.3015509018757001, "name":"a \"quoted\" word"})";
+  JSONLexer lexer(json);
+
+  CHECK(lexer.next().type == JSONTokenType::OPEN_OBJECT);
+
+  JSONToken key = lexer.next();
+  CHECK(key.type == JSONTokenType::STRING);
+  CHECK(key.offset == 2);
+  CHECK(lexer.text(key) == "x0");
+
+  CHECK(lexer.next().type == JSONTokenType::COLON);
+
+  JSONToken number = lexer.next();
+  CHECK(number.type == JSONTokenType::NUMBER);
+  CHECK(lexer.text(number) == "-71.3015509018757001");
+
+  CHECK(lexer.next().type == JSONTokenType::COMMA);
+  CHECK(lexer.text(lexer.next()) == "name");
+  CHECK(lexer.next().type == JSONTokenType::COLON);
+
+  JSONToken value = lexer.next();
+  CHECK(value.type == JSONTokenType::STRING);
+  REQUIRE(lexer.text(value) == R"(a \"quoted\" word)");
+}
+
+TEST_CASE("JsonLexer invalid input")
+{
+  SECTION("unterminated string")
+  {
+    REQUIRE(tokenTypes("\"abc").back() == JSONTokenType::INVALID);
+  }
+
+  SECTION("misspelled literal")
+  {
+    REQUIRE(tokenTypes("[tru]").back() == JSONTokenType::INVALID);
+  }
+
+  SECTION("unknown character")
+  {
+    REQUIRE(tokenTypes("{#}").back() == JSONTokenType::INVALID);
+  }
+}
@@ -0,0 +1,244 @@
+#include "catch.hpp"
+#include "json_number.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+static bool parse(const std::string& text, double& value)
+{
+  return parseDouble(text.data(), text.data() + text.size(), value);
+}
+
+static void requireSameAsStrtod(const std::string& text)
+{
+  double value{0.0};
+  INFO(text);
+  REQUIRE(parse(text, value));
+
+  double expected{std::strtod(text.c_str(), nullptr)};
+  REQUIRE(std::memcmp(&value, &expected, sizeof(double)) == 0);
+}
+
+TEST_CASE("parseDouble simple values")
+{
+  for(const char* text : {"0", "-0", "1", "-1", "1.0", "2.5", "0.1", "-0.1", "123456789", "1e10", "1E-10", "1.5e+3",
+                          "0.0000000000000000001234", "9007199254740993", "18446744073709551615",
+                          "123456789012345678901234567890", "1e-300", "1.7976931348623157e308", "4.9e-324"})
+  {
+    requireSameAsStrtod(text);
+  }
+}
+
+TEST_CASE("parseDouble generator format matches strtod bit for bit")
+{
+  std::mt19937_64 generator(1234);
+  std::uniform_real_distribution<double> coordinates(-180.0, 180.0);
+  char text[64];
+
+  for(int i{0}; i < 200000; i++)
+  {
+    snprintf(text, sizeof(text), "%.16f", coordinates(generator));
+    requireSameAsStrtod(text);
+  }
+}
+
+TEST_CASE("parseDouble shortest round trip values match strtod")
+{
+  std::mt19937_64 generator(5678);
+  char text[64];
+
+  for(int i{0}; i < 200000; i++)
+  {
+    uint64_t bits{generator()};
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if(value != value || value - value != 0.0)
+    {
+      continue;
+    }
+
+    snprintf(text, sizeof(text), "%.17g", value);
+    requireSameAsStrtod(text);
+  }
+}
+
+TEST_CASE("parseDouble random digit strings match strtod")
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::uniform_int_distribution<int> length(1, 22);
+  std::uniform_int_distribution<int> exponent(-30, 30);
+
+  for(int i{0}; i < 200000; i++)
+  {
+    std::string text = (i & 1) ? "-" : "";
+    int integerDigits{length(generator)};
+    for(int d{0}; d < integerDigits; d++)
+    {
+      text += static_cast<char>('0' + digit(generator));
+    }
+    text += '.';
+    int fractionDigits{length(generator)};
+    for(int d{0}; d < fractionDigits; d++)
+    {
+      text += static_cast<char>('0' + digit(generator));
+    }
+    if(i & 2)
+    {
+      text += "e" + std::to_string(exponent(generator));
+    }
+    requireSameAsStrtod(text);
+  }
+}
+
+TEST_CASE("parseDouble rounds numbers of any length")
+{
+  const std::string digits(400, '7');
+  const std::string zeros(300, '0');
+  for(const std::string& text : {digits, "-" + digits, "0." + zeros + "123", "1." + digits + "e-5", digits + "e-380",
+                                 "0." + zeros + digits})
+  {
+    requireSameAsStrtod(text);
+  }
+
+  double value{0.0};
+  CHECK_FALSE(parse(digits + "x", value));
+}
+
+TEST_CASE("parseDouble rejects malformed numbers")
+{
+  double value{0.0};
+  for(const char* text : {"", "-", ".", "1.2.3", "1e", "1e+", "--1", "1x", "0x10", "inf", "nan", " 1"})
+  {
+    INFO(text);
+    CHECK_FALSE(parse(text, value));
+  }
+}
+
+static std::string fixed(double value, int precision)
+{
+  char text[MAX_FORMATTED_DOUBLE_LENGTH];
+  return {text, formatFixed(value, precision, text)};
+}
+
+static std::string shortest(double value)
+{
+  char text[MAX_FORMATTED_DOUBLE_LENGTH];
+  return {text, formatShortest(value, text)};
+}
+
+static void requireSameAsPrintf(double value, int precision)
+{
+  char expected[MAX_FORMATTED_DOUBLE_LENGTH + 1u];
+  snprintf(expected, sizeof(expected), "%.*f", precision, value);
+  INFO(expected);
+  REQUIRE(fixed(value, precision) == expected);
+}
+
+TEST_CASE("formatFixed simple values match printf")
+{
+  for(double value : {0.0, -0.0, 1.0, -1.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.1, 123.456, -1e-30, 5e-324, 9.999999999,
+                      9223372036854775807.0, 1e300, -1.7976931348623157e308})
+  {
+    for(int precision{0}; precision <= MAX_FIXED_PRECISION; precision++)
+    {
+      requireSameAsPrintf(value, precision);
+    }
+  }
+}
+
+TEST_CASE("formatFixed generator coordinates match printf")
+{
+  std::mt19937_64 generator(1234);
+  std::uniform_real_distribution<double> coordinates(-180.0, 180.0);
+
+  for(int i{0}; i < 200000; i++)
+  {
+    requireSameAsPrintf(coordinates(generator), 16);
+  }
+}
+
+TEST_CASE("formatFixed random doubles match printf")
+{
+  std::mt19937_64 generator(5678);
+  std::uniform_int_distribution<int> precision(0, MAX_FIXED_PRECISION);
+  std::uniform_int_distribution<int> shift(0, 20);
+
+  for(int i{0}; i < 200000; i++)
+  {
+    // NOTE: Random bits cover every exponent, small integers over powers of two hit the rounding ties
+    double value;
+    if(i & 1)
+    {
+      uint64_t bits{generator()};
+      std::memcpy(&value, &bits, sizeof(value));
+    }
+    else
+    {
+      value = std::ldexp(static_cast<double>(static_cast<int64_t>(generator() % 2000001u) - 1000000), -shift(generator));
+    }
+    requireSameAsPrintf(value, precision(generator));
+  }
+}
+
+TEST_CASE("formatShortest simple values")
+{
+  CHECK(shortest(0.0) == "0");
+  CHECK(shortest(-0.0) == "-0");
+  CHECK(shortest(1.0) == "1");
+  CHECK(shortest(0.1) == "0.1");
+  CHECK(shortest(-2.5) == "-2.5");
+  CHECK(shortest(123.456) == "123.456");
+  CHECK(shortest(1e20) == "100000000000000000000");
+  CHECK(shortest(1e21) == "1e+21");
+  CHECK(shortest(0.000001) == "0.000001");
+  CHECK(shortest(1.5e-7) == "1.5e-7");
+  CHECK(shortest(5e-324) == "5e-324");
+  CHECK(shortest(1.7976931348623157e308) == "1.7976931348623157e+308");
+}
+
+// Significant digits of formatShortest's text - leading and trailing zeros and the exponent don't count
+static size_t significantDigits(const std::string& text)
+{
+  std::string digits;
+  for(char c : text.substr(0u, text.find('e')))
+  {
+    if(c >= '0' && c <= '9')
+    {
+      digits += c;
+    }
+  }
+  const size_t first{digits.find_first_not_of('0')};
+  return first == std::string::npos ? 0u : digits.find_last_not_of('0') - first + 1u;
+}
+
+TEST_CASE("formatShortest round trips with at most 17 digits")
+{
+  std::mt19937_64 generator(91011);
+  std::uniform_real_distribution<double> coordinates(-180.0, 180.0);
+
+  for(int i{0}; i < 200000; i++)
+  {
+    double value{coordinates(generator)};
+    if(i & 1)
+    {
+      uint64_t bits{generator()};
+      std::memcpy(&value, &bits, sizeof(value));
+      if(value != value || value - value != 0.0)
+      {
+        continue;
+      }
+    }
+
+    const std::string text{shortest(value)};
+    INFO(text);
+    double parsed{0.0};
+    REQUIRE(parse(text, parsed));
+    REQUIRE(std::memcmp(&value, &parsed, sizeof(double)) == 0);
+    REQUIRE(significantDigits(text) <= 17u);
+  }
+}
@@ -282,3 +282,192 @@ TEST_CASE("JsonParse very large json 50000 json object array")
 }
 
 
+
+TEST_CASE("JsonParse nested containers")
+{
+  std::string json = R"({"outer":{"inner":[1, [2, 3], {"deep":"value"}], "empty":{}, "list":[]}, "flag":false})";
+
+  auto result = JSONParser::parse(json);
+  CHECK(result.type() == JSONType::OBJECT);
+  CHECK(result["flag"].type() == JSONType::BOOL);
+  REQUIRE(result["flag"].get<bool>() == false);
+
+  auto& inner = result["outer"]["inner"].getArray();
+  REQUIRE(inner.size() == 3);
+  CHECK(inner[0].get<double>() == 1.0);
+  REQUIRE(inner[1].getArray().size() == 2);
+  CHECK(inner[1].getArray()[1].get<double>() == 3.0);
+  REQUIRE(inner[2]["deep"].get<std::string>() == "value");
+
+  CHECK(result["outer"]["empty"].type() == JSONType::OBJECT);
+  CHECK(result["outer"]["empty"].isEmpty());
+  REQUIRE(result["outer"]["list"].getArray().empty());
+}
+
+TEST_CASE("JsonParse malformed input gives null")
+{
+  CHECK(JSONParser::parse("{\"key\":}").type() == JSONType::NULLT);
+  CHECK(JSONParser::parse("{\"key\" 1}").type() == JSONType::NULLT);
+  CHECK(JSONParser::parse("[1, 2").type() == JSONType::NULLT);
+  CHECK(JSONParser::parse("[1 2]").type() == JSONType::NULLT);
+  CHECK(JSONParser::parse("{}}").type() == JSONType::NULLT);
+  REQUIRE(JSONParser::parse("{\"key\":1.2.3}").type() == JSONType::NULLT);
+}
+
+TEST_CASE("JsonParsePairs generator format")
+{
+  std::string json = R"({"pairs":[
+    {"x0":-71.3015509018757001, "y0":-176.9483879090714424, "x1":-68.8159353647142495, "y1":-177.4700140406496303},
+    {"y1":-74.005974, "x1":40.712776, "y0":-118.243683, "x0":34.052235}
+]})";
+
+  HaversinePairs pairs;
+  REQUIRE(JSONParser::parsePairs(json, pairs));
+  REQUIRE(pairs.size() == 2);
+
+  CHECK(pairs.x0[0] == -71.3015509018757001);
+  CHECK(pairs.y0[0] == -176.9483879090714424);
+  CHECK(pairs.x1[0] == -68.8159353647142495);
+  CHECK(pairs.y1[0] == -177.4700140406496303);
+
+  CHECK(pairs.x0[1] == 34.052235);
+  CHECK(pairs.y0[1] == -118.243683);
+  CHECK(pairs.x1[1] == 40.712776);
+  REQUIRE(pairs.y1[1] == -74.005974);
+}
+
+TEST_CASE("JsonParsePairs empty array")
+{
+  HaversinePairs pairs;
+  REQUIRE(JSONParser::parsePairs(R"({"pairs":[]})", pairs));
+  REQUIRE(pairs.size() == 0);
+}
+
+TEST_CASE("JsonParsePairs rejects other shapes")
+{
+  std::vector<std::string> inputs = {
+    R"({"pairs":[{"x0":1, "y0":2, "x1":3}]})",
+    R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4, "z0":5}]})",
+    R"({"pairs":[{"x0":1, "y0":2, "x1":3, "x1":4}]})",
+    R"({"pairs":[{"x0":"1", "y0":2, "x1":3, "y1":4}]})",
+    R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4}], "extra":true})",
+    R"({"points":[{"x0":1, "y0":2, "x1":3, "y1":4}]})",
+    R"([{"x0":1, "y0":2, "x1":3, "y1":4}])",
+    R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4})"
+  };
+
+  for(const auto& json : inputs)
+  {
+    HaversinePairs pairs;
+    pairs.reserve(64u);
+    CHECK_FALSE(JSONParser::parsePairs(json, pairs));
+    CHECK(pairs.size() == 0);
+    // NOTE: --batch keeps one pairs buffer for every file, a rejected one mustn't free it
+    CHECK(pairs.x0.capacity() >= 64u);
+    CHECK(pairs.y1.capacity() >= 64u);
+  }
+}
+
+// Feeds json to a stream parser chunkSize bytes at a time, carrying the unparsed tail over like the CLI does
+static JSONPairsStreamParser::Status parsePairsInChunks(const std::string& json, size_t chunkSize,
+                                                         HaversinePairs& pairs)
+{
+  JSONPairsStreamParser parser;
+  std::string buffer;
+  size_t offset{0u};
+  for(;;)
+  {
+    buffer += json.substr(offset, chunkSize);
+    offset += chunkSize;
+    const bool isFinal{offset >= json.size()};
+
+    size_t consumed{0u};
+    auto status = parser.parse(buffer, isFinal, pairs, consumed);
+    if(status != JSONPairsStreamParser::Status::NEED_MORE || isFinal)
+    {
+      return status;
+    }
+    buffer.erase(0, consumed);
+  }
+}
+
+TEST_CASE("JsonPairsStreamParser matches parsePairs for every chunk size")
+{
+  std::string json = R"({"pairs":[
+    {"x0":-71.3015509018757001, "y0":-176.9483879090714424, "x1":-68.8159353647142495, "y1":-177.4700140406496303},
+    {"y1":-74.005974, "x1":40.712776, "y0":-118.243683, "x0":34.052235},
+    {"x0":51.507351, "y0":-0.127758, "x1":48.856613, "y1":2.352222}
+]} )";
+
+  HaversinePairs expected;
+  REQUIRE(JSONParser::parsePairs(json, expected));
+
+  for(size_t chunkSize{1u}; chunkSize <= json.size(); chunkSize++)
+  {
+    INFO(chunkSize);
+    HaversinePairs pairs;
+    REQUIRE(parsePairsInChunks(json, chunkSize, pairs) == JSONPairsStreamParser::Status::DONE);
+    REQUIRE(pairs.x0 == expected.x0);
+    REQUIRE(pairs.y0 == expected.y0);
+    REQUIRE(pairs.x1 == expected.x1);
+    REQUIRE(pairs.y1 == expected.y1);
+  }
+}
+
+TEST_CASE("JsonPairsStreamParser rejects truncated and malformed input")
+{
+  for(const std::string json : {R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4})", R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4}]}, 5)",
+                                R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4},]})", R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4.5.6}]})"})
+  {
+    for(size_t chunkSize : {1u, 7u, 1000u})
+    {
+      INFO(json << " in chunks of " << chunkSize);
+      HaversinePairs pairs;
+      REQUIRE(parsePairsInChunks(json, chunkSize, pairs) == JSONPairsStreamParser::Status::INVALID);
+    }
+  }
+}
+
+TEST_CASE("JsonParser parsePairRecords matches parsePairs when split at record starts")
+{
+  std::string json = R"( {"pairs" : [
+    {"x0":-71.3015509018757001, "y0":-176.9483879090714424, "x1":-68.8159353647142495, "y1":-177.4700140406496303},
+    {"y1":-74.005974, "x1":40.712776, "y0":-118.243683, "x0":34.052235},
+    {"x0":51.507351, "y0":-0.127758, "x1":48.856613, "y1":2.352222}
+] } )";
+
+  HaversinePairs expected;
+  REQUIRE(JSONParser::parsePairs(json, expected));
+
+  size_t begin{0u};
+  size_t end{0u};
+  REQUIRE(JSONParser::findPairsArray(json, begin, end));
+  std::string_view records{std::string_view(json).substr(begin, end - begin)};
+
+  std::vector<size_t> recordStarts;
+  for(size_t offset{records.find('{')}; offset != std::string_view::npos; offset = records.find('{', offset + 1u))
+  {
+    recordStarts.push_back(offset);
+  }
+  REQUIRE(recordStarts.size() == 3u);
+
+  for(size_t split : recordStarts)
+  {
+    INFO("split at " << split);
+    HaversinePairs pairs;
+    bool endsWithComma{false};
+    REQUIRE(JSONParser::parsePairRecords(records.substr(0u, split), pairs, endsWithComma));
+    REQUIRE(endsWithComma == (split != recordStarts.front()));
+    REQUIRE(JSONParser::parsePairRecords(records.substr(split), pairs, endsWithComma));
+    REQUIRE_FALSE(endsWithComma);
+    REQUIRE(pairs.x0 == expected.x0);
+    REQUIRE(pairs.y1 == expected.y1);
+  }
+
+  HaversinePairs pairs;
+  bool endsWithComma{false};
+  REQUIRE_FALSE(JSONParser::findPairsArray(R"({"pairs":[{"x0":1, "y0":2, "x1":3, "y1":4}])", begin, end));
+  REQUIRE_FALSE(JSONParser::findPairsArray(R"({"points":[]})", begin, end));
+  REQUIRE_FALSE(JSONParser::parsePairRecords(R"({"x0":1, "y0":2, "x1":3, "y1":4},,)", pairs, endsWithComma));
+  REQUIRE_FALSE(JSONParser::parsePairRecords(R"({"x0":1, "y0":2, "x1":3})", pairs, endsWithComma));
+}
@@ -0,0 +1,152 @@
+#include "catch.hpp"
+#include "json_lexer.h"
+#include "json_parser.h"
+#include "json_structural_index.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+static const StructuralKernel ALL_KERNELS[] = {StructuralKernel::SCALAR, StructuralKernel::SSE42,
+                                               StructuralKernel::AVX2};
+
+static std::vector<size_t> indexPositions(std::string_view json, StructuralKernel kernel)
+{
+  JSONStructuralIndexer indexer(json, kernel);
+  REQUIRE(indexer.kernel() == kernel);
+
+  std::vector<size_t> positions;
+  size_t batch[STRUCTURAL_BATCH_SIZE];
+  while(!indexer.done())
+  {
+    positions.insert(positions.end(), batch, batch + indexer.nextBatch(batch));
+  }
+  return positions;
+}
+
+static std::vector<std::pair<JSONTokenType, std::string_view>> tokens(JSONLexer& lexer)
+{
+  std::vector<std::pair<JSONTokenType, std::string_view>> result;
+  for(JSONToken token{lexer.next()}; token.type != JSONTokenType::END; token = lexer.next())
+  {
+    result.emplace_back(token.type, lexer.text(token));
+    if(token.type == JSONTokenType::INVALID)
+    {
+      break;
+    }
+  }
+  return result;
+}
+
+// Every supported kernel must give the same index, and lexing through it the same tokens as the plain lexer
+static void requireIndexedLexingMatches(std::string_view json)
+{
+  INFO(json);
+  JSONLexer plainLexer(json);
+  const auto expected{tokens(plainLexer)};
+
+  for(StructuralKernel kernel : ALL_KERNELS)
+  {
+    if(!isStructuralKernelSupported(kernel))
+    {
+      continue;
+    }
+    INFO(structuralKernelName(kernel));
+
+    REQUIRE(indexPositions(json, kernel) == indexPositions(json, StructuralKernel::SCALAR));
+
+    JSONLexer indexedLexer(json, kernel);
+    REQUIRE(tokens(indexedLexer) == expected);
+  }
+}
+
+TEST_CASE("StructuralIndex positions")
+{
+  std::string_view json{R"({"a" : [1, -2.5e3,true], "b\"{" : null})"};
+  std::vector<size_t> expected{0, 1, 3, 5, 7, 8, 9, 11, 17, 18, 22, 23, 25, 30, 32, 34, 38};
+
+  for(StructuralKernel kernel : ALL_KERNELS)
+  {
+    if(isStructuralKernelSupported(kernel))
+    {
+      INFO(structuralKernelName(kernel));
+      REQUIRE(indexPositions(json, kernel) == expected);
+    }
+  }
+}
+
+TEST_CASE("StructuralIndex empty input")
+{
+  REQUIRE(indexPositions("", StructuralKernel::SCALAR).empty());
+
+  JSONLexer lexer("", bestStructuralKernel());
+  REQUIRE(lexer.next().type == JSONTokenType::END);
+}
+
+TEST_CASE("StructuralIndex lexing matches the plain lexer")
+{
+  SECTION("strings holding structural characters and escapes")
+  {
+    requireIndexedLexingMatches(R"({"{[,:]}" : "a \"b\" \\", "c\\\"" : [ "\\\\" , "]" ]})");
+  }
+
+  SECTION("adjacent tokens")
+  {
+    requireIndexedLexingMatches(R"([1,"a",true,{"b":false},null,[]])");
+  }
+
+  SECTION("backslash runs crossing a block boundary")
+  {
+    for(size_t padding{0u}; padding < 70u; padding++)
+    {
+      for(size_t backslashes{1u}; backslashes < 6u; backslashes++)
+      {
+        std::string json{"[\"" + std::string(padding, 'a') + std::string(backslashes, '\\') + "\"\"], 1]"};
+        requireIndexedLexingMatches(json);
+      }
+    }
+  }
+
+  SECTION("strings and numbers crossing a block boundary")
+  {
+    for(size_t padding{0u}; padding < 70u; padding++)
+    {
+      std::string json{"[" + std::string(padding, ' ') + "\"" + std::string(70, 'x') + "\", 12345678901234567890]"};
+      requireIndexedLexingMatches(json);
+    }
+  }
+
+  SECTION("strings crossing a batch boundary")
+  {
+    for(size_t padding : {STRUCTURAL_BATCH_SIZE - 70u, STRUCTURAL_BATCH_SIZE - 2u, STRUCTURAL_BATCH_SIZE - 1u})
+    {
+      std::string json{"[" + std::string(padding, ' ') + "\"a\\\"b\", \"" + std::string(3000, ',') + "\", 1]"};
+      requireIndexedLexingMatches(json);
+    }
+  }
+
+  SECTION("random generator-style documents")
+  {
+    std::mt19937_64 random(4);
+    std::uniform_real_distribution<double> coordinate(-180.0, 180.0);
+    std::string json{"{\"pairs\":[\n"};
+    for(int pair{0}; pair < 500; pair++)
+    {
+      json += (pair ? ",\n" : "");
+      json += "{\"x0\":" + std::to_string(coordinate(random)) + ", \"y0\":" + std::to_string(coordinate(random)) +
+              ",\"x1\":" + std::to_string(coordinate(random)) + ",\t\"y1\":" + std::to_string(coordinate(random)) +
+              "}";
+    }
+    json += "\n]}";
+    requireIndexedLexingMatches(json);
+  }
+}
+
+TEST_CASE("StructuralIndex malformed input still parses to null")
+{
+  for(std::string_view json : {"\"abc", "[tru]", "[truex]", "[1x]", "{#}", "[1 2]", "[\"a\"1]"})
+  {
+    INFO(json);
+    REQUIRE(JSONParser::parse(json).type() == JSONType::NULLT);
+  }
+}
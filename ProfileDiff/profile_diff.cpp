@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json_parser.h"
+#include "profile_export_format.h"
+
+constexpr double DEFAULT_THRESHOLD_PERCENT{5.0};
+constexpr double DEFAULT_MIN_SHARE_PERCENT{1.0};
+
+// One label of a profile, in seconds. Sites that share a label are summed.
+struct LabelStats
+{
+  double exclusiveSeconds{0.0};
+  double inclusiveSeconds{0.0};
+  double bandwidthSeconds{0.0}; // the single thread time the bytes were processed in
+  uint64_t hitCount{0u};
+  uint64_t byteCount{0u};
+
+  [[nodiscard]] double gigabytesPerSecond() const
+  {
+    return bandwidthSeconds > 0.0 ? static_cast<double>(byteCount) / (bandwidthSeconds * 1024.0 * 1024.0 * 1024.0)
+                                  : 0.0;
+  }
+};
+
+struct ProfileSnapshot
+{
+  std::string path;
+  double totalSeconds{0.0};
+  std::vector<std::string> labels; // in the order the profile lists them
+  std::unordered_map<std::string, LabelStats> stats;
+
+  void add(const std::string& label, double timerFreq, uint64_t exclusive, uint64_t inclusive, uint64_t longest,
+           uint64_t hits, uint64_t bytes)
+  {
+    auto [entry, inserted] = stats.try_emplace(label);
+    if(inserted)
+    {
+      labels.push_back(label);
+    }
+    LabelStats& labelStats{entry->second};
+    labelStats.exclusiveSeconds += static_cast<double>(exclusive) / timerFreq;
+    labelStats.inclusiveSeconds += static_cast<double>(inclusive) / timerFreq;
+    labelStats.bandwidthSeconds += static_cast<double>(longest) / timerFreq;
+    labelStats.hitCount += hits;
+    labelStats.byteCount += bytes;
+  }
+};
+
+struct DiffOptions
+{
+  std::vector<std::string> paths; // the baseline, then every profile compared against it
+  double thresholdPercent{DEFAULT_THRESHOLD_PERCENT};
+  double minSharePercent{DEFAULT_MIN_SHARE_PERCENT};
+};
+
+void printUsage(const char* program)
+{
+  std::cerr << "Usage: " << program << " <baseline_profile> <profile> [<profile>...] [--threshold=<percent>]"
+            << " [--min-share=<percent>]" << std::endl;
+  std::cerr << "  Compares every profile against the baseline, label by label. The profiles are the anchor tables"
+            << " haversine_cli_app --profile-out writes, JSON or binary." << std::endl;
+  std::cerr << "  --threshold=<percent>  a label regresses when its inclusive time grows, or its bandwidth drops, by"
+            << " more than this (default " << DEFAULT_THRESHOLD_PERCENT << ")" << std::endl;
+  std::cerr << "  --min-share=<percent>  labels under this share of the baseline's total time are shown but never"
+            << " flagged, they are mostly noise (default " << DEFAULT_MIN_SHARE_PERCENT << ")" << std::endl;
+  std::cerr << "  Exits with 1 when a regression was found, 2 when the arguments or a profile are invalid."
+            << std::endl;
+}
+
+bool parsePercent(const std::string& value, double& percent)
+{
+  char* end{nullptr};
+  percent = std::strtod(value.c_str(), &end);
+  return !value.empty() && *end == '\0' && percent >= 0.0;
+}
+
+bool parseCliArgs(int argc, char* argv[], DiffOptions& options)
+{
+  for(int argIndex{1}; argIndex < argc; argIndex++)
+  {
+    const std::string arg{argv[argIndex]};
+    if(arg.rfind("--threshold=", 0) == 0)
+    {
+      if(!parsePercent(arg.substr(std::string("--threshold=").size()), options.thresholdPercent))
+      {
+        std::cerr << "Error: --threshold must be a percentage" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--min-share=", 0) == 0)
+    {
+      if(!parsePercent(arg.substr(std::string("--min-share=").size()), options.minSharePercent))
+      {
+        std::cerr << "Error: --min-share must be a percentage" << std::endl;
+        return false;
+      }
+    }
+    else if(arg.rfind("--", 0) == 0)
+    {
+      std::cerr << "Error: Unknown option " << arg << std::endl;
+      printUsage(argv[0]);
+      return false;
+    }
+    else
+    {
+      options.paths.push_back(arg);
+    }
+  }
+
+  if(options.paths.size() < 2u)
+  {
+    printUsage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+void readBinaryProfile(std::ifstream& file, ProfileSnapshot& profile)
+{
+  ProfileExportHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if(!file || header.version != PROFILE_EXPORT_VERSION || header.timerFreq == 0u)
+  {
+    throw std::runtime_error("Unsupported binary profile version or missing timer frequency");
+  }
+
+  const double timerFreq{static_cast<double>(header.timerFreq)};
+  profile.totalSeconds = static_cast<double>(header.totalTSCElapsed) / timerFreq;
+  for(uint32_t anchorIndex{0u}; anchorIndex < header.anchorCount; anchorIndex++)
+  {
+    ProfileExportAnchor record{};
+    file.read(reinterpret_cast<char*>(&record), sizeof(record));
+    std::string label(record.labelLength, '\0');
+    file.read(label.data(), static_cast<std::streamsize>(label.size()));
+    if(!file)
+    {
+      throw std::runtime_error("Truncated binary profile");
+    }
+    profile.add(label, timerFreq, record.tscElapsedExclusive, record.tscElapsedInclusive,
+                record.longestTSCElapsedInclusive, record.hitCount, record.processedByteCount);
+  }
+}
+
+uint64_t jsonCount(const JSONNode& node, const std::string& key)
+{
+  const JSONNode& value{node[key]};
+  if(value.type() != JSONType::NUMBER)
+  {
+    throw std::runtime_error("Missing \"" + key + "\" in a JSON profile");
+  }
+  return static_cast<uint64_t>(value.get<double>());
+}
+
+void readJsonProfile(std::ifstream& file, ProfileSnapshot& profile)
+{
+  std::stringstream text;
+  text << file.rdbuf();
+  JSONNode root{JSONParser::parse(text.str())};
+  if(root.type() != JSONType::OBJECT || root["anchors"].type() != JSONType::ARRAY ||
+     jsonCount(root, "version") != PROFILE_EXPORT_VERSION)
+  {
+    throw std::runtime_error("Not a JSON profile of a supported version");
+  }
+
+  const double timerFreq{static_cast<double>(jsonCount(root, "timer_freq"))};
+  if(timerFreq == 0.0)
+  {
+    throw std::runtime_error("The JSON profile has no timer frequency");
+  }
+  profile.totalSeconds = static_cast<double>(jsonCount(root, "total_tsc")) / timerFreq;
+  for(JSONNode& anchor : root["anchors"].getArray())
+  {
+    if(anchor.type() != JSONType::OBJECT || anchor["label"].type() != JSONType::STRING)
+    {
+      throw std::runtime_error("An anchor of the JSON profile has no label");
+    }
+    profile.add(anchor["label"].get<std::string>(), timerFreq, jsonCount(anchor, "exclusive_tsc"),
+                jsonCount(anchor, "inclusive_tsc"), jsonCount(anchor, "longest_inclusive_tsc"),
+                jsonCount(anchor, "hits"), jsonCount(anchor, "bytes"));
+  }
+}
+
+// Tells the two formats apart by the binary magic. Throws std::runtime_error when the file can't be read or parsed.
+ProfileSnapshot readProfile(const std::string& path)
+{
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if(!file)
+  {
+    throw std::runtime_error("Could not open " + path);
+  }
+
+  ProfileSnapshot profile;
+  profile.path = path;
+  char magic[sizeof(PROFILE_EXPORT_MAGIC)]{};
+  file.read(magic, sizeof(magic));
+  const bool binary{file.gcount() == sizeof(magic) && std::memcmp(magic, PROFILE_EXPORT_MAGIC, sizeof(magic)) == 0};
+  file.clear();
+  file.seekg(0, std::ios::beg);
+  if(binary)
+  {
+    readBinaryProfile(file, profile);
+  }
+  else
+  {
+    readJsonProfile(file, profile);
+  }
+  return profile;
+}
+
+double percentChange(double before, double after)
+{
+  return before > 0.0 ? 100.0 * (after - before) / before : 0.0;
+}
+
+// Prints one line per label of either profile and returns how many regressed. Labels only one side has are listed
+// as added or removed, they can't regress.
+size_t diffProfiles(const ProfileSnapshot& baseline, const ProfileSnapshot& profile, const DiffOptions& options)
+{
+  fprintf(stdout, "\n%s -> %s\n", baseline.path.c_str(), profile.path.c_str());
+  fprintf(stdout, "%-28s %11s %11s %8s %11s %11s %8s %10s %9s %9s %8s\n", "label", "excl ms", "new", "delta",
+          "incl ms", "new", "delta", "hits delta", "gb/s", "new", "delta");
+
+  std::vector<std::string> labels{baseline.labels};
+  for(const std::string& label : profile.labels)
+  {
+    if(!baseline.stats.count(label))
+    {
+      labels.push_back(label);
+    }
+  }
+
+  size_t regressionCount{0u};
+  for(const std::string& label : labels)
+  {
+    const auto before{baseline.stats.find(label)};
+    const auto after{profile.stats.find(label)};
+    if(after == profile.stats.end() || before == baseline.stats.end())
+    {
+      const LabelStats& stats{after == profile.stats.end() ? before->second : after->second};
+      fprintf(stdout, "%-28s %s, %.3fms inclusive\n", label.c_str(),
+              after == profile.stats.end() ? "removed" : "added", stats.inclusiveSeconds * 1000.0);
+      continue;
+    }
+
+    const LabelStats& old{before->second};
+    const LabelStats& now{after->second};
+    const double inclusiveChange{percentChange(old.inclusiveSeconds, now.inclusiveSeconds)};
+    const double bandwidthChange{percentChange(old.gigabytesPerSecond(), now.gigabytesPerSecond())};
+    const double share{baseline.totalSeconds > 0.0 ? 100.0 * old.inclusiveSeconds / baseline.totalSeconds : 0.0};
+    const bool regressed{share >= options.minSharePercent &&
+                         (inclusiveChange > options.thresholdPercent ||
+                          (old.byteCount && now.byteCount && -bandwidthChange > options.thresholdPercent))};
+    regressionCount += regressed;
+
+    fprintf(stdout, "%-28s %11.3f %11.3f %+7.1f%% %11.3f %11.3f %+7.1f%% %+10lld", label.c_str(),
+            old.exclusiveSeconds * 1000.0, now.exclusiveSeconds * 1000.0,
+            percentChange(old.exclusiveSeconds, now.exclusiveSeconds), old.inclusiveSeconds * 1000.0,
+            now.inclusiveSeconds * 1000.0, inclusiveChange,
+            static_cast<long long>(now.hitCount) - static_cast<long long>(old.hitCount));
+    if(old.byteCount || now.byteCount)
+    {
+      fprintf(stdout, " %9.3f %9.3f %+7.1f%%", old.gigabytesPerSecond(), now.gigabytesPerSecond(), bandwidthChange);
+    }
+    fprintf(stdout, "%s\n", regressed ? "  REGRESSION" : "");
+  }
+
+  const double totalChange{percentChange(baseline.totalSeconds, profile.totalSeconds)};
+  fprintf(stdout, "Total: %.3fms -> %.3fms (%+.1f%%), %zu regression%s over %.1f%%\n", baseline.totalSeconds * 1000.0,
+          profile.totalSeconds * 1000.0, totalChange, regressionCount, regressionCount == 1u ? "" : "s",
+          options.thresholdPercent);
+  return regressionCount;
+}
+
+int main(int argc, char* argv[])
+{
+  DiffOptions options;
+  if(!parseCliArgs(argc, argv, options))
+  {
+    return 2;
+  }
+
+  std::vector<ProfileSnapshot> profiles;
+  try
+  {
+    for(const std::string& path : options.paths)
+    {
+      profiles.push_back(readProfile(path));
+    }
+  }
+  catch(const std::exception& error)
+  {
+    std::cerr << "Error: " << error.what() << std::endl;
+    return 2;
+  }
+
+  size_t regressionCount{0u};
+  for(size_t profileIndex{1u}; profileIndex < profiles.size(); profileIndex++)
+  {
+    regressionCount += diffProfiles(profiles[0], profiles[profileIndex], options);
+  }
+  return regressionCount ? 1 : 0;
+}
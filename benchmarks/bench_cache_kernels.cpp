@@ -0,0 +1,57 @@
+#include "bench_cache_kernels.h"
+
+#include <emmintrin.h>
+
+// NOTE: Four independent vectors per step everywhere, so neither the OR chain nor the loop overhead limits the rate
+// before the loads and stores do
+
+uint64_t cacheReadSse2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t mask{workingSet - 1u};
+  __m128i sum0{_mm_setzero_si128()};
+  __m128i sum1{_mm_setzero_si128()};
+  __m128i sum2{_mm_setzero_si128()};
+  __m128i sum3{_mm_setzero_si128()};
+  for(size_t done{0u}; done < byteCount; done += 64u)
+  {
+    const __m128i* source{reinterpret_cast<const __m128i*>(data + (done & mask))};
+    sum0 = _mm_or_si128(sum0, _mm_load_si128(source));
+    sum1 = _mm_or_si128(sum1, _mm_load_si128(source + 1));
+    sum2 = _mm_or_si128(sum2, _mm_load_si128(source + 2));
+    sum3 = _mm_or_si128(sum3, _mm_load_si128(source + 3));
+  }
+  const __m128i sum{_mm_or_si128(_mm_or_si128(sum0, sum1), _mm_or_si128(sum2, sum3))};
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(sum));
+}
+
+uint64_t cacheWriteSse2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t mask{workingSet - 1u};
+  const __m128i value{_mm_set1_epi8(1)};
+  for(size_t done{0u}; done < byteCount; done += 64u)
+  {
+    __m128i* destination{reinterpret_cast<__m128i*>(data + (done & mask))};
+    _mm_store_si128(destination, value);
+    _mm_store_si128(destination + 1, value);
+    _mm_store_si128(destination + 2, value);
+    _mm_store_si128(destination + 3, value);
+  }
+  return 0u;
+}
+
+uint64_t cacheCopySse2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t half{workingSet / 2u};
+  const size_t mask{half - 1u};
+  for(size_t done{0u}; done < byteCount; done += 128u)
+  {
+    const size_t offset{(done / 2u) & mask};
+    const __m128i* source{reinterpret_cast<const __m128i*>(data + offset)};
+    __m128i* destination{reinterpret_cast<__m128i*>(data + half + offset)};
+    _mm_store_si128(destination, _mm_load_si128(source));
+    _mm_store_si128(destination + 1, _mm_load_si128(source + 1));
+    _mm_store_si128(destination + 2, _mm_load_si128(source + 2));
+    _mm_store_si128(destination + 3, _mm_load_si128(source + 3));
+  }
+  return 0u;
+}
@@ -0,0 +1,23 @@
+#ifndef PERFAWARE_PROFILING_BENCHMARKS_BENCH_CACHE_KERNELS_H_
+#define PERFAWARE_PROFILING_BENCHMARKS_BENCH_CACHE_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Bandwidth kernels for the cache sweep. Each moves byteCount bytes through the first workingSet bytes of data, going
+// round the working set as often as it takes. workingSet is a power of two of at least 4096, byteCount a multiple of
+// 256, and data is 64 byte aligned.
+//
+// read ORs every loaded vector together and returns the result, so the loads can't be dropped. write stores a
+// constant. copy copies the first half of the working set to the second half, and counts both the bytes read and the
+// bytes written.
+uint64_t cacheReadSse2(char* data, size_t workingSet, size_t byteCount);
+uint64_t cacheWriteSse2(char* data, size_t workingSet, size_t byteCount);
+uint64_t cacheCopySse2(char* data, size_t workingSet, size_t byteCount);
+
+// Built with -mavx2, only call them once getCpuFeatures() reports AVX2
+uint64_t cacheReadAvx2(char* data, size_t workingSet, size_t byteCount);
+uint64_t cacheWriteAvx2(char* data, size_t workingSet, size_t byteCount);
+uint64_t cacheCopyAvx2(char* data, size_t workingSet, size_t byteCount);
+
+#endif //PERFAWARE_PROFILING_BENCHMARKS_BENCH_CACHE_KERNELS_H_
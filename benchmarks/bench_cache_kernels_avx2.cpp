@@ -0,0 +1,59 @@
+// Built with -mavx2, only called once getCpuFeatures() reports AVX2
+#include "bench_cache_kernels.h"
+
+#include <immintrin.h>
+
+uint64_t cacheReadAvx2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t mask{workingSet - 1u};
+  __m256i sum0{_mm256_setzero_si256()};
+  __m256i sum1{_mm256_setzero_si256()};
+  __m256i sum2{_mm256_setzero_si256()};
+  __m256i sum3{_mm256_setzero_si256()};
+  for(size_t done{0u}; done < byteCount; done += 128u)
+  {
+    const __m256i* source{reinterpret_cast<const __m256i*>(data + (done & mask))};
+    sum0 = _mm256_or_si256(sum0, _mm256_load_si256(source));
+    sum1 = _mm256_or_si256(sum1, _mm256_load_si256(source + 1));
+    sum2 = _mm256_or_si256(sum2, _mm256_load_si256(source + 2));
+    sum3 = _mm256_or_si256(sum3, _mm256_load_si256(source + 3));
+  }
+  const __m256i sum{_mm256_or_si256(_mm256_or_si256(sum0, sum1), _mm256_or_si256(sum2, sum3))};
+  const uint64_t result{static_cast<uint64_t>(_mm256_extract_epi64(sum, 0) | _mm256_extract_epi64(sum, 3))};
+  _mm256_zeroupper();
+  return result;
+}
+
+uint64_t cacheWriteAvx2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t mask{workingSet - 1u};
+  const __m256i value{_mm256_set1_epi8(1)};
+  for(size_t done{0u}; done < byteCount; done += 128u)
+  {
+    __m256i* destination{reinterpret_cast<__m256i*>(data + (done & mask))};
+    _mm256_store_si256(destination, value);
+    _mm256_store_si256(destination + 1, value);
+    _mm256_store_si256(destination + 2, value);
+    _mm256_store_si256(destination + 3, value);
+  }
+  _mm256_zeroupper();
+  return 0u;
+}
+
+uint64_t cacheCopyAvx2(char* data, size_t workingSet, size_t byteCount)
+{
+  const size_t half{workingSet / 2u};
+  const size_t mask{half - 1u};
+  for(size_t done{0u}; done < byteCount; done += 256u)
+  {
+    const size_t offset{(done / 2u) & mask};
+    const __m256i* source{reinterpret_cast<const __m256i*>(data + offset)};
+    __m256i* destination{reinterpret_cast<__m256i*>(data + half + offset)};
+    _mm256_store_si256(destination, _mm256_load_si256(source));
+    _mm256_store_si256(destination + 1, _mm256_load_si256(source + 1));
+    _mm256_store_si256(destination + 2, _mm256_load_si256(source + 2));
+    _mm256_store_si256(destination + 3, _mm256_load_si256(source + 3));
+  }
+  _mm256_zeroupper();
+  return 0u;
+}
@@ -0,0 +1,308 @@
+/* ========================================================================
+   Cache hierarchy bandwidth sweep. Times read, write and copy bandwidth
+   over working sets from 4kb up to --max-mb (1gb by default) under the
+   repetition tester, on one thread and then on every core at once, and
+   writes one CSV row per measurement to --csv. Each curve is split into
+   plateaus - runs of working sets at about the same bandwidth - labeled
+   L1, L2, L3 and, when the sweep went far past any cache, DRAM.
+
+   --profile=<file> saves what the single-thread read curve shows as a
+   machine profile (common/machine_profile.h). haversine_cli_app sizes its
+   chunks and distance blocks from it with --machine-profile.
+
+   On every core, each thread gets its own working set of the given size,
+   so the largest sizes are only run as far as the buffer allows.
+   ======================================================================== */
+
+#include "bench_common.h"
+
+#include <thread>
+
+#include "bench_cache_kernels.h"
+#include "cpu_features.h"
+#include "machine_profile.h"
+
+enum sweep_kernel
+{
+    Kernel_Read,
+    Kernel_Write,
+    Kernel_Copy,
+
+    Kernel_Count,
+};
+
+static char const *KernelNames[Kernel_Count] = {"read", "write", "copy"};
+
+typedef uint64_t cache_kernel_func(char *Data, size_t WorkingSet, size_t ByteCount);
+
+static u64 const MIN_WORKING_SET = 4096;
+/* NOTE: Bytes moved per thread per run, at least - small working sets go round many times so the run is long enough
+   to time, and the thread start-up on every core doesn't show */
+static u64 const MIN_BYTES_PER_RUN = 64*1024*1024;
+static u32 const MAX_SWEEP_POINTS = 64;
+/* NOTE: A working set this much slower than the plateau it follows starts a new one */
+static f64 const PLATEAU_DROP = 0.75;
+
+struct sweep_point
+{
+    u64 WorkingSet;
+    f64 GBPerSecond;
+    char const *Level;
+};
+
+struct sweep_curve
+{
+    u32 ThreadCount;
+    sweep_kernel Kernel;
+    u32 PointCount;
+    sweep_point Points[MAX_SWEEP_POINTS];
+};
+
+static uint64_t volatile KernelSink;
+
+static void RunKernelOnThread(cache_kernel_func *Kernel, char *Data, u64 WorkingSet, u64 ByteCount)
+{
+    KernelSink = Kernel(Data, WorkingSet, ByteCount);
+}
+
+static f64 MeasureBandwidth(cache_kernel_func *Kernel, buffer Data, u64 WorkingSet, u32 ThreadCount, u32 SecondsToTry)
+{
+    u64 ByteCount = (WorkingSet > MIN_BYTES_PER_RUN) ? WorkingSet : MIN_BYTES_PER_RUN;
+    u64 SliceSize = Data.Count / ThreadCount;
+
+    repetition_tester Tester = {};
+    Tester.Settings.Quiet = true;
+    NewTestWave(&Tester, ByteCount*ThreadCount, GetCPUTimerFreq(), SecondsToTry);
+    while(IsTesting(&Tester))
+    {
+        BeginTime(&Tester);
+        std::thread Workers[256];
+        for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+        {
+            Workers[ThreadIndex] = std::thread(RunKernelOnThread, Kernel, (char *)Data.Data + ThreadIndex*SliceSize,
+                                               WorkingSet, ByteCount);
+        }
+        RunKernelOnThread(Kernel, (char *)Data.Data, WorkingSet, ByteCount);
+        for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+        {
+            Workers[ThreadIndex].join();
+        }
+        EndTime(&Tester);
+
+        CountBytes(&Tester, ByteCount*ThreadCount);
+    }
+
+    repetition_value Min = Tester.Results.Min;
+    f64 Seconds = SecondsFromCPUTime((f64)Min.E[RepValue_CPUTimer], GetCPUTimerFreq());
+    f64 Gigabyte = (1024.0f * 1024.0f * 1024.0f);
+    return (Seconds > 0) ? ((f64)Min.E[RepValue_ByteCount] / (Gigabyte * Seconds)) : 0;
+}
+
+/* NOTE: A working set joins the current plateau unless it is PLATEAU_DROP slower than the plateau's first point.
+   A single point between two plateaus is the transition from one level to the next, not a level of its own - unless
+   it is the last one. Plateaus are L1, L2, L3 (L4) in order, and the last is DRAM when the sweep went past every
+   cache it could plausibly have run into. */
+static void LabelPlateaus(sweep_curve *Curve, b32 LastIsDRAM)
+{
+    static char const *CacheLabels[] = {"L1", "L2", "L3", "L4"};
+
+    u32 Starts[MAX_SWEEP_POINTS + 1];
+    u32 PlateauCount = 0;
+    for(u32 PointIndex = 0; PointIndex < Curve->PointCount; ++PointIndex)
+    {
+        if((PointIndex == 0) ||
+           (Curve->Points[PointIndex].GBPerSecond < PLATEAU_DROP*Curve->Points[Starts[PlateauCount - 1]].GBPerSecond))
+        {
+            Starts[PlateauCount++] = PointIndex;
+        }
+    }
+    Starts[PlateauCount] = Curve->PointCount;
+
+    u32 LevelCount = 0;
+    for(u32 PlateauIndex = 0; PlateauIndex < PlateauCount; ++PlateauIndex)
+    {
+        u32 First = Starts[PlateauIndex];
+        u32 OnePast = Starts[PlateauIndex + 1];
+        b32 IsLast = (PlateauIndex == (PlateauCount - 1));
+
+        char const *Level = "-";
+        if(IsLast && LastIsDRAM)
+        {
+            Level = "DRAM";
+        }
+        else if(((OnePast - First) > 1) || IsLast)
+        {
+            Level = (LevelCount < ArrayCount(CacheLabels)) ? CacheLabels[LevelCount] : "-";
+            ++LevelCount;
+        }
+
+        for(u32 PointIndex = First; PointIndex < OnePast; ++PointIndex)
+        {
+            Curve->Points[PointIndex].Level = Level;
+        }
+    }
+}
+
+/* NOTE: A level's size is the largest working set on its plateau, its bandwidth the best one */
+static void FindLevel(sweep_curve *Curve, char const *Level, size_t *Bytes, f64 *GBPerSecond)
+{
+    for(u32 PointIndex = 0; PointIndex < Curve->PointCount; ++PointIndex)
+    {
+        sweep_point *Point = &Curve->Points[PointIndex];
+        if(strcmp(Point->Level, Level) == 0)
+        {
+            if(Bytes)
+            {
+                *Bytes = Point->WorkingSet;
+            }
+            if(Point->GBPerSecond > *GBPerSecond)
+            {
+                *GBPerSecond = Point->GBPerSecond;
+            }
+        }
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+
+    u32 SecondsToTry = 1;
+    u64 MaxWorkingSet = 1024*1024*1024;
+    u32 ThreadCount = std::thread::hardware_concurrency();
+    char const *CSVPath = "cache_sweep.csv";
+    char const *ProfilePath = 0;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char const *Arg = Args[ArgIndex];
+        if(strncmp(Arg, "--seconds=", 10) == 0)
+        {
+            SecondsToTry = (u32)atoi(Arg + 10);
+        }
+        else if(strncmp(Arg, "--max-mb=", 9) == 0)
+        {
+            MaxWorkingSet = strtoull(Arg + 9, 0, 10)*1024*1024;
+        }
+        else if(strncmp(Arg, "--threads=", 10) == 0)
+        {
+            ThreadCount = (u32)atoi(Arg + 10);
+        }
+        else if(strncmp(Arg, "--csv=", 6) == 0)
+        {
+            CSVPath = Arg + 6;
+        }
+        else if(strncmp(Arg, "--profile=", 10) == 0)
+        {
+            ProfilePath = Arg + 10;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--max-mb=<largest working set>] [--threads=<all-core thread count>]"
+                    " [--seconds=<no new minimum for>] [--csv=<file>] [--profile=<file>]\n", Args[0]);
+            return 1;
+        }
+    }
+    SecondsToTry = SecondsToTry ? SecondsToTry : 1;
+    ThreadCount = (ThreadCount < 1) ? 1 : ((ThreadCount > 256) ? 256 : ThreadCount);
+    if(MaxWorkingSet < MIN_WORKING_SET)
+    {
+        MaxWorkingSet = MIN_WORKING_SET;
+    }
+
+    // NOTE: Working sets are powers of two, the kernels wrap their offsets with a mask
+    u64 WorkingSet = MIN_WORKING_SET;
+    while((WorkingSet*2) <= MaxWorkingSet)
+    {
+        WorkingSet *= 2;
+    }
+    MaxWorkingSet = WorkingSet;
+
+    b32 HaveAVX2 = getCpuFeatures().avx2;
+    cache_kernel_func *Kernels[Kernel_Count] =
+    {
+        HaveAVX2 ? cacheReadAvx2 : cacheReadSse2,
+        HaveAVX2 ? cacheWriteAvx2 : cacheWriteSse2,
+        HaveAVX2 ? cacheCopyAvx2 : cacheCopySse2,
+    };
+
+    buffer Data = AllocateBuffer(MaxWorkingSet);
+    if(!Data.Count)
+    {
+        return 1;
+    }
+    memset(Data.Data, 1, Data.Count); // NOTE: Faulted in up front, so no measurement pays for page faults
+
+    FILE *CSV = fopen(CSVPath, "w");
+    if(!CSV)
+    {
+        fprintf(stderr, "ERROR: Unable to create %s\n", CSVPath);
+        return 1;
+    }
+    fprintf(CSV, "threads,kernel,working_set_bytes,gb_per_s,level\n");
+
+    printf("Sweeping %s loads, 4kb to %llumb, 1 and %u threads\n", HaveAVX2 ? "AVX2" : "SSE2",
+           (unsigned long long)(MaxWorkingSet / (1024*1024)), ThreadCount);
+
+    // NOTE: No cache in production is anywhere near 512mb, a sweep that far ends in DRAM
+    b32 LastIsDRAM = (MaxWorkingSet >= 512*1024*1024);
+    static sweep_curve Curves[2][Kernel_Count];
+    u32 PassCount = (ThreadCount > 1) ? 2 : 1;
+    for(u32 PassIndex = 0; PassIndex < PassCount; ++PassIndex)
+    {
+        u32 Threads = PassIndex ? ThreadCount : 1;
+        for(u32 KernelIndex = 0; KernelIndex < Kernel_Count; ++KernelIndex)
+        {
+            sweep_curve *Curve = &Curves[PassIndex][KernelIndex];
+            Curve->ThreadCount = Threads;
+            Curve->Kernel = (sweep_kernel)KernelIndex;
+            for(WorkingSet = MIN_WORKING_SET; (WorkingSet*Threads) <= MaxWorkingSet; WorkingSet *= 2)
+            {
+                sweep_point *Point = &Curve->Points[Curve->PointCount++];
+                Point->WorkingSet = WorkingSet;
+                Point->GBPerSecond = MeasureBandwidth(Kernels[KernelIndex], Data, WorkingSet, Threads, SecondsToTry);
+                printf("%u thread%s %-5s %10llukb: %8.2fgb/s\n", Threads, (Threads == 1) ? " " : "s",
+                       KernelNames[KernelIndex], (unsigned long long)(WorkingSet / 1024), Point->GBPerSecond);
+            }
+
+            // NOTE: Every core at once only reaches DRAM when their working sets together do
+            LabelPlateaus(Curve, LastIsDRAM);
+            for(u32 PointIndex = 0; PointIndex < Curve->PointCount; ++PointIndex)
+            {
+                sweep_point *Point = &Curve->Points[PointIndex];
+                fprintf(CSV, "%u,%s,%llu,%.3f,%s\n", Threads, KernelNames[KernelIndex],
+                        (unsigned long long)Point->WorkingSet, Point->GBPerSecond, Point->Level);
+            }
+        }
+    }
+    fclose(CSV);
+
+    MachineProfile Profile;
+    Profile.threadCount = ThreadCount;
+    sweep_curve *ReadCurve = &Curves[0][Kernel_Read];
+    FindLevel(ReadCurve, "L1", &Profile.l1Bytes, &Profile.l1ReadGBps);
+    FindLevel(ReadCurve, "L2", &Profile.l2Bytes, &Profile.l2ReadGBps);
+    FindLevel(ReadCurve, "L3", &Profile.l3Bytes, &Profile.l3ReadGBps);
+    FindLevel(ReadCurve, "DRAM", 0, &Profile.dramReadGBps);
+    FindLevel(&Curves[PassCount - 1][Kernel_Read], "DRAM", 0, &Profile.dramReadGBpsAllCores);
+
+    printf("\nPlateaus (1 thread read): L1 %llukb %.1fgb/s, L2 %llukb %.1fgb/s, L3 %llukb %.1fgb/s, DRAM %.1fgb/s"
+           " (%.1fgb/s on %u threads)\n",
+           (unsigned long long)(Profile.l1Bytes / 1024), Profile.l1ReadGBps,
+           (unsigned long long)(Profile.l2Bytes / 1024), Profile.l2ReadGBps,
+           (unsigned long long)(Profile.l3Bytes / 1024), Profile.l3ReadGBps,
+           Profile.dramReadGBps, Profile.dramReadGBpsAllCores, ThreadCount);
+    printf("CSV written to %s\n", CSVPath);
+
+    if(ProfilePath)
+    {
+        if(!writeMachineProfile(ProfilePath, Profile))
+        {
+            fprintf(stderr, "ERROR: Unable to write %s\n", ProfilePath);
+            return 1;
+        }
+        printf("Machine profile written to %s\n", ProfilePath);
+    }
+
+    FreeBuffer(&Data);
+    return 0;
+}
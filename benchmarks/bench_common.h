@@ -0,0 +1,37 @@
+/* ========================================================================
+   Shared preamble for the repetition tester benchmarks. Pulls in the
+   listing code the same way listing_0133_front_end_test_main.cpp does.
+
+   NOTE: Translation units that include this must not include profiler.h
+   (directly or through json_parser.h) - both define the OS/CPU timer
+   helpers. Production code is reached through the *_stages.h headers,
+   which are plain declarations implemented in their own .cpp files.
+   ======================================================================== */
+
+#ifndef PERFAWARE_PROFILING_BENCHMARKS_BENCH_COMMON_H_
+#define PERFAWARE_PROFILING_BENCHMARKS_BENCH_COMMON_H_
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "listing_0125_buffer.cpp"
+#include "listing_0126_os_platform.cpp"
+#include "listing_0109_pagefault_repetition_tester.cpp"
+
+#endif //PERFAWARE_PROFILING_BENCHMARKS_BENCH_COMMON_H_
@@ -0,0 +1,261 @@
+/* ========================================================================
+   Repetition tester benchmark for the JSON parser. Runs every stage over
+   the same file (e.g. the generator's coordinates.json) and reports the
+   throughput per stage, so parser changes can be compared in gb/s.
+   ======================================================================== */
+
+#include "bench_common.h"
+#include "listing_0136_repetition_tester_options.cpp"
+#include "bench_json_parser_stages.h"
+
+#include <sys/stat.h>
+
+/* NOTE: The buffer gets one extra zero byte past Count, so code that expects
+   a terminated string can run on it directly. */
+static buffer ReadEntireFile(char const *FileName)
+{
+    buffer Result = {};
+
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+
+        Result = AllocateBuffer(Stat.st_size + 1);
+        if(Result.Data)
+        {
+            Result.Count = Stat.st_size;
+            Result.Data[Result.Count] = 0;
+            if(fread(Result.Data, Result.Count, 1, File) != 1)
+            {
+                fprintf(stderr, "ERROR: Unable to read \"%s\".\n", FileName);
+                FreeBuffer(&Result);
+            }
+        }
+
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open \"%s\".\n", FileName);
+    }
+
+    return Result;
+}
+
+struct bench_parameters
+{
+    buffer Source;
+    u64 Sink; // NOTE: Stage results are accumulated here so the calls can't be discarded
+};
+
+typedef void bench_test_func(repetition_tester *Tester, bench_parameters *Params);
+typedef size_t json_stage_func(char const *Data, size_t Size);
+
+static void RunJSONStage(repetition_tester *Tester, bench_parameters *Params, json_stage_func *Stage)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Params->Sink += Stage((char const *)Params->Source.Data, Params->Source.Count);
+        EndTime(Tester);
+
+        CountBytes(Tester, Params->Source.Count);
+    }
+}
+
+static void LexJSON(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchLexJson);
+}
+
+static void IndexScalar(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchIndexScalar);
+}
+
+static void IndexSSE42(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchIndexSse42);
+}
+
+static void IndexAVX2(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchIndexAvx2);
+}
+
+static void LexJSONIndexed(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchLexJsonIndexed);
+}
+
+static void ParseJSONLegacy(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchParseJsonLegacy);
+}
+
+static void ParseJSON(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchParseJson);
+}
+
+static void ParseDocument(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchParseDocument);
+}
+
+static void ParsePairs(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchParsePairs);
+}
+
+static void NumbersStod(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchNumbersStod);
+}
+
+static void NumbersStrtod(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchNumbersStrtod);
+}
+
+static void NumbersParseDouble(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchNumbersParseDouble);
+}
+
+static void FormatIostream(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchFormatIostream);
+}
+
+static void FormatSnprintf(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchFormatSnprintf);
+}
+
+static void FormatFixed(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchFormatFixed);
+}
+
+static void FormatShortest(repetition_tester *Tester, bench_parameters *Params)
+{
+    RunJSONStage(Tester, Params, benchFormatShortest);
+}
+
+struct test_function
+{
+    char const *Name;
+    bench_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"LexJSON", LexJSON},
+    {"IndexScalar", IndexScalar},
+    {"IndexSSE42", IndexSSE42},
+    {"IndexAVX2", IndexAVX2},
+    {"LexJSONIndexed", LexJSONIndexed},
+    {"ParseJSONLegacy", ParseJSONLegacy},
+    {"ParseJSON", ParseJSON},
+    {"ParseDocument", ParseDocument},
+    {"ParsePairs", ParsePairs},
+    {"NumbersStod", NumbersStod},
+    {"NumbersStrtod", NumbersStrtod},
+    {"NumbersParseDouble", NumbersParseDouble},
+    {"FormatIostream", FormatIostream},
+    {"FormatSnprintf", FormatSnprintf},
+    {"FormatFixed", FormatFixed},
+    {"FormatShortest", FormatShortest},
+};
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+    
+    repetition_options Options = DefaultRepetitionOptions();
+    char const *FileName = 0;
+    b32 ArgsValid = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char const *Arg = Args[ArgIndex];
+        if(!ParseRepetitionOption(&Options, Arg))
+        {
+            if(!FileName && (Arg[0] != '-'))
+            {
+                FileName = Arg;
+            }
+            else
+            {
+                ArgsValid = false;
+            }
+        }
+    }
+    
+    u32 SelectedCount = 0;
+    for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+    {
+        SelectedCount += IsTestSelected(&Options, TestFunctions[FuncIndex].Name);
+    }
+    
+    if(FileName && ArgsValid && !Options.Invalid && SelectedCount)
+    {
+        // NOTE: --counters adds the hardware counters to every result, when this machine has them
+        if(Options.UseCounters)
+        {
+            InitializeOSPerfCounters();
+        }
+        
+        bench_parameters Params = {};
+        Params.Source = ReadEntireFile(FileName);
+        
+        if(Params.Source.Count > 0)
+        {
+            repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+            
+            for(u32 Round = 0; !Options.RoundCount || (Round < Options.RoundCount); ++Round)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    repetition_tester *Tester = &Testers[FuncIndex];
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    if(!IsTestSelected(&Options, TestFunc.Name))
+                    {
+                        continue;
+                    }
+                    
+                    printf("\n--- %s ---\n", TestFunc.Name);
+                    Tester->Name = TestFunc.Name;
+                    Tester->Settings = Options.Settings;
+                    NewTestWave(Tester, Params.Source.Count, GetCPUTimerFreq(), Options.SecondsToTry);
+                    TestFunc.Func(Tester, &Params);
+                }
+                
+                WriteRepetitionResults(&Options, Testers, ArrayCount(Testers));
+            }
+            
+            FreeBuffer(&Params.Source);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Test data size must be non-zero\n");
+        }
+    }
+    else if(FileName && ArgsValid && !Options.Invalid)
+    {
+        fprintf(stderr, "ERROR: No test named \"%s\"\n", Options.TestName);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [json file] [options]\n", Args[0]);
+        PrintRepetitionOptionsUsage();
+    }
+    
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "bench_json_parser_stages.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "json_document.h"
+#include "json_lexer.h"
+#include "json_number.h"
+#include "json_parser.h"
+#include "json_structural_index.h"
+
+// NOTE: Implemented in json_parser_legacy.cpp
+JSONNode parseLegacy(std::string_view json);
+
+static size_t summarize(JSONNode& root)
+{
+  if(root.type() == JSONType::OBJECT && root["pairs"].type() == JSONType::ARRAY)
+  {
+    return root["pairs"].getArray().size();
+  }
+  return (root.type() == JSONType::NULLT) ? 0u : 1u;
+}
+
+static size_t countTokens(JSONLexer& lexer)
+{
+  size_t tokenCount{0u};
+  while(lexer.next().type < JSONTokenType::END)
+  {
+    tokenCount++;
+  }
+  return tokenCount;
+}
+
+size_t benchLexJson(const char* data, size_t size)
+{
+  JSONLexer lexer(std::string_view(data, size));
+  return countTokens(lexer);
+}
+
+size_t benchLexJsonIndexed(const char* data, size_t size)
+{
+  JSONLexer lexer(std::string_view(data, size), bestStructuralKernel());
+  return countTokens(lexer);
+}
+
+static size_t indexWith(const char* data, size_t size, StructuralKernel kernel)
+{
+  JSONStructuralIndexer indexer(std::string_view(data, size), kernel);
+  size_t positions[STRUCTURAL_BATCH_SIZE];
+  size_t count{0u};
+  while(!indexer.done())
+  {
+    count += indexer.nextBatch(positions);
+  }
+  return count;
+}
+
+size_t benchIndexScalar(const char* data, size_t size)
+{
+  return indexWith(data, size, StructuralKernel::SCALAR);
+}
+
+size_t benchIndexSse42(const char* data, size_t size)
+{
+  return indexWith(data, size, StructuralKernel::SSE42);
+}
+
+size_t benchIndexAvx2(const char* data, size_t size)
+{
+  return indexWith(data, size, StructuralKernel::AVX2);
+}
+
+size_t benchParseJsonLegacy(const char* data, size_t size)
+{
+  JSONNode root = parseLegacy(std::string_view(data, size));
+  return summarize(root);
+}
+
+size_t benchParseJson(const char* data, size_t size)
+{
+  JSONNode root = JSONParser::parse(std::string_view(data, size));
+  return summarize(root);
+}
+
+size_t benchParseDocument(const char* data, size_t size)
+{
+  JSONDocument document = JSONDocument::parse(std::string_view(data, size));
+  auto root = document.root();
+  if(root.type() == JSONType::OBJECT && root["pairs"].type() == JSONType::ARRAY)
+  {
+    return root["pairs"].getArray().size();
+  }
+  return (root.type() == JSONType::NULLT) ? 0u : 1u;
+}
+
+size_t benchParsePairs(const char* data, size_t size)
+{
+  HaversinePairs pairs;
+  JSONParser::parsePairs(std::string_view(data, size), pairs);
+  return pairs.size();
+}
+
+template<typename Convert>
+static size_t sumNumbers(const char* data, size_t size, Convert convert)
+{
+  JSONLexer lexer(std::string_view(data, size));
+  double sum{0.0};
+  for(JSONToken token{lexer.next()}; token.type < JSONTokenType::END; token = lexer.next())
+  {
+    if(token.type == JSONTokenType::NUMBER)
+    {
+      sum += convert(data + token.offset, token.length);
+    }
+  }
+  return static_cast<size_t>(sum);
+}
+
+size_t benchNumbersStod(const char* data, size_t size)
+{
+  return sumNumbers(data, size, [](const char* text, size_t length) { return std::stod(std::string(text, length)); });
+}
+
+size_t benchNumbersStrtod(const char* data, size_t size)
+{
+  return sumNumbers(data, size, [](const char* text, size_t length)
+  {
+    char buffer[64];
+    length = (length < sizeof(buffer)) ? length : sizeof(buffer) - 1u;
+    std::memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return std::strtod(buffer, nullptr);
+  });
+}
+
+size_t benchNumbersParseDouble(const char* data, size_t size)
+{
+  return sumNumbers(data, size, [](const char* text, size_t length)
+  {
+    double value{0.0};
+    parseDouble(text, text + length, value);
+    return value;
+  });
+}
+
+static constexpr int FORMAT_PRECISION{16};
+static constexpr size_t FORMAT_BUFFER_SIZE{64u * 1024u};
+
+static const std::vector<double>& inputNumbers(const char* data, size_t size)
+{
+  static const char* numbersData{nullptr};
+  static std::vector<double> numbers;
+  if(numbersData != data)
+  {
+    numbers.clear();
+    sumNumbers(data, size, [](const char* text, size_t length)
+    {
+      double value{0.0};
+      parseDouble(text, text + length, value);
+      numbers.push_back(value);
+      return value;
+    });
+    numbersData = data;
+  }
+  return numbers;
+}
+
+// NOTE: The text goes into one cache sized buffer that starts over when full, so memory bandwidth doesn't hide the
+// formatting cost
+template<typename Format>
+static size_t formatNumbers(const char* data, size_t size, Format format)
+{
+  static char buffer[FORMAT_BUFFER_SIZE];
+  size_t textLength{0u};
+  char* at{buffer};
+  for(double value : inputNumbers(data, size))
+  {
+    if(at + MAX_FORMATTED_DOUBLE_LENGTH + 1u > buffer + FORMAT_BUFFER_SIZE)
+    {
+      textLength += static_cast<size_t>(at - buffer);
+      at = buffer;
+    }
+    at = format(value, at);
+    *at++ = ',';
+  }
+  return textLength + static_cast<size_t>(at - buffer);
+}
+
+size_t benchFormatIostream(const char* data, size_t size)
+{
+  std::ostringstream stream;
+  size_t textLength{0u};
+  for(double value : inputNumbers(data, size))
+  {
+    stream << std::fixed << std::setprecision(FORMAT_PRECISION) << value << ',';
+    if(static_cast<size_t>(stream.tellp()) > FORMAT_BUFFER_SIZE)
+    {
+      textLength += static_cast<size_t>(stream.tellp());
+      stream.seekp(0);
+    }
+  }
+  return textLength + static_cast<size_t>(stream.tellp());
+}
+
+size_t benchFormatSnprintf(const char* data, size_t size)
+{
+  return formatNumbers(data, size, [](double value, char* out)
+  {
+    return out + std::snprintf(out, MAX_FORMATTED_DOUBLE_LENGTH + 1u, "%.*f", FORMAT_PRECISION, value);
+  });
+}
+
+size_t benchFormatFixed(const char* data, size_t size)
+{
+  return formatNumbers(data, size, [](double value, char* out) { return formatFixed(value, FORMAT_PRECISION, out); });
+}
+
+size_t benchFormatShortest(const char* data, size_t size)
+{
+  return formatNumbers(data, size, [](double value, char* out) { return formatShortest(value, out); });
+}
@@ -0,0 +1,36 @@
+#ifndef PERFAWARE_PROFILING_BENCHMARKS_BENCH_JSON_PARSER_STAGES_H_
+#define PERFAWARE_PROFILING_BENCHMARKS_BENCH_JSON_PARSER_STAGES_H_
+
+#include <cstddef>
+
+// Entry points the repetition tester times. Each returns a value derived from its output so the work can't be
+// optimized away - the token count for the lexer, the element count of "pairs" (or 1 for any other document) for
+// the parsers. Parsed output is freed before returning, so the timings include teardown.
+size_t benchLexJson(const char* data, size_t size);
+size_t benchLexJsonIndexed(const char* data, size_t size);
+size_t benchParseJsonLegacy(const char* data, size_t size);
+size_t benchParseJson(const char* data, size_t size);
+size_t benchParseDocument(const char* data, size_t size);
+size_t benchParsePairs(const char* data, size_t size);
+
+// Index the whole input with one structural kernel and return the position count. A kernel the CPU lacks falls back
+// to the scalar one, so its timings are the scalar kernel's.
+size_t benchIndexScalar(const char* data, size_t size);
+size_t benchIndexSse42(const char* data, size_t size);
+size_t benchIndexAvx2(const char* data, size_t size);
+
+// Lex the whole input and convert every NUMBER token, only the conversion differs between these. Return the
+// integer part of the sum of all numbers.
+size_t benchNumbersStod(const char* data, size_t size);
+size_t benchNumbersStrtod(const char* data, size_t size);
+size_t benchNumbersParseDouble(const char* data, size_t size);
+
+// Format every number of the input as text the way the generator writes coordinates, 16 fixed decimals (or shortest
+// round trip text), into a reused buffer. The numbers are parsed once on the first call and kept, so only the
+// formatting is timed. Return the length of the text.
+size_t benchFormatIostream(const char* data, size_t size);
+size_t benchFormatSnprintf(const char* data, size_t size);
+size_t benchFormatFixed(const char* data, size_t size);
+size_t benchFormatShortest(const char* data, size_t size);
+
+#endif //PERFAWARE_PROFILING_BENCHMARKS_BENCH_JSON_PARSER_STAGES_H_
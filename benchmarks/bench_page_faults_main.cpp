@@ -0,0 +1,309 @@
+/* ========================================================================
+   Page fault and TLB cost explorer. For a sweep of buffer sizes, times
+   getting a buffer and writing one byte to each of its pages with every
+   allocation strategy and touch pattern, and prints one CSV row per
+   combination - the numbers behind how parse buffers get sized and reused.
+
+   Strategies:
+     fresh     mmap every run, pages faulted in by the touches
+     reused    one buffer for every run, faulted in before the first
+     populate  mmap with MAP_POPULATE every run, faulted in by mmap
+     thp       mmap every run, huge page aligned, madvise(MADV_HUGEPAGE)
+     hugetlb   mmap with MAP_HUGETLB every run (needs vm.nr_hugepages)
+
+   Patterns: forward and backward one page at a time, and strided - every
+   STRIDE_PAGES-th page, in STRIDE_PAGES passes.
+
+   The timing covers the mmap and the touches, not the munmap. Cycles are
+   CPU timer ticks, per 4k page of the buffer whatever the page size that
+   backs it. With --counters, dTLB misses per page are added.
+   ======================================================================== */
+
+#include "bench_common.h"
+
+#if _WIN32
+#error "The page fault explorer is written against mmap, it only builds on Linux"
+#endif
+
+enum page_strategy
+{
+    Strategy_Fresh,
+    Strategy_Reused,
+    Strategy_Populate,
+    Strategy_THP,
+    Strategy_HugeTLB,
+
+    Strategy_Count,
+};
+
+static char const *StrategyNames[Strategy_Count] = {"fresh", "reused", "populate", "thp", "hugetlb"};
+
+enum touch_pattern
+{
+    Pattern_Forward,
+    Pattern_Backward,
+    Pattern_Strided,
+
+    Pattern_Count,
+};
+
+static char const *PatternNames[Pattern_Count] = {"forward", "backward", "strided"};
+
+static u64 const PAGE_SIZE = 4096;
+static u64 const STRIDE_PAGES = 16;
+
+struct page_buffer
+{
+    u8 *Data;
+    size_t MappedSize; // NOTE: What munmap needs, rounded up to whole huge pages for thp and hugetlb
+};
+
+static page_buffer MapPages(page_strategy Strategy, size_t Size)
+{
+    page_buffer Result = {};
+    int Flags = MAP_PRIVATE|MAP_ANONYMOUS;
+    size_t MapSize = Size;
+    u64 LargePageSize = GetLargePageSize();
+
+    if(Strategy == Strategy_Populate)
+    {
+        Flags |= MAP_POPULATE;
+    }
+    else if((Strategy == Strategy_HugeTLB) || (Strategy == Strategy_THP))
+    {
+        if(!LargePageSize)
+        {
+            return Result;
+        }
+        MapSize = (Size + LargePageSize - 1) & ~(LargePageSize - 1);
+        if(Strategy == Strategy_HugeTLB)
+        {
+            Flags |= MAP_HUGETLB;
+        }
+    }
+
+    if(Strategy == Strategy_THP)
+    {
+        // NOTE: Only huge page aligned ranges get transparent huge pages, so map one more and trim both ends
+        void *Mapped = mmap(0, MapSize + LargePageSize, PROT_READ|PROT_WRITE, Flags, -1, 0);
+        if(Mapped != MAP_FAILED)
+        {
+            u8 *Aligned = (u8 *)(((uintptr_t)Mapped + LargePageSize - 1) & ~(uintptr_t)(LargePageSize - 1));
+            size_t Before = Aligned - (u8 *)Mapped;
+            if(Before)
+            {
+                munmap(Mapped, Before);
+            }
+            munmap(Aligned + MapSize, LargePageSize - Before);
+            madvise(Aligned, MapSize, MADV_HUGEPAGE);
+
+            Result.Data = Aligned;
+            Result.MappedSize = MapSize;
+        }
+    }
+    else
+    {
+        void *Mapped = mmap(0, MapSize, PROT_READ|PROT_WRITE, Flags, -1, 0);
+        if(Mapped != MAP_FAILED)
+        {
+            Result.Data = (u8 *)Mapped;
+            Result.MappedSize = MapSize;
+        }
+    }
+
+    return Result;
+}
+
+static void UnmapPages(page_buffer *Buffer)
+{
+    if(Buffer->Data)
+    {
+        munmap(Buffer->Data, Buffer->MappedSize);
+    }
+    *Buffer = {};
+}
+
+/* NOTE: Writes, not reads - a read fault of an untouched anonymous page only maps the shared zero page */
+static void TouchPages(u8 *Data, u64 PageCount, touch_pattern Pattern)
+{
+    switch(Pattern)
+    {
+        case Pattern_Forward:
+        {
+            for(u64 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+            {
+                Data[PageIndex*PAGE_SIZE] = (u8)PageIndex;
+            }
+        } break;
+
+        case Pattern_Backward:
+        {
+            for(u64 PageIndex = PageCount; PageIndex > 0; --PageIndex)
+            {
+                Data[(PageIndex - 1)*PAGE_SIZE] = (u8)PageIndex;
+            }
+        } break;
+
+        case Pattern_Strided:
+        {
+            for(u64 Start = 0; Start < STRIDE_PAGES; ++Start)
+            {
+                for(u64 PageIndex = Start; PageIndex < PageCount; PageIndex += STRIDE_PAGES)
+                {
+                    Data[PageIndex*PAGE_SIZE] = (u8)PageIndex;
+                }
+            }
+        } break;
+
+        default: break;
+    }
+}
+
+struct page_result
+{
+    b32 Available;
+    u64 RunCount;
+    u64 MinCycles;
+    u64 TotalFaults;
+    u64 TotalDTLBMisses;
+};
+
+/* NOTE: Runs until MinRunCount runs and MinSeconds have passed, or MaxRunCount runs. The best run's cycles are kept,
+   faults and dTLB misses are averaged - they barely vary, and the average shows when they do. */
+static page_result MeasurePages(page_strategy Strategy, touch_pattern Pattern, size_t Size)
+{
+    u64 const MinRunCount = 3;
+    u64 const MaxRunCount = 200;
+    f64 const MinSeconds = 0.1;
+
+    page_result Result = {};
+    Result.MinCycles = (u64)-1;
+    u64 PageCount = Size / PAGE_SIZE;
+    u64 TimerFreq = GetCPUTimerFreq();
+
+    page_buffer Reused = {};
+    if(Strategy == Strategy_Reused)
+    {
+        Reused = MapPages(Strategy_Fresh, Size);
+        if(!Reused.Data)
+        {
+            return Result;
+        }
+        TouchPages(Reused.Data, PageCount, Pattern_Forward);
+    }
+
+    u64 StartedAt = ReadCPUTimer();
+    while((Result.RunCount < MinRunCount) ||
+          ((Result.RunCount < MaxRunCount) && ((f64)(ReadCPUTimer() - StartedAt) < MinSeconds*(f64)TimerFreq)))
+    {
+        u64 Counters[PerfCounter_Count] = {};
+        ReadOSPerfCounters(Counters);
+        u64 DTLBMissesBefore = Counters[PerfCounter_DTLBMisses];
+        u64 FaultsBefore = ReadOSPageFaultCount();
+        u64 CyclesBefore = ReadCPUTimer();
+
+        page_buffer Buffer = Reused;
+        if(Strategy != Strategy_Reused)
+        {
+            Buffer = MapPages(Strategy, Size);
+        }
+        if(Buffer.Data)
+        {
+            TouchPages(Buffer.Data, PageCount, Pattern);
+        }
+
+        u64 Cycles = ReadCPUTimer() - CyclesBefore;
+        u64 Faults = ReadOSPageFaultCount() - FaultsBefore;
+        ReadOSPerfCounters(Counters);
+        u64 DTLBMisses = Counters[PerfCounter_DTLBMisses] - DTLBMissesBefore;
+
+        if(!Buffer.Data)
+        {
+            break;
+        }
+        if(Strategy != Strategy_Reused)
+        {
+            UnmapPages(&Buffer);
+        }
+
+        Result.Available = true;
+        ++Result.RunCount;
+        Result.TotalFaults += Faults;
+        Result.TotalDTLBMisses += DTLBMisses;
+        if(Cycles < Result.MinCycles)
+        {
+            Result.MinCycles = Cycles;
+        }
+    }
+
+    UnmapPages(&Reused);
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+
+    // NOTE: Sizes go up by 4x from MinSize until they pass the largest one asked for (default 256mb)
+    u64 MinSize = 16*1024;
+    u64 MaxSize = 256*1024*1024;
+    b32 UseCounters = false;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if(strcmp(Args[ArgIndex], "--counters") == 0)
+        {
+            UseCounters = true;
+        }
+        else if(strncmp(Args[ArgIndex], "--max-mb=", 9) == 0)
+        {
+            MaxSize = strtoull(Args[ArgIndex] + 9, 0, 10)*1024*1024;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--max-mb=<megabytes>] [--counters]\n", Args[0]);
+            return 1;
+        }
+    }
+    if(UseCounters)
+    {
+        UseCounters = InitializeOSPerfCounters();
+    }
+
+    printf("size_bytes,strategy,pattern,runs,min_cycles,cycles_per_page,faults_per_run");
+    printf(UseCounters ? ",dtlb_misses_per_page\n" : "\n");
+    for(u64 Size = MinSize; Size <= MaxSize; Size *= 4)
+    {
+        for(u32 Strategy = 0; Strategy < Strategy_Count; ++Strategy)
+        {
+            for(u32 Pattern = 0; Pattern < Pattern_Count; ++Pattern)
+            {
+                page_result Result = MeasurePages((page_strategy)Strategy, (touch_pattern)Pattern, Size);
+                printf("%llu,%s,%s,", (unsigned long long)Size, StrategyNames[Strategy], PatternNames[Pattern]);
+                if(Result.Available)
+                {
+                    f64 PageCount = (f64)(Size / PAGE_SIZE);
+                    printf("%llu,%llu,%.2f,%.2f", (unsigned long long)Result.RunCount,
+                           (unsigned long long)Result.MinCycles, (f64)Result.MinCycles / PageCount,
+                           (f64)Result.TotalFaults / (f64)Result.RunCount);
+                    if(UseCounters)
+                    {
+                        printf(",%.4f", (f64)Result.TotalDTLBMisses / ((f64)Result.RunCount*PageCount));
+                    }
+                }
+                else
+                {
+                    // NOTE: The strategy's allocation failed - no huge pages reserved, THP disabled, out of memory
+                    printf("0,,,");
+                    if(UseCounters)
+                    {
+                        printf(",");
+                    }
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/* ========================================================================
+   Repetition tester benchmark for the haversine pipeline. Generates the
+   input in process with the generator's counter-based logic - the same
+   bytes haversine_generator --threads writes for that method, seed and
+   pair count - and times every stage of haversine_cli_app on it:
+   reading the JSON and the answers, parsing, and the distance kernels.
+
+   Every round ends with the best (fastest run) and median gb/s of each
+   stage, the baseline an optimization gets compared against. The input
+   files go to --dir (default the current directory) and are deleted at
+   the end.
+   ======================================================================== */
+
+#include "bench_common.h"
+#include "listing_0136_repetition_tester_options.cpp"
+#include "haversine_bench_stages.h"
+
+typedef size_t haversine_stage_func(void);
+
+/* NOTE: ByteCount picks what a stage's gb/s are of - the file it reads, the JSON text it parses, or the four
+   doubles per pair the kernels read */
+struct test_function
+{
+    char const *Name;
+    haversine_stage_func *Stage;
+    size_t HaversineBenchInput::*ByteCount;
+};
+test_function TestFunctions[] =
+{
+    {"readJsonFile", benchReadJsonFile, &HaversineBenchInput::jsonBytes},
+    {"readBinFile", benchReadBinFile, &HaversineBenchInput::answerBytes},
+    {"JSONParser::parse", benchParse, &HaversineBenchInput::jsonBytes},
+    {"JSONParser::parsePairs", benchParsePairs, &HaversineBenchInput::jsonBytes},
+    {"ReferenceHaversine", benchReferenceHaversine, &HaversineBenchInput::pairBytes},
+    {"fastHaversine", benchFastHaversine, &HaversineBenchInput::pairBytes},
+};
+
+static u64 volatile StageSink; // NOTE: Stage results go here so the calls can't be discarded
+
+static void RunStage(repetition_tester *Tester, haversine_stage_func *Stage, u64 ByteCount)
+{
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        StageSink = Stage();
+        EndTime(Tester);
+
+        CountBytes(Tester, ByteCount);
+    }
+}
+
+static void PrintSummary(repetition_tester *Testers, u32 TesterCount)
+{
+    printf("\n%-24s %14s %8s %12s %12s %10s\n", "stage", "bytes", "runs", "best gb/s", "median gb/s", "sd %");
+    for(u32 TesterIndex = 0; TesterIndex < TesterCount; ++TesterIndex)
+    {
+        repetition_tester *Tester = &Testers[TesterIndex];
+        if(Tester->Samples.Count)
+        {
+            repetition_summary Summary = SummarizeTester(Tester);
+            printf("%-24s %14llu %8llu %12.3f %12.3f %10.2f\n", Tester->Name,
+                   (unsigned long long)Tester->TargetProcessedByteCount, (unsigned long long)Summary.RunCount,
+                   Summary.MinGBps, Summary.MedianGBps, 100.0*Summary.StdDev/Summary.Mean);
+        }
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+
+    // NOTE: One round unless --rounds says otherwise - a baseline run has to end on its own
+    repetition_options Options = DefaultRepetitionOptions();
+    Options.RoundCount = 1;
+    u64 PairCount = 1000000;
+    u64 Seed = 12345;
+    b32 Cluster = false;
+    char const *Directory = ".";
+    b32 ArgsValid = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char const *Arg = Args[ArgIndex];
+        if(ParseRepetitionOption(&Options, Arg))
+        {
+            continue;
+        }
+
+        char *End = 0;
+        if(strncmp(Arg, "--pairs=", 8) == 0)
+        {
+            PairCount = strtoull(Arg + 8, &End, 10);
+            ArgsValid &= (End != Arg + 8) && (*End == 0) && (PairCount > 0);
+        }
+        else if(strncmp(Arg, "--seed=", 7) == 0)
+        {
+            Seed = strtoull(Arg + 7, &End, 10);
+            ArgsValid &= (End != Arg + 7) && (*End == 0);
+        }
+        else if(strcmp(Arg, "--cluster") == 0)
+        {
+            Cluster = true;
+        }
+        else if(strncmp(Arg, "--dir=", 6) == 0)
+        {
+            Directory = Arg + 6;
+            ArgsValid &= (Directory[0] != 0);
+        }
+        else
+        {
+            ArgsValid = false;
+        }
+    }
+
+    u32 SelectedCount = 0;
+    for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+    {
+        SelectedCount += IsTestSelected(&Options, TestFunctions[FuncIndex].Name);
+    }
+
+    if(!ArgsValid || Options.Invalid)
+    {
+        fprintf(stderr, "Usage: %s [--pairs=<count>] [--seed=<n>] [--cluster] [--dir=<path>] [options]\n", Args[0]);
+        fprintf(stderr, "  --pairs=<count>     pairs to generate (default 1000000)\n");
+        fprintf(stderr, "  --seed=<n>          generator seed (default 12345)\n");
+        fprintf(stderr, "  --cluster           clustered pairs instead of uniform ones\n");
+        fprintf(stderr, "  --dir=<path>        where the input files are written for the read stages (default .)\n");
+        PrintRepetitionOptionsUsage();
+        return 1;
+    }
+    if(!SelectedCount)
+    {
+        fprintf(stderr, "ERROR: No test named \"%s\"\n", Options.TestName);
+        return 1;
+    }
+
+    // NOTE: --counters adds the hardware counters to every result, when this machine has them
+    if(Options.UseCounters)
+    {
+        InitializeOSPerfCounters();
+    }
+
+    char JsonPath[4096];
+    char AnswersPath[4096];
+    snprintf(JsonPath, sizeof(JsonPath), "%s/haversine_bench.json", Directory);
+    snprintf(AnswersPath, sizeof(AnswersPath), "%s/haversine_bench.f64", Directory);
+
+    HaversineBenchInput Input = {};
+    printf("Generating %llu %s pairs, seed %llu...\n", (unsigned long long)PairCount, Cluster ? "cluster" : "uniform",
+           (unsigned long long)Seed);
+    if(!prepareHaversineBench(PairCount, Seed, Cluster, JsonPath, AnswersPath, Input))
+    {
+        fprintf(stderr, "ERROR: Unable to write or parse back the input in \"%s\"\n", Directory);
+        releaseHaversineBench();
+        return 1;
+    }
+    printf("JSON: %.3fmb, answers: %.3fmb, pairs: %.3fmb\n", (f64)Input.jsonBytes / (1024.0*1024.0),
+           (f64)Input.answerBytes / (1024.0*1024.0), (f64)Input.pairBytes / (1024.0*1024.0));
+
+    repetition_tester Testers[ArrayCount(TestFunctions)] = {};
+    for(u32 Round = 0; !Options.RoundCount || (Round < Options.RoundCount); ++Round)
+    {
+        for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+        {
+            repetition_tester *Tester = &Testers[FuncIndex];
+            test_function TestFunc = TestFunctions[FuncIndex];
+            if(!IsTestSelected(&Options, TestFunc.Name))
+            {
+                continue;
+            }
+
+            u64 ByteCount = Input.*TestFunc.ByteCount;
+            printf("\n--- %s ---\n", TestFunc.Name);
+            Tester->Name = TestFunc.Name;
+            Tester->Settings = Options.Settings;
+            NewTestWave(Tester, ByteCount, GetCPUTimerFreq(), Options.SecondsToTry);
+            RunStage(Tester, TestFunc.Stage, ByteCount);
+        }
+
+        PrintSummary(Testers, ArrayCount(Testers));
+        WriteRepetitionResults(&Options, Testers, ArrayCount(Testers));
+    }
+
+    releaseHaversineBench();
+    return 0;
+}
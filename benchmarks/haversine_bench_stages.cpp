@@ -0,0 +1,150 @@
+#include "haversine_bench_stages.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coordinate_generation.h"
+#include "fast_haversine.h"
+#include "haversine_formula.cpp"
+#include "input_files.h"
+#include "json_parser.h"
+
+namespace
+{
+constexpr double EARTH_RADIUS{6372.8};
+// Distances per fastHaversine call, the block size haversine_cli_app uses without a machine profile
+constexpr size_t DISTANCE_BLOCK_SIZE{1024u};
+
+struct BenchState
+{
+  std::string jsonPath;
+  std::string answersPath;
+  std::string json;
+  std::vector<double> answers;
+  HaversinePairs pairs;
+};
+
+BenchState state;
+
+bool writeFile(const std::string& path, const void* data, size_t size)
+{
+  FILE* file{fopen(path.c_str(), "wb")};
+  if(!file)
+  {
+    return false;
+  }
+  const bool written{fwrite(data, 1u, size, file) == size};
+  return (fclose(file) == 0) && written;
+}
+
+size_t summarize(JSONNode& root)
+{
+  if(root.type() == JSONType::OBJECT && root["pairs"].type() == JSONType::ARRAY)
+  {
+    return root["pairs"].getArray().size();
+  }
+  return 0u;
+}
+} // namespace
+
+bool prepareHaversineBench(size_t pairCount, uint64_t seed, bool cluster, const char* jsonPath,
+                           const char* answersPath, HaversineBenchInput& input)
+{
+  state.jsonPath = jsonPath;
+  state.answersPath = answersPath;
+  state.json.assign(JSON_HEADER);
+  state.answers.resize(pairCount);
+
+  // NOTE: Same pairs, text and answers as the generator's generateBlocks, one block covering every pair
+  const CounterStreams streams(seed);
+  const size_t pointsPerCluster{std::max<size_t>(pairCount / CLUSTER_NUMBER, 1u)};
+  char record[MAX_RECORD_LENGTH];
+  for(size_t pairIndex{0u}; pairIndex < pairCount; pairIndex++)
+  {
+    auto [X0, Y0, X1, Y1] = generateCounterCoordinate(streams, cluster, pointsPerCluster, pairIndex);
+    state.answers[pairIndex] = ReferenceHaversine(X0, Y0, X1, Y1, EARTH_RADIUS);
+    char* end{formatPairRecord(record, X0, Y0, X1, Y1, pairIndex == pairCount - 1u, false)};
+    state.json.append(record, static_cast<size_t>(end - record));
+  }
+  state.json.append(JSON_TRAILER);
+
+  if(!writeFile(state.jsonPath, state.json.data(), state.json.size()) ||
+     !writeFile(state.answersPath, state.answers.data(), state.answers.size() * sizeof(double)))
+  {
+    return false;
+  }
+
+  if(!JSONParser::parsePairs(state.json, state.pairs) || state.pairs.size() != pairCount)
+  {
+    return false;
+  }
+
+  input.pairCount = pairCount;
+  input.jsonBytes = state.json.size();
+  input.answerBytes = state.answers.size() * sizeof(double);
+  input.pairBytes = state.pairs.byteCount();
+  return true;
+}
+
+void releaseHaversineBench()
+{
+  std::remove(state.jsonPath.c_str());
+  std::remove(state.answersPath.c_str());
+  state = BenchState{};
+}
+
+size_t benchReadJsonFile()
+{
+  return readJsonFile(state.jsonPath, DEFAULT_READ_BUFFER_SIZE).size();
+}
+
+size_t benchReadBinFile()
+{
+  return readBinFile(state.answersPath).size();
+}
+
+size_t benchParse()
+{
+  JSONNode root = JSONParser::parse(state.json);
+  return summarize(root);
+}
+
+size_t benchParsePairs()
+{
+  HaversinePairs pairs;
+  JSONParser::parsePairs(state.json, pairs);
+  return pairs.size();
+}
+
+size_t benchReferenceHaversine()
+{
+  const HaversinePairs& pairs{state.pairs};
+  double sum{0.0};
+  for(size_t pairIndex{0u}; pairIndex < pairs.size(); pairIndex++)
+  {
+    sum += ReferenceHaversine(pairs.x0[pairIndex], pairs.y0[pairIndex], pairs.x1[pairIndex], pairs.y1[pairIndex],
+                              EARTH_RADIUS);
+  }
+  return static_cast<size_t>(sum);
+}
+
+size_t benchFastHaversine()
+{
+  const HaversinePairs& pairs{state.pairs};
+  double distances[DISTANCE_BLOCK_SIZE];
+  double sum{0.0};
+  for(size_t first{0u}; first < pairs.size(); first += DISTANCE_BLOCK_SIZE)
+  {
+    const size_t count{std::min(DISTANCE_BLOCK_SIZE, pairs.size() - first)};
+    fastHaversine(pairs.x0.data() + first, pairs.y0.data() + first, pairs.x1.data() + first,
+                  pairs.y1.data() + first, count, EARTH_RADIUS, distances);
+    for(size_t index{0u}; index < count; index++)
+    {
+      sum += distances[index];
+    }
+  }
+  return static_cast<size_t>(sum);
+}
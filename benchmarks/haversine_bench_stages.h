@@ -0,0 +1,33 @@
+#ifndef PERFAWARE_PROFILING_BENCHMARKS_HAVERSINE_BENCH_STAGES_H_
+#define PERFAWARE_PROFILING_BENCHMARKS_HAVERSINE_BENCH_STAGES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+struct HaversineBenchInput
+{
+  size_t pairCount;
+  size_t jsonBytes;
+  size_t answerBytes;
+  size_t pairBytes; // the parsed pairs the haversine stages read, four doubles per pair
+};
+
+// Builds the input every stage runs on: the pairs haversine_generator --threads=<n> writes for the same method, seed
+// and count, as JSON text and answers in memory, parsed once into pairs. Also writes both to jsonPath and
+// answersPath for the file reading stages. Returns false when a file can't be written or the JSON doesn't parse
+// back to pairCount pairs.
+bool prepareHaversineBench(size_t pairCount, uint64_t seed, bool cluster, const char* jsonPath,
+                           const char* answersPath, HaversineBenchInput& input);
+// Deletes the files prepareHaversineBench wrote and frees the input
+void releaseHaversineBench();
+
+// Pipeline stages the repetition tester times. Each returns a value derived from its output so the work can't be
+// optimized away, and frees what it produced before returning.
+size_t benchReadJsonFile();       // readJsonFile of the JSON file, returns its size
+size_t benchReadBinFile();        // readBinFile of the answers file, returns the answer count
+size_t benchParse();              // JSONParser::parse of the JSON text, returns the "pairs" element count
+size_t benchParsePairs();         // JSONParser::parsePairs of the JSON text, returns the pair count
+size_t benchReferenceHaversine(); // ReferenceHaversine over the parsed pairs, returns the integer part of the sum
+size_t benchFastHaversine();      // fastHaversine, best kernel, over the parsed pairs, same return value
+
+#endif //PERFAWARE_PROFILING_BENCHMARKS_HAVERSINE_BENCH_STAGES_H_
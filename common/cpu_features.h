@@ -0,0 +1,66 @@
+#ifndef PERFAWARE_PROFILING_COMMON_CPU_FEATURES_H_
+#define PERFAWARE_PROFILING_COMMON_CPU_FEATURES_H_
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Instruction set extensions the runtime-dispatched kernels care about. Queried once through CPUID and cached. GCC
+// and Clang have builtins that also check that the OS saves the wider registers, MSVC checks XCR0 itself.
+struct CpuFeatures
+{
+  bool sse42;
+  bool avx2;
+  bool fma;
+  bool avx512f;
+};
+
+inline const CpuFeatures& getCpuFeatures()
+{
+  static const CpuFeatures features = []()
+  {
+    CpuFeatures detected{};
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    detected.sse42 = __builtin_cpu_supports("sse4.2");
+    detected.avx2 = __builtin_cpu_supports("avx2");
+    detected.fma = __builtin_cpu_supports("fma");
+    detected.avx512f = __builtin_cpu_supports("avx512f");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int registers[4]{}; // eax, ebx, ecx, edx
+    __cpuid(registers, 0);
+    const int maxLeaf{registers[0]};
+
+    __cpuid(registers, 1);
+    const bool sse42{(registers[2] & (1 << 20)) != 0};
+    const bool fma{(registers[2] & (1 << 12)) != 0};
+    const bool osxsave{(registers[2] & (1 << 27)) != 0};
+    const bool avx{(registers[2] & (1 << 28)) != 0};
+
+    bool avx2{false};
+    bool avx512f{false};
+    if(maxLeaf >= 7)
+    {
+      __cpuidex(registers, 7, 0);
+      avx2 = (registers[1] & (1 << 5)) != 0;
+      avx512f = (registers[1] & (1 << 16)) != 0;
+    }
+
+    // NOTE: The YMM and ZMM registers are only usable when the OS saves them on a context switch: XCR0 has to have
+    // the SSE and AVX state bits (1, 2) and for AVX-512 also the opmask and upper ZMM bits (5, 6, 7)
+    const unsigned long long xcr0{osxsave ? static_cast<unsigned long long>(_xgetbv(0)) : 0u};
+    const bool ymmSaved{(xcr0 & 0x06u) == 0x06u};
+    const bool zmmSaved{(xcr0 & 0xE6u) == 0xE6u};
+
+    detected.sse42 = sse42;
+    detected.avx2 = avx && avx2 && ymmSaved;
+    detected.fma = avx && fma && ymmSaved;
+    detected.avx512f = avx512f && zmmSaved;
+#endif
+    return detected;
+  }();
+
+  return features;
+}
+
+#endif //PERFAWARE_PROFILING_COMMON_CPU_FEATURES_H_
@@ -0,0 +1,114 @@
+#ifndef PERFAWARE_PROFILING_COMMON_HAVERSINE_PAIR_FILE_H_
+#define PERFAWARE_PROFILING_COMMON_HAVERSINE_PAIR_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary alternative to the generator's JSON pairs file (.hvb): a 64 byte header followed by the coordinates as raw
+// doubles, so a reader can map the file and use the numbers where they are, with nothing to parse.
+//
+//   AOS: x0 y0 x1 y1 of the first pair, then of the second, ...
+//   SOA: every x0, then every y0, every x1 and every y1 - the layout fastHaversine reads directly
+//
+// The doubles and the header fields are stored in the writer's byte order, only little-endian hosts are supported.
+constexpr char HAVERSINE_PAIR_FILE_MAGIC[8]{'H', 'V', 'B', 'P', 'A', 'I', 'R', 'S'};
+constexpr uint32_t HAVERSINE_PAIR_FILE_VERSION{1u};
+
+enum class PairDistribution : uint32_t
+{
+  UNIFORM,
+  CLUSTER
+};
+
+enum class PairLayout : uint32_t
+{
+  AOS,
+  SOA
+};
+
+struct HaversinePairFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize; // where the coordinates start, readers skip whatever later versions add before them
+  uint64_t pairCount;
+  uint64_t seed;
+  PairDistribution distribution;
+  PairLayout layout;
+  uint64_t checksum;   // haversinePairChecksum summed over every pair
+  uint64_t reserved[2];
+};
+static_assert(sizeof(HaversinePairFileHeader) == 64u, "The coordinates have to stay 64 byte aligned");
+
+// Checksum of one pair, position included. The file's checksum is the wrapping sum over all pairs, so it is the same
+// for both layouts and blocks of pairs can be summed in any order.
+inline uint64_t haversinePairChecksum(uint64_t pairIndex, double x0, double y0, double x1, double y1)
+{
+  auto mix = [](uint64_t value) {
+    value = (value ^ (value >> 30u)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27u)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31u);
+  };
+  auto bits = [](double value) {
+    uint64_t valueBits;
+    std::memcpy(&valueBits, &value, sizeof(valueBits));
+    return valueBits;
+  };
+
+  uint64_t checksum{mix(pairIndex * 0x9E3779B97F4A7C15ULL ^ bits(x0))};
+  checksum = mix(checksum ^ bits(y0));
+  checksum = mix(checksum ^ bits(x1));
+  return mix(checksum ^ bits(y1));
+}
+
+inline HaversinePairFileHeader makeHaversinePairFileHeader(uint64_t pairCount, uint64_t seed,
+                                                           PairDistribution distribution, PairLayout layout,
+                                                           uint64_t checksum)
+{
+  HaversinePairFileHeader header{};
+  std::memcpy(header.magic, HAVERSINE_PAIR_FILE_MAGIC, sizeof(header.magic));
+  header.version = HAVERSINE_PAIR_FILE_VERSION;
+  header.headerSize = sizeof(HaversinePairFileHeader);
+  header.pairCount = pairCount;
+  header.seed = seed;
+  header.distribution = distribution;
+  header.layout = layout;
+  header.checksum = checksum;
+  return header;
+}
+
+// True when the data starts with the pair file magic, whatever else is wrong with it
+inline bool isHaversinePairFile(const char* data, size_t size)
+{
+  return size >= sizeof(HAVERSINE_PAIR_FILE_MAGIC) &&
+         std::memcmp(data, HAVERSINE_PAIR_FILE_MAGIC, sizeof(HAVERSINE_PAIR_FILE_MAGIC)) == 0;
+}
+
+// Reads the header of a pair file of size bytes. Returns nullptr when the header is usable and the coordinates it
+// announces are all there, or what is wrong. The checksum is left to the caller, it needs a pass over the data.
+inline const char* readHaversinePairFileHeader(const char* data, size_t size, HaversinePairFileHeader& header)
+{
+  if(size < sizeof(header) || !isHaversinePairFile(data, size))
+  {
+    return "not a pair file";
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if(header.version > HAVERSINE_PAIR_FILE_VERSION || header.headerSize < sizeof(header) ||
+     header.headerSize % alignof(double) != 0u)
+  {
+    return "unsupported version";
+  }
+  if(header.layout != PairLayout::AOS && header.layout != PairLayout::SOA)
+  {
+    return "unknown layout";
+  }
+  if(header.headerSize > size || header.pairCount != (size - header.headerSize) / (4u * sizeof(double)) ||
+     (size - header.headerSize) % (4u * sizeof(double)) != 0u)
+  {
+    return "size does not match the pair count";
+  }
+  return nullptr;
+}
+
+#endif //PERFAWARE_PROFILING_COMMON_HAVERSINE_PAIR_FILE_H_
@@ -0,0 +1,166 @@
+#ifndef PERFAWARE_PROFILING_COMMON_INTEGER_INTRINSICS_H_
+#define PERFAWARE_PROFILING_COMMON_INTEGER_INTRINSICS_H_
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Wide arithmetic and bit scan helpers for the number conversions and the structural index. GCC and Clang have
+// unsigned __int128 and the __builtin_ bit functions, MSVC has neither but its intrinsics do the same; anything else
+// gets plain C++.
+struct UInt128
+{
+  uint64_t high;
+  uint64_t low;
+};
+
+// The full 128 bit product of two 64 bit integers
+inline UInt128 multiply64x64(uint64_t a, uint64_t b)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  UInt128 product;
+  product.low = _umul128(a, b, &product.high);
+  return product;
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+  return {__umulh(a, b), a * b};
+#elif defined(__SIZEOF_INT128__)
+  const unsigned __int128 product{static_cast<unsigned __int128>(a) * b};
+  return {static_cast<uint64_t>(product >> 64), static_cast<uint64_t>(product)};
+#else
+  // NOTE: Four 32x32 bit partial products, the middle ones summed with their carries
+  const uint64_t aLow{a & 0xFFFFFFFFu};
+  const uint64_t aHigh{a >> 32};
+  const uint64_t bLow{b & 0xFFFFFFFFu};
+  const uint64_t bHigh{b >> 32};
+  const uint64_t lowLow{aLow * bLow};
+  const uint64_t lowHigh{aLow * bHigh};
+  const uint64_t highLow{aHigh * bLow};
+  const uint64_t middle{(lowLow >> 32) + (lowHigh & 0xFFFFFFFFu) + (highLow & 0xFFFFFFFFu)};
+  return {aHigh * bHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32), (middle << 32) | (lowLow & 0xFFFFFFFFu)};
+#endif
+}
+
+// value shifted by 0 to 127 bits
+inline UInt128 shiftLeft128(UInt128 value, int shift)
+{
+  if(shift >= 64)
+  {
+    return {value.low << (shift - 64), 0u};
+  }
+  return shift ? UInt128{(value.high << shift) | (value.low >> (64 - shift)), value.low << shift} : value;
+}
+
+inline UInt128 shiftRight128(UInt128 value, int shift)
+{
+  if(shift >= 64)
+  {
+    return {0u, value.high >> (shift - 64)};
+  }
+  return shift ? UInt128{value.high >> shift, (value.low >> shift) | (value.high << (64 - shift))} : value;
+}
+
+// dividend / divisor, for quotients that fit 64 bits - dividend.high has to be below divisor
+inline uint64_t divide128By64(UInt128 dividend, uint64_t divisor, uint64_t& remainder)
+{
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+  return _udiv128(dividend.high, dividend.low, divisor, &remainder);
+#elif defined(__SIZEOF_INT128__)
+  const unsigned __int128 value{(static_cast<unsigned __int128>(dividend.high) << 64) | dividend.low};
+  remainder = static_cast<uint64_t>(value % divisor);
+  return static_cast<uint64_t>(value / divisor);
+#else
+  // NOTE: Long division a bit at a time, the running remainder stays below divisor
+  uint64_t quotient{0u};
+  uint64_t running{dividend.high};
+  for(int bit{63}; bit >= 0; bit--)
+  {
+    const bool carry{(running >> 63) != 0u};
+    running = (running << 1) | ((dividend.low >> bit) & 1u);
+    quotient <<= 1;
+    if(carry || running >= divisor)
+    {
+      running -= divisor;
+      quotient |= 1u;
+    }
+  }
+  remainder = running;
+  return quotient;
+#endif
+}
+
+// Zero bits above the highest set one. value must not be 0.
+inline int leadingZeros64(uint64_t value)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return 63 - static_cast<int>(index);
+#elif defined(__GNUC__)
+  return __builtin_clzll(value);
+#else
+  int count{0};
+  for(; (value & (uint64_t(1) << 63)) == 0u; value <<= 1)
+  {
+    count++;
+  }
+  return count;
+#endif
+}
+
+// Zero bits below the lowest set one. value must not be 0.
+inline int trailingZeros64(uint64_t value)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<int>(index);
+#elif defined(__GNUC__)
+  return __builtin_ctzll(value);
+#else
+  int count{0};
+  for(; (value & 1u) == 0u; value >>= 1)
+  {
+    count++;
+  }
+  return count;
+#endif
+}
+
+// NOTE: __popcnt64 is the POPCNT instruction whatever /arch says, every x64 CPU Windows still runs on has it
+inline int popCount64(uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  return static_cast<int>(__popcnt64(value));
+#elif defined(__GNUC__)
+  return __builtin_popcountll(value);
+#else
+  value -= (value >> 1) & 0x5555555555555555ULL;
+  value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+  value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<int>((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// sum = a + b, returns the carry out
+inline bool addWithCarry64(uint64_t a, uint64_t b, uint64_t& sum)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long long result;
+  const unsigned char carry{_addcarry_u64(0, a, b, &result)};
+  sum = result;
+  return carry != 0;
+#elif defined(__GNUC__)
+  unsigned long long result;
+  const bool carry{__builtin_add_overflow(static_cast<unsigned long long>(a), static_cast<unsigned long long>(b),
+                                          &result)};
+  sum = result;
+  return carry;
+#else
+  sum = a + b;
+  return sum < a;
+#endif
+}
+
+#endif //PERFAWARE_PROFILING_COMMON_INTEGER_INTRINSICS_H_
@@ -0,0 +1,146 @@
+#ifndef PERFAWARE_PROFILING_COMMON_MACHINE_PROFILE_H_
+#define PERFAWARE_PROFILING_COMMON_MACHINE_PROFILE_H_
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// What bench_cache_sweep measured about a machine's cache hierarchy, saved as key=value lines so it can be read back
+// (and edited) without the benchmark. A level it found no plateau for stays 0, and so do the sizes derived from it.
+struct MachineProfile
+{
+  size_t threadCount{0u};
+  size_t l1Bytes{0u}; // the largest working set still read at L1 speed - a power of two, so at most the real size
+  size_t l2Bytes{0u};
+  size_t l3Bytes{0u};
+  double l1ReadGBps{0.0};
+  double l2ReadGBps{0.0};
+  double l3ReadGBps{0.0};
+  double dramReadGBps{0.0};
+  double dramReadGBpsAllCores{0.0};
+};
+
+namespace machine_profile_detail
+{
+constexpr size_t MEGABYTE{1024u * 1024u};
+constexpr double MAX_READ_GBPS{100000.0};
+
+// NOTE: The file is meant to be edited by hand, so every value has a ceiling well above any real machine's. A typo
+// past it would otherwise size the CLI's buffers from it.
+struct Field
+{
+  const char* key;
+  size_t MachineProfile::* size;
+  double MachineProfile::* rate;
+  size_t maxSize;
+};
+
+constexpr Field FIELDS[]{
+  {"threads", &MachineProfile::threadCount, nullptr, 4096u},
+  {"l1_bytes", &MachineProfile::l1Bytes, nullptr, 4u * MEGABYTE},
+  {"l2_bytes", &MachineProfile::l2Bytes, nullptr, 64u * MEGABYTE},
+  {"l3_bytes", &MachineProfile::l3Bytes, nullptr, 1024u * MEGABYTE},
+  {"l1_read_gbps", nullptr, &MachineProfile::l1ReadGBps, 0u},
+  {"l2_read_gbps", nullptr, &MachineProfile::l2ReadGBps, 0u},
+  {"l3_read_gbps", nullptr, &MachineProfile::l3ReadGBps, 0u},
+  {"dram_read_gbps", nullptr, &MachineProfile::dramReadGBps, 0u},
+  {"dram_read_gbps_all_cores", nullptr, &MachineProfile::dramReadGBpsAllCores, 0u},
+};
+} // namespace machine_profile_detail
+
+inline bool writeMachineProfile(const char* path, const MachineProfile& profile)
+{
+  FILE* file{fopen(path, "w")};
+  if(!file)
+  {
+    return false;
+  }
+  fprintf(file, "# Machine profile written by bench_cache_sweep\n");
+  for(const machine_profile_detail::Field& field : machine_profile_detail::FIELDS)
+  {
+    if(field.size)
+    {
+      fprintf(file, "%s=%llu\n", field.key, static_cast<unsigned long long>(profile.*field.size));
+    }
+    else
+    {
+      fprintf(file, "%s=%.3f\n", field.key, profile.*field.rate);
+    }
+  }
+  return fclose(file) == 0;
+}
+
+// Returns false when the file can't be opened or has a line that isn't a known key=number or a # comment, or a
+// number that is negative or past its key's ceiling
+inline bool readMachineProfile(const char* path, MachineProfile& profile)
+{
+  FILE* file{fopen(path, "r")};
+  if(!file)
+  {
+    return false;
+  }
+
+  bool valid{true};
+  char line[256];
+  while(valid && fgets(line, sizeof(line), file))
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+    char* value{strchr(line, '=')};
+    if(line[0] == '#' || line[0] == '\0')
+    {
+      continue;
+    }
+    valid = false;
+    if(!value)
+    {
+      break;
+    }
+    *value++ = '\0';
+    for(const machine_profile_detail::Field& field : machine_profile_detail::FIELDS)
+    {
+      if(strcmp(line, field.key) == 0)
+      {
+        char* end{nullptr};
+        errno = 0;
+        if(field.size)
+        {
+          const unsigned long long size{strtoull(value, &end, 10)};
+          valid = (value[0] != '-') && (size <= field.maxSize);
+          profile.*field.size = static_cast<size_t>(size);
+        }
+        else
+        {
+          const double rate{strtod(value, &end)};
+          valid = std::isfinite(rate) && (rate >= 0.0) && (rate <= machine_profile_detail::MAX_READ_GBPS);
+          profile.*field.rate = rate;
+        }
+        valid = valid && (errno != ERANGE) && (end != value && *end == '\0');
+        break;
+      }
+    }
+  }
+  fclose(file);
+  return valid;
+}
+
+// Stream chunk size: the chunk and the pairs parsed out of it (about a third of its size) stay in L2 together, with
+// room to spare for the answers and the rest. Rounded down to whole 4k pages, fallback without an L2 size.
+inline size_t streamChunkSizeFor(const MachineProfile& profile, size_t fallback)
+{
+  const size_t chunkSize{profile.l2Bytes / 2u / 4096u * 4096u};
+  return chunkSize >= 4096u ? chunkSize : fallback;
+}
+
+// Pairs per fastHaversine call: the 32 bytes of coordinates read and the 8 byte distance written per pair take half
+// of L1. A multiple of 64 so every vector width divides it, at most maxPairs, fallback without an L1 size.
+inline size_t distanceBlockSizeFor(const MachineProfile& profile, size_t fallback, size_t maxPairs)
+{
+  size_t pairs{profile.l1Bytes / 2u / (4u * sizeof(double) + sizeof(double)) / 64u * 64u};
+  pairs = pairs < maxPairs ? pairs : maxPairs;
+  return pairs >= 64u ? pairs : fallback;
+}
+
+#endif //PERFAWARE_PROFILING_COMMON_MACHINE_PROFILE_H_
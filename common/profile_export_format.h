@@ -0,0 +1,35 @@
+#ifndef PERFAWARE_PROFILING_COMMON_PROFILE_EXPORT_FORMAT_H_
+#define PERFAWARE_PROFILING_COMMON_PROFILE_EXPORT_FORMAT_H_
+
+#include <cstdint>
+
+// Binary form of the profiler's anchor table (see WriteProfileExport in profiler.h), what profile_diff reads besides
+// the JSON form. A header, then AnchorCount records, each followed by its LabelLength bytes of label (not
+// terminated). Every label is merged over all threads, the way the profile printout shows it. Integers are stored in
+// the writer's byte order, only little-endian hosts are supported.
+constexpr char PROFILE_EXPORT_MAGIC[8]{'P', 'R', 'O', 'F', 'A', 'N', 'C', 'H'};
+constexpr uint32_t PROFILE_EXPORT_VERSION{1u};
+
+struct ProfileExportHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t anchorCount;
+  uint64_t timerFreq;       // block timer ticks per second
+  uint64_t totalTSCElapsed; // BeginProfile to EndAndPrintProfile
+};
+static_assert(sizeof(ProfileExportHeader) == 32, "The header is part of the file format");
+
+struct ProfileExportAnchor
+{
+  uint64_t tscElapsedExclusive;
+  uint64_t tscElapsedInclusive;
+  uint64_t hitCount;
+  uint64_t processedByteCount;
+  uint64_t longestTSCElapsedInclusive; // the single thread time the bandwidth is measured over
+  uint32_t labelLength;
+  uint32_t reserved;
+};
+static_assert(sizeof(ProfileExportAnchor) == 48, "The record is part of the file format");
+
+#endif //PERFAWARE_PROFILING_COMMON_PROFILE_EXPORT_FORMAT_H_
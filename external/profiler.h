@@ -17,11 +17,21 @@
 #define PROFILER 0
 #endif
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "profile_export_format.h"
 
 using u32 = uint32_t;
 using f64 = double;
 using u64 = uint64_t;
+using s64 = int64_t;
 
 #define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
 
@@ -29,7 +39,6 @@ using u64 = uint64_t;
 
 #include <intrin.h>
 #include <Windows.h>
-#include <array>
 
 inline u64 GetOSTimerFreq()
 {
@@ -96,6 +105,9 @@ inline u64 EstimateCPUTimerFreq()
 #define READ_BLOCK_TIMER ReadCPUTimer
 #endif
 
+// NOTE: Events each thread keeps in trace mode unless asked for another count, 24mb per thread
+constexpr u64 DefaultProfileTraceCapacity = 1 << 20;
+
 #if PROFILER
 
 struct profile_anchor
@@ -104,59 +116,183 @@ struct profile_anchor
   u64 TSCElapsedInclusive; // NOTE(casey): DOES include children
   u64 HitCount;
   u64 ProcessedByteCount;
-  char const *Label;
 };
 
-inline std::array<profile_anchor, 4096>& GetGlobalProfilerAnchors()
+constexpr u32 MaxProfileAnchorCount = 4096;
+
+// NOTE: Anchor indices are handed out at run time, the first time each TimeBlock site executes, instead of from
+// __COUNTER__ - that restarts in every translation unit, so sites in different .cpp files used to share anchors. The
+// label is stored here once, at registration, rather than by every block exit. Index 0 is the root every thread's
+// outermost blocks count as their parent, the last index takes the sites past the table's end.
+struct profile_anchor_registry
+{
+  std::atomic<u32> NextIndex{1};
+  std::array<char const *, MaxProfileAnchorCount> Labels;
+};
+
+inline profile_anchor_registry& GetProfileAnchorRegistry()
 {
-  static std::array<profile_anchor, 4096> GlobalProfilerAnchors;
-  return GlobalProfilerAnchors;
+  static profile_anchor_registry Registry;
+  return Registry;
 }
 
-inline u32& GetGlobalProfilerParent()
+inline u32 RegisterProfileAnchor(char const *Label)
 {
-  static u32 GlobalProfilerParent;
-  return GlobalProfilerParent;
+  profile_anchor_registry& Registry = GetProfileAnchorRegistry();
+  u32 AnchorIndex = Registry.NextIndex.fetch_add(1);
+  if(AnchorIndex >= MaxProfileAnchorCount - 1)
+  {
+    AnchorIndex = MaxProfileAnchorCount - 1;
+    Label = "(anchors exhausted)";
+  }
+  Registry.Labels[AnchorIndex] = Label;
+  return AnchorIndex;
+}
+
+// NOTE: One timed block in trace mode, recorded when it ends
+struct profile_trace_event
+{
+  u64 BeginTSC;
+  u64 EndTSC;
+  u32 AnchorIndex;
+};
+
+// NOTE: Every thread that times a block gets its own anchor table and parent, so blocks on different threads never
+// touch the same counters and the hot path needs no atomics - only a thread local pointer load. The tables are merged
+// when the profile is printed.
+struct profile_thread
+{
+  std::array<profile_anchor, MaxProfileAnchorCount> Anchors;
+  u32 Parent;
+  u32 ThreadIndex; // NOTE: Order of registration, the first thread to time a block is 0
+
+  // NOTE: Trace mode only, null otherwise. A ring of a power of two events allocated when tracing starts or the
+  // thread registers, so recording is a store and an increment. Once it is full the oldest events are overwritten.
+  std::unique_ptr<profile_trace_event[]> TraceEvents;
+  u64 TraceMask;
+  u64 TraceEventCount; // NOTE: Every event recorded, the ones more than a ring behind are gone
+};
+
+// NOTE: A table outlives its thread. When the thread exits the table goes on the free list with its counts and the
+// next new thread continues in it, so memory stays bounded by the number of threads alive at once and workers
+// started again and again (one wave per run) keep adding to the same per-thread lines.
+struct profile_thread_registry
+{
+  std::mutex Mutex;
+  std::vector<std::unique_ptr<profile_thread>> Threads;
+  std::vector<profile_thread *> FreeThreads;
+
+  FILE *TraceFile = nullptr; // NOTE: Set while tracing, every thread table gets a ring of TraceCapacity events
+  u64 TraceCapacity = 0;
+
+  FILE *ExportFile = nullptr; // NOTE: Set between BeginProfileExport and the profile printout
+  bool ExportJSON = false;
+};
+
+inline profile_thread_registry& GetProfilerThreadRegistry()
+{
+  static profile_thread_registry Registry;
+  return Registry;
+}
+
+inline thread_local profile_thread *GlobalProfilerThread = nullptr;
+
+inline void AllocateProfileTrace(profile_thread *Thread, u64 Capacity)
+{
+  if(!Thread->TraceEvents)
+  {
+    Thread->TraceEvents = std::make_unique<profile_trace_event[]>(Capacity);
+    Thread->TraceMask = Capacity - 1;
+    Thread->TraceEventCount = 0;
+  }
+}
+
+struct profile_thread_release
+{
+  ~profile_thread_release()
+  {
+    profile_thread_registry& Registry = GetProfilerThreadRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    Registry.FreeThreads.push_back(GlobalProfilerThread);
+    GlobalProfilerThread = nullptr;
+  }
+};
+
+// NOTE: Cold path, taken by the first block a thread times
+inline profile_thread *RegisterProfilerThread()
+{
+  {
+    profile_thread_registry& Registry = GetProfilerThreadRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    if(Registry.FreeThreads.empty())
+    {
+      Registry.Threads.push_back(std::make_unique<profile_thread>());
+      GlobalProfilerThread = Registry.Threads.back().get();
+      GlobalProfilerThread->ThreadIndex = (u32)(Registry.Threads.size() - 1);
+    }
+    else
+    {
+      GlobalProfilerThread = Registry.FreeThreads.back();
+      Registry.FreeThreads.pop_back();
+    }
+    if(Registry.TraceFile)
+    {
+      AllocateProfileTrace(GlobalProfilerThread, Registry.TraceCapacity);
+    }
+    GlobalProfilerThread->Parent = 0;
+  }
+
+  // NOTE: Constructed here rather than on every block, its destructor hands the table back when the thread exits
+  static thread_local profile_thread_release Release;
+  (void)Release;
+  return GlobalProfilerThread;
 }
 
 struct profile_block
 {
-  profile_block(char const *Label_, u32 AnchorIndex_, u64 ByteCount)
+  profile_block(u32 AnchorIndex_, u64 ByteCount)
   {
-    ParentIndex = GetGlobalProfilerParent();
+    Thread = GlobalProfilerThread;
+    if(!Thread)
+    {
+      Thread = RegisterProfilerThread();
+    }
+    ParentIndex = Thread->Parent;
 
     AnchorIndex = AnchorIndex_;
-    Label = Label_;
 
-    profile_anchor& Anchor = GetGlobalProfilerAnchors()[AnchorIndex];
+    profile_anchor& Anchor = Thread->Anchors[AnchorIndex];
     OldTSCElapsedInclusive = Anchor.TSCElapsedInclusive;
     Anchor.ProcessedByteCount += ByteCount;
 
-    GetGlobalProfilerParent() = AnchorIndex;
+    Thread->Parent = AnchorIndex;
     StartTSC = READ_BLOCK_TIMER();
   }
 
   ~profile_block()
   {
-    u64 Elapsed = READ_BLOCK_TIMER() - StartTSC;
-    GetGlobalProfilerParent() = ParentIndex;
+    u64 EndTSC = READ_BLOCK_TIMER();
+    u64 Elapsed = EndTSC - StartTSC;
+    Thread->Parent = ParentIndex;
 
-    profile_anchor& Parent = GetGlobalProfilerAnchors()[ParentIndex];
-    profile_anchor& Anchor = GetGlobalProfilerAnchors()[AnchorIndex];
+    profile_anchor& Parent = Thread->Anchors[ParentIndex];
+    profile_anchor& Anchor = Thread->Anchors[AnchorIndex];
 
     Parent.TSCElapsedExclusive -= Elapsed;
     Anchor.TSCElapsedExclusive += Elapsed;
     Anchor.TSCElapsedInclusive = OldTSCElapsedInclusive + Elapsed;
     ++Anchor.HitCount;
 
-    /* NOTE(casey): This write happens every time solely because there is no
-       straightforward way in C++ to have the same ease-of-use. In a better programming
-       language, it would be simple to have the anchor points gathered and labeled at compile
-       time, and this repetative write would be eliminated. */
-    Anchor.Label = Label;
+    if(Thread->TraceEvents)
+    {
+      profile_trace_event& Event = Thread->TraceEvents[Thread->TraceEventCount++ & Thread->TraceMask];
+      Event.BeginTSC = StartTSC;
+      Event.EndTSC = EndTSC;
+      Event.AnchorIndex = AnchorIndex;
+    }
   }
 
-  char const *Label;
+  profile_thread *Thread;
   u64 OldTSCElapsedInclusive;
   u64 StartTSC;
   u32 ParentIndex;
@@ -165,13 +301,20 @@ struct profile_block
 
 #define NameConcat2(A, B) A##B
 #define NameConcat(A, B) NameConcat2(A, B)
-#define TimeBandwidth(Name, ByteCount) profile_block NameConcat(Block, __LINE__)(Name, __COUNTER__ + 1, ByteCount)
-#define ProfilerEndOfCompilationUnit static_assert(__COUNTER__ < ArrayCount(GetGlobalProfilerAnchors()), "Number of profile points exceeds size of profiler::Anchors array")
-
-inline void PrintTimeElapsed(u64 TotalTSCElapsed, u64 TimerFreq, profile_anchor *Anchor)
+// NOTE: The site's anchor is a function local static, registered with Name the first time the site runs and shared by
+// every thread after that. Name is read once, so a site keeps its first label - give blocks with different names
+// their own sites. Inline functions have one static across all translation units, so one anchor per site there too.
+#define TimeBandwidth(Name, ByteCount) \
+  static u32 const NameConcat(Anchor, __LINE__) = RegisterProfileAnchor(Name); \
+  profile_block NameConcat(Block, __LINE__)(NameConcat(Anchor, __LINE__), ByteCount)
+
+// NOTE: Seconds is the time the bandwidth is measured over, the anchor's own inclusive time except for the merged
+// lines of blocks timed on several threads
+inline void PrintTimeElapsed(u64 TotalTSCElapsed, char const *Indent, char const *Label, profile_anchor *Anchor,
+                             f64 Seconds)
 {
   f64 Percent = 100.0 * ((f64)Anchor->TSCElapsedExclusive / (f64)TotalTSCElapsed);
-  printf("  %s[%llu]: %llu (%.2f%%", Anchor->Label, Anchor->HitCount, Anchor->TSCElapsedExclusive, Percent);
+  printf("%s%s[%llu]: %llu (%.2f%%", Indent, Label, Anchor->HitCount, Anchor->TSCElapsedExclusive, Percent);
   if(Anchor->TSCElapsedInclusive != Anchor->TSCElapsedExclusive)
   {
     f64 PercentWithChildren = 100.0 * ((f64)Anchor->TSCElapsedInclusive / (f64)TotalTSCElapsed);
@@ -184,7 +327,6 @@ inline void PrintTimeElapsed(u64 TotalTSCElapsed, u64 TimerFreq, profile_anchor
     f64 Megabyte = 1024.0f*1024.0f;
     f64 Gigabyte = Megabyte*1024.0f;
 
-    f64 Seconds = (f64)Anchor->TSCElapsedInclusive / (f64)TimerFreq;
     f64 BytesPerSecond = (f64)Anchor->ProcessedByteCount / Seconds;
     f64 Megabytes = (f64)Anchor->ProcessedByteCount / (f64)Megabyte;
     f64 GigabytesPerSecond = BytesPerSecond / Gigabyte;
@@ -195,23 +337,332 @@ inline void PrintTimeElapsed(u64 TotalTSCElapsed, u64 TimerFreq, profile_anchor
   printf("\n");
 }
 
-inline void PrintAnchorData(u64 TotalCPUElapsed, u64 TimerFreq)
+// One label summed over every thread's table. The caller holds the registry mutex.
+struct profile_merged_anchor
+{
+  profile_anchor Merged;
+  u64 LongestTSCElapsedInclusive;
+  u32 ThreadsHit;
+  u32 LastThreadIndex;
+};
+
+inline profile_merged_anchor MergeProfileAnchor(profile_thread_registry& Registry, u32 AnchorIndex)
 {
-  for(u32 AnchorIndex = 0; AnchorIndex < ArrayCount(GetGlobalProfilerAnchors()); ++AnchorIndex)
+  profile_merged_anchor Result = {};
+  for(std::unique_ptr<profile_thread>& Thread : Registry.Threads)
   {
-    profile_anchor& Anchor = GetGlobalProfilerAnchors()[AnchorIndex];;
+    profile_anchor& Anchor = Thread->Anchors[AnchorIndex];
     if(Anchor.TSCElapsedInclusive)
     {
-      PrintTimeElapsed(TotalCPUElapsed, TimerFreq, &Anchor);
+      Result.Merged.TSCElapsedExclusive += Anchor.TSCElapsedExclusive;
+      Result.Merged.TSCElapsedInclusive += Anchor.TSCElapsedInclusive;
+      Result.Merged.HitCount += Anchor.HitCount;
+      Result.Merged.ProcessedByteCount += Anchor.ProcessedByteCount;
+      ++Result.ThreadsHit;
+      Result.LastThreadIndex = Thread->ThreadIndex;
+      if(Anchor.TSCElapsedInclusive > Result.LongestTSCElapsedInclusive)
+      {
+        Result.LongestTSCElapsedInclusive = Anchor.TSCElapsedInclusive;
+      }
     }
   }
+  return Result;
+}
+
+// Prints every label merged over all threads: times and byte counts are summed, so percentages are of the wall
+// time summed over the threads, and the bandwidth is over the longest single thread's time - the wall time of a
+// region the threads ran side by side. Labels timed on other threads than the first are followed by a line per thread.
+//
+// NOTE: Only call this once the other threads are joined, their tables are read without synchronization.
+inline void PrintAnchorData(u64 TotalCPUElapsed, u64 TimerFreq)
+{
+  profile_thread_registry& Registry = GetProfilerThreadRegistry();
+  std::lock_guard<std::mutex> Lock(Registry.Mutex);
+  profile_anchor_registry& AnchorRegistry = GetProfileAnchorRegistry();
+
+  for(u32 AnchorIndex = 0; AnchorIndex < MaxProfileAnchorCount; ++AnchorIndex)
+  {
+    profile_merged_anchor Merged = MergeProfileAnchor(Registry, AnchorIndex);
+    if(Merged.Merged.TSCElapsedInclusive)
+    {
+      PrintTimeElapsed(TotalCPUElapsed, "  ", AnchorRegistry.Labels[AnchorIndex], &Merged.Merged,
+                       (f64)Merged.LongestTSCElapsedInclusive / (f64)TimerFreq);
+      // NOTE: Labels only the first thread ever timed need no breakdown
+      if(Merged.ThreadsHit > 1 || Merged.LastThreadIndex != 0)
+      {
+        for(std::unique_ptr<profile_thread>& Thread : Registry.Threads)
+        {
+          profile_anchor& Anchor = Thread->Anchors[AnchorIndex];
+          if(Anchor.TSCElapsedInclusive)
+          {
+            char ThreadLabel[32];
+            snprintf(ThreadLabel, sizeof(ThreadLabel), "thread %u", Thread->ThreadIndex);
+            PrintTimeElapsed(TotalCPUElapsed, "    ", ThreadLabel, &Anchor,
+                             (f64)Anchor.TSCElapsedInclusive / (f64)TimerFreq);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Starts trace mode: from here on every block also records its begin and end into its thread's ring of EventCapacity
+// events (rounded up to a power of two), and the profile printout writes them to Path as Chrome trace event JSON -
+// open it in chrome://tracing or ui.perfetto.dev. Returns false when Path can't be created.
+//
+// NOTE: Call it before starting threads that time blocks, the threads already registered get their rings here
+inline bool BeginProfileTrace(char const *Path, u64 EventCapacity = DefaultProfileTraceCapacity)
+{
+  profile_thread_registry& Registry = GetProfilerThreadRegistry();
+  std::lock_guard<std::mutex> Lock(Registry.Mutex);
+  if(Registry.TraceFile)
+  {
+    fclose(Registry.TraceFile);
+  }
+  Registry.TraceFile = fopen(Path, "wb");
+  if(!Registry.TraceFile)
+  {
+    return false;
+  }
+
+  Registry.TraceCapacity = 1;
+  while(Registry.TraceCapacity < EventCapacity)
+  {
+    Registry.TraceCapacity *= 2;
+  }
+  for(std::unique_ptr<profile_thread>& Thread : Registry.Threads)
+  {
+    AllocateProfileTrace(Thread.get(), Registry.TraceCapacity);
+  }
+  return true;
+}
+
+// NOTE: Cycles one empty traced block costs, timer reads and bookkeeping included - what every block adds to its
+// parent. Measured on a scratch table swapped in for this thread's, the best of several runs so interrupts don't count.
+inline f64 EstimateProfileBlockOverhead()
+{
+  constexpr u32 BlockCount = 4096;
+  constexpr u32 RunCount = 16;
+
+  std::unique_ptr<profile_thread> Scratch = std::make_unique<profile_thread>();
+  AllocateProfileTrace(Scratch.get(), BlockCount);
+  profile_thread *Saved = GlobalProfilerThread;
+  GlobalProfilerThread = Scratch.get();
+
+  u64 BestElapsed = ~(u64)0;
+  for(u32 RunIndex = 0; RunIndex < RunCount; ++RunIndex)
+  {
+    u64 Start = READ_BLOCK_TIMER();
+    for(u32 BlockIndex = 0; BlockIndex < BlockCount; ++BlockIndex)
+    {
+      profile_block Block(1, 0);
+    }
+    u64 Elapsed = READ_BLOCK_TIMER() - Start;
+    if(Elapsed < BestElapsed)
+    {
+      BestElapsed = Elapsed;
+    }
+  }
+
+  GlobalProfilerThread = Saved;
+  return (f64)BestElapsed / (f64)BlockCount;
+}
+
+inline void WriteTraceString(FILE *File, char const *String)
+{
+  fputc('"', File);
+  for(char const *At = String; *At; ++At)
+  {
+    if(*At == '"' || *At == '\\')
+    {
+      fputc('\\', File);
+    }
+    if((unsigned char)*At >= ' ')
+    {
+      fputc(*At, File);
+    }
+  }
+  fputc('"', File);
+}
+
+// Writes the trace started by BeginProfileTrace as complete ("X") events, one track per thread table, times in
+// microseconds since BeginProfile. Reports what was dropped and an estimate of what profiling cost.
+//
+// NOTE: Like PrintAnchorData, only call this once the other threads are joined
+inline void WriteProfileTrace(u64 StartTSC, u64 TotalTSCElapsed, u64 TimerFreq)
+{
+  profile_thread_registry& Registry = GetProfilerThreadRegistry();
+  std::lock_guard<std::mutex> Lock(Registry.Mutex);
+  profile_anchor_registry& AnchorRegistry = GetProfileAnchorRegistry();
+  FILE *File = Registry.TraceFile;
+  if(!File || !TimerFreq)
+  {
+    return;
+  }
+
+  f64 MicrosecondsPerTSC = 1000000.0 / (f64)TimerFreq;
+  u64 WrittenCount = 0;
+  u64 DroppedCount = 0;
+  u64 BlockCount = 0;
+  char const *Separator = "\n";
+  fprintf(File, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+  for(std::unique_ptr<profile_thread>& Thread : Registry.Threads)
+  {
+    for(profile_anchor& Anchor : Thread->Anchors)
+    {
+      BlockCount += Anchor.HitCount;
+    }
+    if(!Thread->TraceEvents)
+    {
+      continue;
+    }
+
+    fprintf(File, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %u, "
+            "\"args\": {\"name\": \"thread %u\"}}", Separator, Thread->ThreadIndex, Thread->ThreadIndex);
+    Separator = ",\n";
+
+    u64 Capacity = Thread->TraceMask + 1;
+    u64 FirstEvent = Thread->TraceEventCount > Capacity ? Thread->TraceEventCount - Capacity : 0;
+    DroppedCount += FirstEvent;
+    for(u64 EventIndex = FirstEvent; EventIndex < Thread->TraceEventCount; ++EventIndex)
+    {
+      profile_trace_event& Event = Thread->TraceEvents[EventIndex & Thread->TraceMask];
+      fprintf(File, "%s{\"ph\": \"X\", \"name\": ", Separator);
+      WriteTraceString(File, AnchorRegistry.Labels[Event.AnchorIndex]);
+      fprintf(File, ", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", Thread->ThreadIndex,
+              (f64)(s64)(Event.BeginTSC - StartTSC) * MicrosecondsPerTSC,
+              (f64)(Event.EndTSC - Event.BeginTSC) * MicrosecondsPerTSC);
+      ++WrittenCount;
+    }
+  }
+  fprintf(File, "\n],\n\"otherData\": {\"droppedEvents\": %llu, \"ringCapacity\": %llu}}\n", DroppedCount,
+          Registry.TraceCapacity);
+  bool Written = !ferror(File);
+  Written = (fclose(File) == 0) && Written;
+  Registry.TraceFile = nullptr;
+
+  // NOTE: The block count is summed over the threads, on several threads the percentage overstates the wall time lost
+  f64 BlockOverhead = EstimateProfileBlockOverhead();
+  printf("\nTrace: %llu events%s, %llu dropped (ring of %llu per thread)\n", WrittenCount,
+         Written ? " written" : " - writing the file FAILED", DroppedCount, Registry.TraceCapacity);
+  printf("Profiler overhead: ~%.0f cycles per block, %llu blocks, ~%.2f%% of the total\n", BlockOverhead, BlockCount,
+         100.0 * BlockOverhead * (f64)BlockCount / (f64)TotalTSCElapsed);
+}
+
+// Makes the profile printout also save the anchor table to Path - as JSON, or in the binary form of
+// profile_export_format.h - for profile_diff to compare against other runs. Returns false when Path can't be created.
+inline bool BeginProfileExport(char const *Path, bool JSON)
+{
+  profile_thread_registry& Registry = GetProfilerThreadRegistry();
+  std::lock_guard<std::mutex> Lock(Registry.Mutex);
+  if(Registry.ExportFile)
+  {
+    fclose(Registry.ExportFile);
+  }
+  Registry.ExportFile = fopen(Path, "wb");
+  Registry.ExportJSON = JSON;
+  return Registry.ExportFile != nullptr;
+}
+
+// Writes the table PrintAnchorData prints, one entry per label that was hit, merged over the threads the same way.
+//
+// NOTE: Like PrintAnchorData, only call this once the other threads are joined
+inline void WriteProfileExport(u64 TotalTSCElapsed, u64 TimerFreq)
+{
+  profile_thread_registry& Registry = GetProfilerThreadRegistry();
+  std::lock_guard<std::mutex> Lock(Registry.Mutex);
+  profile_anchor_registry& AnchorRegistry = GetProfileAnchorRegistry();
+  FILE *File = Registry.ExportFile;
+  if(!File)
+  {
+    return;
+  }
+
+  // NOTE: The binary header needs the count up front, merging again below is cheaper than keeping every merge
+  u32 AnchorCount = 0;
+  for(u32 AnchorIndex = 0; AnchorIndex < MaxProfileAnchorCount; ++AnchorIndex)
+  {
+    AnchorCount += (MergeProfileAnchor(Registry, AnchorIndex).Merged.TSCElapsedInclusive != 0);
+  }
+
+  if(Registry.ExportJSON)
+  {
+    fprintf(File, "{\"version\": %u, \"timer_freq\": %llu, \"total_tsc\": %llu, \"anchors\": [",
+            PROFILE_EXPORT_VERSION, TimerFreq, TotalTSCElapsed);
+  }
+  else
+  {
+    ProfileExportHeader Header = {};
+    memcpy(Header.magic, PROFILE_EXPORT_MAGIC, sizeof(Header.magic));
+    Header.version = PROFILE_EXPORT_VERSION;
+    Header.anchorCount = AnchorCount;
+    Header.timerFreq = TimerFreq;
+    Header.totalTSCElapsed = TotalTSCElapsed;
+    fwrite(&Header, sizeof(Header), 1, File);
+  }
+
+  char const *Separator = "\n";
+  for(u32 AnchorIndex = 0; AnchorIndex < MaxProfileAnchorCount; ++AnchorIndex)
+  {
+    profile_merged_anchor MergedAnchor = MergeProfileAnchor(Registry, AnchorIndex);
+    profile_anchor& Merged = MergedAnchor.Merged;
+    if(!Merged.TSCElapsedInclusive)
+    {
+      continue;
+    }
+
+    char const *Label = AnchorRegistry.Labels[AnchorIndex];
+    if(Registry.ExportJSON)
+    {
+      fprintf(File, "%s{\"label\": ", Separator);
+      WriteTraceString(File, Label);
+      fprintf(File, ", \"hits\": %llu, \"exclusive_tsc\": %llu, \"inclusive_tsc\": %llu, \"bytes\": %llu, "
+              "\"longest_inclusive_tsc\": %llu}", Merged.HitCount, Merged.TSCElapsedExclusive,
+              Merged.TSCElapsedInclusive, Merged.ProcessedByteCount, MergedAnchor.LongestTSCElapsedInclusive);
+      Separator = ",\n";
+    }
+    else
+    {
+      ProfileExportAnchor Record = {};
+      Record.tscElapsedExclusive = Merged.TSCElapsedExclusive;
+      Record.tscElapsedInclusive = Merged.TSCElapsedInclusive;
+      Record.hitCount = Merged.HitCount;
+      Record.processedByteCount = Merged.ProcessedByteCount;
+      Record.longestTSCElapsedInclusive = MergedAnchor.LongestTSCElapsedInclusive;
+      Record.labelLength = (u32)strlen(Label);
+      fwrite(&Record, sizeof(Record), 1, File);
+      fwrite(Label, 1, Record.labelLength, File);
+    }
+  }
+  if(Registry.ExportJSON)
+  {
+    fprintf(File, "\n]}\n");
+  }
+
+  bool Written = !ferror(File);
+  Written = (fclose(File) == 0) && Written;
+  Registry.ExportFile = nullptr;
+  printf("\nProfile export: %u labels%s\n", AnchorCount, Written ? " written" : " - writing the file FAILED");
 }
 
 #else
 
 #define TimeBandwidth(...)
 #define PrintAnchorData(...)
-#define ProfilerEndOfCompilationUnit
+#define WriteProfileTrace(...)
+#define WriteProfileExport(...)
+
+inline bool BeginProfileTrace(char const *, u64 = 0)
+{
+  fprintf(stderr, "Tracing needs a build with PROFILER=1\n");
+  return false;
+}
+
+inline bool BeginProfileExport(char const *, bool)
+{
+  fprintf(stderr, "Profile export needs a build with PROFILER=1\n");
+  return false;
+}
 
 #endif
 
@@ -273,6 +724,8 @@ inline void EndAndPrintProfile()
   }
 
   PrintAnchorData(TotalTSCElapsed, TimerFreq);
+  WriteProfileExport(TotalTSCElapsed, TimerFreq);
+  WriteProfileTrace(GlobalProfiler.StartTSC, TotalTSCElapsed, TimerFreq);
 }
 
 #endif //PERFAWARE_PROFILING_EXTERNAL_PROFILER_H_
@@ -30,8 +30,17 @@ enum repetition_value_type
     RepValue_MemPageFaults,
     RepValue_ByteCount,
     
+    // NOTE: Hardware counters, in os_perf_counter_type order. They stay 0 unless InitializeOSPerfCounters succeeded.
+    RepValue_Instructions,
+    RepValue_Cycles,
+    RepValue_BranchMisses,
+    RepValue_L1DMisses,
+    RepValue_LLCMisses,
+    RepValue_DTLBMisses,
+    
     RepValue_Count,
 };
+static_assert(RepValue_DTLBMisses - RepValue_Instructions + 1 == PerfCounter_Count, "One value per counter");
 
 struct repetition_value
 {
@@ -45,6 +54,35 @@ struct repetition_test_results
     repetition_value Max;
 };
 
+/* NOTE: CPU timer values per test go into log-linear buckets: exact below 256, above that every power of two is split
+   into 128 equal buckets, so a percentile read back from the bucket midpoint is within 0.4% of the real one.
+   Anything past 2^40 ticks (minutes of runtime) lands in the last bucket. */
+enum
+{
+    RepHistogram_SubBucketBits = 7,
+    RepHistogram_SubBucketCount = 1 << RepHistogram_SubBucketBits,
+    RepHistogram_MaxHighBit = 40,
+    RepHistogram_BucketCount = RepHistogram_SubBucketCount*(RepHistogram_MaxHighBit - RepHistogram_SubBucketBits + 2),
+};
+
+struct repetition_samples
+{
+    u64 Count;
+    f64 Mean;
+    f64 M2; // NOTE: Welford's running sum of squared differences from the mean, for the standard deviation
+    u32 Buckets[RepHistogram_BucketCount];
+};
+
+/* NOTE: All zero is the original behaviour - no warmup, a wave ends only after SecondsToTry without a new minimum,
+   and results are printed. */
+struct repetition_settings
+{
+    u32 WarmupCount; // runs at the start of every wave that are checked but not recorded
+    u32 MinSampleCount; // with TargetCI, the runs a wave records before it may stop early (0 means 10)
+    f64 TargetCI; // end a wave once the 95% confidence interval of the mean is within this fraction of it, 0 is off
+    b32 Quiet; // print nothing, for callers that report the results themselves
+};
+
 struct repetition_tester
 {
     u64 TargetProcessedByteCount;
@@ -57,8 +95,14 @@ struct repetition_tester
     u32 OpenBlockCount;
     u32 CloseBlockCount;
     
+    repetition_settings Settings;
+    char const *Name; // for the result export, set by whoever runs the test
+    u32 WarmupLeft;
+    u64 WaveSampleCount;
+    
     repetition_value AccumulatedOnThisTest;
     repetition_test_results Results;
+    repetition_samples Samples;
 };
 
 static f64 SecondsFromCPUTime(f64 CPUTime, u64 CPUTimerFreq)
@@ -72,6 +116,112 @@ static f64 SecondsFromCPUTime(f64 CPUTime, u64 CPUTimerFreq)
     return Result;
 }
  
+static u32 HistogramBucketFromValue(u64 Value)
+{
+    u32 Result = (u32)Value;
+    if(Value >= 2*RepHistogram_SubBucketCount)
+    {
+        u32 HighBit = RepHistogram_SubBucketBits;
+        while((HighBit < RepHistogram_MaxHighBit) && (Value >> (HighBit + 1)))
+        {
+            ++HighBit;
+        }
+        
+        Result = RepHistogram_SubBucketCount*(HighBit - RepHistogram_SubBucketBits + 1) +
+            (u32)((Value >> (HighBit - RepHistogram_SubBucketBits)) & (RepHistogram_SubBucketCount - 1));
+        if(Value >> (HighBit + 1))
+        {
+            Result = RepHistogram_BucketCount - 1;
+        }
+    }
+    
+    return Result;
+}
+
+static f64 ValueFromHistogramBucket(u32 Bucket)
+{
+    f64 Result = (f64)Bucket;
+    if(Bucket >= 2*RepHistogram_SubBucketCount)
+    {
+        u32 Shift = Bucket/RepHistogram_SubBucketCount - 1;
+        u64 SubBucket = Bucket % RepHistogram_SubBucketCount;
+        u64 Width = 1ull << Shift;
+        Result = (f64)((RepHistogram_SubBucketCount + SubBucket) << Shift) + 0.5*(f64)(Width - 1);
+    }
+    
+    return Result;
+}
+
+static void AddSample(repetition_samples *Samples, u64 Value)
+{
+    ++Samples->Buckets[HistogramBucketFromValue(Value)];
+    
+    ++Samples->Count;
+    f64 Delta = (f64)Value - Samples->Mean;
+    Samples->Mean += Delta / (f64)Samples->Count;
+    Samples->M2 += Delta*((f64)Value - Samples->Mean);
+}
+
+// NOTE: Fraction 0.5 is the median. The value is the midpoint of the bucket the sample at that rank fell in.
+static f64 SamplePercentile(repetition_samples const *Samples, f64 Fraction)
+{
+    f64 Result = 0;
+    if(Samples->Count)
+    {
+        u64 Rank = (u64)ceil(Fraction*(f64)Samples->Count);
+        Rank = (Rank < 1) ? 1 : Rank;
+        
+        u64 Seen = 0;
+        for(u32 Bucket = 0; Bucket < RepHistogram_BucketCount; ++Bucket)
+        {
+            Seen += Samples->Buckets[Bucket];
+            if(Seen >= Rank)
+            {
+                Result = ValueFromHistogramBucket(Bucket);
+                break;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static f64 SampleStdDev(repetition_samples const *Samples)
+{
+    f64 Result = 0;
+    if(Samples->Count > 1)
+    {
+        Result = sqrt(Samples->M2 / (f64)(Samples->Count - 1));
+    }
+    
+    return Result;
+}
+
+// NOTE: Half the width of the 95% confidence interval of the mean, normal approximation
+static f64 SampleConfidence95(repetition_samples const *Samples)
+{
+    f64 Result = 0;
+    if(Samples->Count > 1)
+    {
+        Result = 1.96*SampleStdDev(Samples) / sqrt((f64)Samples->Count);
+    }
+    
+    return Result;
+}
+
+static f64 GigabytesPerSecond(f64 ByteCount, f64 CPUTime, u64 CPUTimerFreq)
+{
+    f64 Result = 0;
+    f64 Seconds = SecondsFromCPUTime(CPUTime, CPUTimerFreq);
+    if(Seconds > 0)
+    {
+        f64 Gigabyte = (1024.0f * 1024.0f * 1024.0f);
+        Result = ByteCount / (Gigabyte * Seconds);
+    }
+    
+    return Result;
+}
+
 static void PrintValue(char const *Label, repetition_value Value, u64 CPUTimerFreq)
 {
     u64 TestCount = Value.E[RepValue_TestCount];
@@ -101,6 +251,25 @@ static void PrintValue(char const *Label, repetition_value Value, u64 CPUTimerFr
     {
         printf(" PF: %0.4f (%0.4fk/fault)", E[RepValue_MemPageFaults], E[RepValue_ByteCount] / (E[RepValue_MemPageFaults] * 1024.0));
     }
+    
+    // NOTE: Core cycles, unlike the CPU timer, don't tick at a fixed rate - IPC is per core cycle. The misses are per
+    // kilobyte processed, so tests over different amounts of data compare.
+    if(E[RepValue_Cycles] > 0)
+    {
+        printf(" IPC: %.2f", E[RepValue_Instructions] / E[RepValue_Cycles]);
+        
+        f64 Kilobytes = E[RepValue_ByteCount] / 1024.0;
+        if(Kilobytes > 0)
+        {
+            printf(" ins/kb: %.0f", E[RepValue_Instructions] / Kilobytes);
+            
+            static char const *MissLabels[] = {"br miss", "L1D miss", "LLC miss", "dTLB miss"};
+            for(u32 MissIndex = 0; MissIndex < ArrayCount(MissLabels); ++MissIndex)
+            {
+                printf(" %s/kb: %.3f", MissLabels[MissIndex], E[RepValue_BranchMisses + MissIndex] / Kilobytes);
+            }
+        }
+    }
 }
 
 static void PrintResults(repetition_test_results Results, u64 CPUTimerFreq)
@@ -113,6 +282,32 @@ static void PrintResults(repetition_test_results Results, u64 CPUTimerFreq)
     printf("\n");
 }
 
+static void PrintStatistics(repetition_tester *Tester)
+{
+    repetition_samples *Samples = &Tester->Samples;
+    f64 ByteCount = (f64)Tester->TargetProcessedByteCount;
+    u64 CPUTimerFreq = Tester->CPUTimerFreq;
+    
+    static f64 const Fractions[] = {0.5, 0.9, 0.99};
+    static char const *Labels[] = {"Med", "p90", "p99"};
+    for(u32 Index = 0; Index < ArrayCount(Fractions); ++Index)
+    {
+        f64 Time = SamplePercentile(Samples, Fractions[Index]);
+        printf("%s: %.0f (%fms)", Labels[Index], Time, 1000.0*SecondsFromCPUTime(Time, CPUTimerFreq));
+        if(ByteCount > 0)
+        {
+            printf(" %fgb/s", GigabytesPerSecond(ByteCount, Time, CPUTimerFreq));
+        }
+        printf(Index + 1 < ArrayCount(Fractions) ? " " : "\n");
+    }
+    
+    f64 StdDev = SampleStdDev(Samples);
+    printf("SD: %.0f (%.2f%% of mean, 95%% CI +-%.2f%%) over %llu runs\n", StdDev,
+           Samples->Mean > 0 ? 100.0*StdDev/Samples->Mean : 0.0,
+           Samples->Mean > 0 ? 100.0*SampleConfidence95(Samples)/Samples->Mean : 0.0,
+           (unsigned long long)Samples->Count);
+}
+
 static void Error(repetition_tester *Tester, char const *Message)
 {
     Tester->Mode = TestMode_Error;
@@ -126,7 +321,7 @@ static void NewTestWave(repetition_tester *Tester, u64 TargetProcessedByteCount,
         Tester->Mode = TestMode_Testing;
         Tester->TargetProcessedByteCount = TargetProcessedByteCount;
         Tester->CPUTimerFreq = CPUTimerFreq;
-        Tester->PrintNewMinimums = true;
+        Tester->PrintNewMinimums = !Tester->Settings.Quiet;
         Tester->Results.Min.E[RepValue_CPUTimer] = (u64)-1;
     }
     else if(Tester->Mode == TestMode_Completed)
@@ -145,6 +340,8 @@ static void NewTestWave(repetition_tester *Tester, u64 TargetProcessedByteCount,
     }
 
     Tester->TryForTime = SecondsToTry*CPUTimerFreq;
+    Tester->WarmupLeft = Tester->Settings.WarmupCount;
+    Tester->WaveSampleCount = 0;
     Tester->TestsStartedAt = ReadCPUTimer();
 }
 
@@ -154,6 +351,14 @@ static void BeginTime(repetition_tester *Tester)
     
     repetition_value *Accum = &Tester->AccumulatedOnThisTest;
     Accum->E[RepValue_MemPageFaults] -= ReadOSPageFaultCount();
+    
+    u64 Counters[PerfCounter_Count] = {};
+    ReadOSPerfCounters(Counters);
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        Accum->E[RepValue_Instructions + CounterIndex] -= Counters[CounterIndex];
+    }
+    
     Accum->E[RepValue_CPUTimer] -= ReadCPUTimer();
 }
 
@@ -161,6 +366,14 @@ static void EndTime(repetition_tester *Tester)
 {
     repetition_value *Accum = &Tester->AccumulatedOnThisTest;
     Accum->E[RepValue_CPUTimer] += ReadCPUTimer();
+    
+    u64 Counters[PerfCounter_Count] = {};
+    ReadOSPerfCounters(Counters);
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        Accum->E[RepValue_Instructions + CounterIndex] += Counters[CounterIndex];
+    }
+    
     Accum->E[RepValue_MemPageFaults] += ReadOSPageFaultCount();
 
     ++Tester->CloseBlockCount;
@@ -191,7 +404,11 @@ static b32 IsTesting(repetition_tester *Tester)
                 Error(Tester, "Processed byte count mismatch");
             }
     
-            if(Tester->Mode == TestMode_Testing)
+            if((Tester->Mode == TestMode_Testing) && Tester->WarmupLeft)
+            {
+                --Tester->WarmupLeft;
+            }
+            else if(Tester->Mode == TestMode_Testing)
             {
                 repetition_test_results *Results = &Tester->Results;
                 
@@ -220,18 +437,34 @@ static b32 IsTesting(repetition_tester *Tester)
                     }
                 }
                 
-                Tester->OpenBlockCount = 0;
-                Tester->CloseBlockCount = 0;
-                Tester->AccumulatedOnThisTest = {};
+                AddSample(&Tester->Samples, Accum.E[RepValue_CPUTimer]);
+                ++Tester->WaveSampleCount;
             }
+            
+            Tester->OpenBlockCount = 0;
+            Tester->CloseBlockCount = 0;
+            Tester->AccumulatedOnThisTest = {};
+        }
+        
+        // NOTE: The interval is over every run recorded so far, but a wave always adds at least MinSampleCount
+        b32 Converged = false;
+        repetition_settings *Settings = &Tester->Settings;
+        u64 MinSampleCount = Settings->MinSampleCount ? Settings->MinSampleCount : 10;
+        if((Settings->TargetCI > 0) && (Tester->WaveSampleCount >= MinSampleCount))
+        {
+            Converged = (SampleConfidence95(&Tester->Samples) <= Settings->TargetCI*Tester->Samples.Mean);
         }
         
-        if((CurrentTime - Tester->TestsStartedAt) > Tester->TryForTime)
+        if(Converged || ((CurrentTime - Tester->TestsStartedAt) > Tester->TryForTime))
         {
             Tester->Mode = TestMode_Completed;
             
-            printf("                                                          \r");
-            PrintResults(Tester->Results, Tester->CPUTimerFreq);
+            if(!Settings->Quiet)
+            {
+                printf("                                                          \r");
+                PrintResults(Tester->Results, Tester->CPUTimerFreq);
+                PrintStatistics(Tester);
+            }
         }
     }
     
@@ -16,6 +16,20 @@
 
 static u64 EstimateCPUTimerFreq(void);
 
+// NOTE: Hardware counters the repetition tester can read around each timed block, in the order of their
+// repetition_value slots
+enum os_perf_counter_type
+{
+    PerfCounter_Instructions,
+    PerfCounter_Cycles,
+    PerfCounter_BranchMisses,
+    PerfCounter_L1DMisses,
+    PerfCounter_LLCMisses,
+    PerfCounter_DTLBMisses,
+
+    PerfCounter_Count,
+};
+
 #if _WIN32
 
 #include <intrin.h>
@@ -105,16 +119,48 @@ static void OSFree(size_t ByteCount, void *BaseAddress)
     VirtualFree(BaseAddress, 0, MEM_RELEASE);
 }
 
+// NOTE: Hardware counters are only implemented on Linux
+static b32 InitializeOSPerfCounters(void)
+{
+    fprintf(stderr, "WARNING: Hardware counters are not supported on this platform\n");
+    return false;
+}
+
+inline void ReadOSPerfCounters(u64 *Values)
+{
+    (void)Values;
+}
+
 #else
 
 #include <x86intrin.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/mman.h>
 
+struct os_perf_counter
+{
+    int FD;
+    perf_event_mmap_page *Page; // NOTE: Mapped so rdpmc can be used, 0 if the kernel didn't allow it
+};
+
 struct os_platform
 {
     b32 Initialized;
+    u64 LargePageSize; // NOTE: The default huge page size from /proc/meminfo, 0 if it isn't listed there
     u64 CPUTimerFreq;
+
+    // NOTE: One group, so all counters are on the PMU at the same time and their ratios mean something. Counters
+    // the CPU doesn't have are left out and read as 0.
+    b32 PerfCountersEnabled;
+    b32 PerfCountersUseRDPMC;
+    os_perf_counter PerfCounters[PerfCounter_Count];
 };
 static os_platform GlobalOSPlatform;
 
@@ -150,18 +196,48 @@ static u64 ReadOSPageFaultCount(void)
     return Result;
 }
 
+/* NOTE: Only says what size MAP_HUGETLB and transparent huge pages would use. Whether any huge pages are reserved
+   (vm.nr_hugepages) or THP is enabled only shows when an allocation asks for them. */
+static u64 ReadLargePageSize(void)
+{
+    u64 Result = 0;
+    
+    FILE *MemInfo = fopen("/proc/meminfo", "r");
+    if(MemInfo)
+    {
+        char Line[256];
+        while(fgets(Line, sizeof(Line), MemInfo))
+        {
+            unsigned long long Kilobytes = 0;
+            if(sscanf(Line, "Hugepagesize: %llu kB", &Kilobytes) == 1)
+            {
+                Result = Kilobytes*1024;
+                break;
+            }
+        }
+        fclose(MemInfo);
+    }
+    
+    return Result;
+}
+
 static void InitializeOSPlatform(void)
 {
     if(!GlobalOSPlatform.Initialized)
     {
         GlobalOSPlatform.Initialized = true;
+        GlobalOSPlatform.LargePageSize = ReadLargePageSize();
         GlobalOSPlatform.CPUTimerFreq = EstimateCPUTimerFreq();
     }
 }
 
 static void *OSAllocate(size_t ByteCount)
 {
-    void *Result = mmap(0, ByteCount, PROT_READ|PROT_WRITE, MAP_ANONYMOUS, 0, 0);
+    void *Result = mmap(0, ByteCount, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(Result == MAP_FAILED)
+    {
+        Result = 0;
+    }
     return Result;
 }
 
@@ -170,6 +246,194 @@ static void OSFree(size_t ByteCount, void *BaseAddress)
     munmap(BaseAddress, ByteCount);
 }
 
+static int OpenPerfCounter(u32 Type, u64 Config, int GroupFD)
+{
+    perf_event_attr Attr = {};
+    Attr.size = sizeof(Attr);
+    Attr.type = Type;
+    Attr.config = Config;
+    Attr.disabled = (GroupFD == -1);
+    Attr.exclude_kernel = 1; // NOTE: User space only, that is all perf_event_paranoid 2 allows
+    Attr.exclude_hv = 1;
+    Attr.read_format = PERF_FORMAT_GROUP|PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int Result = (int)syscall(SYS_perf_event_open, &Attr, 0, -1, GroupFD, 0);
+    return Result;
+}
+
+static void ClosePerfCounters(void)
+{
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        os_perf_counter *Counter = GlobalOSPlatform.PerfCounters + CounterIndex;
+        if(Counter->Page)
+        {
+            munmap(Counter->Page, sysconf(_SC_PAGESIZE));
+        }
+        if(Counter->FD != -1)
+        {
+            close(Counter->FD);
+        }
+        Counter->FD = -1;
+        Counter->Page = 0;
+    }
+    GlobalOSPlatform.PerfCountersEnabled = false;
+}
+
+/* NOTE: The group read - one syscall for every counter. The values come leader first, then the members in the order
+   they were opened. Returns false when the group did not get onto the PMU at all. */
+static b32 ReadPerfCounterGroup(u64 *Values)
+{
+    u64 Data[3 + PerfCounter_Count] = {};
+    int LeaderFD = GlobalOSPlatform.PerfCounters[PerfCounter_Cycles].FD;
+    if(read(LeaderFD, Data, sizeof(Data)) <= 0)
+    {
+        return false;
+    }
+
+    u64 *Value = Data + 3;
+    u64 *End = Data + 3 + Data[0];
+    Values[PerfCounter_Cycles] = *Value++;
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        if((CounterIndex != PerfCounter_Cycles) && (GlobalOSPlatform.PerfCounters[CounterIndex].FD != -1) &&
+           (Value < End))
+        {
+            Values[CounterIndex] = *Value++;
+        }
+    }
+
+    b32 Result = (Data[2] != 0); // NOTE: time_running
+    return Result;
+}
+
+/* NOTE: Opens instructions, cycles, branch misses and L1D, LLC and dTLB read misses for this thread, user space only.
+   Returns false, with the reason on stderr, when the CPU or the kernel doesn't offer the counters (no PMU in a VM,
+   perf_event_paranoid above 2, ...). The tester works the same without them, it just doesn't report them. */
+static b32 InitializeOSPerfCounters(void)
+{
+    struct counter_config
+    {
+        u32 Type;
+        u64 Config;
+    };
+    u64 CacheReadMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    counter_config Configs[PerfCounter_Count] = {};
+    Configs[PerfCounter_Instructions] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+    Configs[PerfCounter_Cycles] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+    Configs[PerfCounter_BranchMisses] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+    Configs[PerfCounter_L1DMisses] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | CacheReadMiss};
+    Configs[PerfCounter_LLCMisses] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | CacheReadMiss};
+    Configs[PerfCounter_DTLBMisses] = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | CacheReadMiss};
+
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        GlobalOSPlatform.PerfCounters[CounterIndex].FD = -1;
+    }
+
+    // NOTE: Cycles leads the group, every CPU with a PMU has it
+    int LeaderFD = OpenPerfCounter(Configs[PerfCounter_Cycles].Type, Configs[PerfCounter_Cycles].Config, -1);
+    if(LeaderFD == -1)
+    {
+        fprintf(stderr, "WARNING: Hardware counters unavailable (perf_event_open: %s)\n", strerror(errno));
+        return false;
+    }
+    GlobalOSPlatform.PerfCounters[PerfCounter_Cycles].FD = LeaderFD;
+
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        if(CounterIndex != PerfCounter_Cycles)
+        {
+            GlobalOSPlatform.PerfCounters[CounterIndex].FD =
+                OpenPerfCounter(Configs[CounterIndex].Type, Configs[CounterIndex].Config, LeaderFD);
+        }
+    }
+
+    ioctl(LeaderFD, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(LeaderFD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    u64 Values[PerfCounter_Count] = {};
+    if(!ReadPerfCounterGroup(Values))
+    {
+        fprintf(stderr, "WARNING: Hardware counters unavailable (the counter group does not fit on the PMU)\n");
+        ClosePerfCounters();
+        return false;
+    }
+
+    // NOTE: rdpmc reads a counter in a few dozen cycles instead of a syscall, but only when the kernel allows it
+    // for every counter (/sys/bus/event_source/devices/cpu/rdpmc)
+    GlobalOSPlatform.PerfCountersUseRDPMC = true;
+    for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+    {
+        os_perf_counter *Counter = GlobalOSPlatform.PerfCounters + CounterIndex;
+        if(Counter->FD != -1)
+        {
+            void *Page = mmap(0, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, Counter->FD, 0);
+            if(Page != MAP_FAILED)
+            {
+                Counter->Page = (perf_event_mmap_page *)Page;
+            }
+            if(!Counter->Page || !Counter->Page->cap_user_rdpmc)
+            {
+                GlobalOSPlatform.PerfCountersUseRDPMC = false;
+            }
+        }
+    }
+
+    GlobalOSPlatform.PerfCountersEnabled = true;
+    return true;
+}
+
+/* NOTE: The read sequence documented in linux/perf_event.h. Index is 0 while the counter is not on the PMU, then
+   the whole count is in offset. */
+inline u64 ReadPerfCounterRDPMC(perf_event_mmap_page volatile *Page)
+{
+    u64 Result;
+    u32 Sequence;
+    do
+    {
+        Sequence = Page->lock;
+        __asm__ __volatile__("" ::: "memory");
+
+        u32 Index = Page->index;
+        Result = Page->offset;
+        if(Index)
+        {
+            u32 Shift = 64 - Page->pmc_width;
+            int64_t Count = (int64_t)((u64)__rdpmc(Index - 1) << Shift) >> Shift;
+            Result += Count;
+        }
+
+        __asm__ __volatile__("" ::: "memory");
+    } while(Page->lock != Sequence);
+
+    return Result;
+}
+
+/* NOTE: Fills Values with one running count per os_perf_counter_type, leaves them alone when the counters are off.
+   Only differences between two reads mean anything. */
+inline void ReadOSPerfCounters(u64 *Values)
+{
+    if(GlobalOSPlatform.PerfCountersEnabled)
+    {
+        if(GlobalOSPlatform.PerfCountersUseRDPMC)
+        {
+            for(u32 CounterIndex = 0; CounterIndex < PerfCounter_Count; ++CounterIndex)
+            {
+                os_perf_counter *Counter = GlobalOSPlatform.PerfCounters + CounterIndex;
+                if(Counter->Page)
+                {
+                    Values[CounterIndex] = ReadPerfCounterRDPMC(Counter->Page);
+                }
+            }
+        }
+        else
+        {
+            ReadPerfCounterGroup(Values);
+        }
+    }
+}
+
 #endif
 
 /* NOTE(casey): These do not need to be "inline", it could just be "static"
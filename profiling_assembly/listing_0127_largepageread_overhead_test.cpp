@@ -15,14 +15,31 @@
    ======================================================================== */
 
 #include <fcntl.h>
+#include <limits.h>
+
+#include <exception>
+
+#include "async_file_reader.h"
+
+#if _WIN32
 #include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 enum allocation_type
 {
     AllocType_none,
     AllocType_malloc,
+#if _WIN32
     AllocType_VirtualAlloc,
     AllocType_VirtualAllocLargePages,
+#else
+    AllocType_mmap,
+    AllocType_mmapPopulate, // NOTE: MAP_POPULATE, the kernel faults every page in before mmap returns
+    AllocType_mmapHugeTLB, // NOTE: MAP_HUGETLB, needs huge pages reserved up front (vm.nr_hugepages)
+    AllocType_mmapTHP, // NOTE: Transparent huge pages asked for with madvise(MADV_HUGEPAGE)
+#endif
     
     AllocType_Count,
 };
@@ -43,14 +60,39 @@ static char const *DescribeAllocationType(allocation_type AllocType)
     {
         case AllocType_none: {Result = "";} break;
         case AllocType_malloc: {Result = "malloc";} break;
+#if _WIN32
         case AllocType_VirtualAlloc: {Result = "VirtualAlloc";} break;
         case AllocType_VirtualAllocLargePages: {Result = "VirtualAlloc (large)";} break;
+#else
+        case AllocType_mmap: {Result = "mmap";} break;
+        case AllocType_mmapPopulate: {Result = "mmap (populate)";} break;
+        case AllocType_mmapHugeTLB: {Result = "mmap (hugetlb)";} break;
+        case AllocType_mmapTHP: {Result = "mmap (THP)";} break;
+#endif
         default : {Result = "UNKNOWN";} break;
     }
     
     return Result;
 }
 
+#if !_WIN32
+/* NOTE: Huge page allocations cover whole huge pages, so they need the rounded size again when they are unmapped */
+static size_t GetAllocationSize(allocation_type AllocType, size_t Count)
+{
+    size_t Result = Count;
+    if((AllocType == AllocType_mmapHugeTLB) || (AllocType == AllocType_mmapTHP))
+    {
+        u64 LargePageSize = GetLargePageSize();
+        if(LargePageSize)
+        {
+            Result = (Count + LargePageSize - 1) & ~(LargePageSize - 1);
+        }
+    }
+    
+    return Result;
+}
+#endif
+
 static void HandleAllocation(repetition_tester *Tester, read_parameters *Params, buffer *Buffer)
 {
     switch(Params->AllocType)
@@ -64,6 +106,7 @@ static void HandleAllocation(repetition_tester *Tester, read_parameters *Params,
             *Buffer = AllocateBuffer(Params->Dest.Count);
         } break;
         
+#if _WIN32
         case AllocType_VirtualAlloc:
         case AllocType_VirtualAllocLargePages:
         {
@@ -98,6 +141,88 @@ static void HandleAllocation(repetition_tester *Tester, read_parameters *Params,
                 Error(Tester, "Allocation failed");
             }
         } break;
+#else
+        case AllocType_mmap:
+        case AllocType_mmapPopulate:
+        case AllocType_mmapHugeTLB:
+        {
+            // NOTE: Buffer starts out as the shared destination, it must not be unmapped if this fails
+            *Buffer = {};
+            
+            int Flags = MAP_PRIVATE|MAP_ANONYMOUS;
+            if(Params->AllocType == AllocType_mmapPopulate)
+            {
+                Flags |= MAP_POPULATE;
+            }
+            else if(Params->AllocType == AllocType_mmapHugeTLB)
+            {
+                Flags |= MAP_HUGETLB;
+            }
+            
+            void *AllocData = mmap(0, GetAllocationSize(Params->AllocType, Params->Dest.Count),
+                                   PROT_READ|PROT_WRITE, Flags, -1, 0);
+            if(AllocData != MAP_FAILED)
+            {
+                Buffer->Count = Params->Dest.Count;
+                Buffer->Data = (u8 *)AllocData;
+            }
+            else
+            {
+                Error(Tester, (Params->AllocType == AllocType_mmapHugeTLB) ?
+                      "Allocation failed (are huge pages reserved? see vm.nr_hugepages)" : "Allocation failed");
+            }
+        } break;
+        
+        case AllocType_mmapTHP:
+        {
+            // NOTE: A transparent huge page only backs a huge page aligned range, mmap only aligns to the small page
+            // size. So map one huge page more than needed and unmap what sticks out on either side of the aligned part.
+            *Buffer = {};
+            
+            u64 LargePageSize = GetLargePageSize();
+            size_t AllocSize = GetAllocationSize(Params->AllocType, Params->Dest.Count);
+            u8 *Mapped = 0;
+            if(LargePageSize)
+            {
+                void *MapResult = mmap(0, AllocSize + LargePageSize, PROT_READ|PROT_WRITE,
+                                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+                if(MapResult != MAP_FAILED)
+                {
+                    Mapped = (u8 *)MapResult;
+                }
+            }
+            else
+            {
+                Error(Tester, "No large page support");
+            }
+            
+            if(Mapped)
+            {
+                u8 *AllocData = (u8 *)(((uintptr_t)Mapped + LargePageSize - 1) & ~(uintptr_t)(LargePageSize - 1));
+                size_t Before = AllocData - Mapped;
+                if(Before)
+                {
+                    munmap(Mapped, Before);
+                }
+                munmap(AllocData + AllocSize, LargePageSize - Before);
+                
+                if(madvise(AllocData, AllocSize, MADV_HUGEPAGE) == 0)
+                {
+                    Buffer->Count = Params->Dest.Count;
+                    Buffer->Data = AllocData;
+                }
+                else
+                {
+                    munmap(AllocData, AllocSize);
+                    Error(Tester, "madvise(MADV_HUGEPAGE) failed (is THP disabled?)");
+                }
+            }
+            else if(LargePageSize)
+            {
+                Error(Tester, "Allocation failed");
+            }
+        } break;
+#endif
         
         default:
         {
@@ -119,12 +244,26 @@ static void HandleDeallocation(read_parameters *Params, buffer *Buffer)
             FreeBuffer(Buffer);
         } break;
         
+#if _WIN32
         case AllocType_VirtualAlloc:
         case AllocType_VirtualAllocLargePages:
         {
             VirtualFree(Buffer->Data, 0, MEM_RELEASE);
             *Buffer = {};
         } break;
+#else
+        case AllocType_mmap:
+        case AllocType_mmapPopulate:
+        case AllocType_mmapHugeTLB:
+        case AllocType_mmapTHP:
+        {
+            if(Buffer->Data)
+            {
+                munmap(Buffer->Data, GetAllocationSize(Params->AllocType, Buffer->Count));
+            }
+            *Buffer = {};
+        } break;
+#endif
         
         default:
         {
@@ -170,7 +309,11 @@ static void ReadViaRead(repetition_tester *Tester, read_parameters *Params)
 {
     while(IsTesting(Tester))
     {
+#if _WIN32
         int File = _open(Params->FileName, _O_BINARY|_O_RDONLY);
+#else
+        int File = open(Params->FileName, O_RDONLY);
+#endif
         if(File != -1)
         {
             buffer DestBuffer = Params->Dest;
@@ -186,34 +329,85 @@ static void ReadViaRead(repetition_tester *Tester, read_parameters *Params)
                     ReadSize = (u32)SizeRemaining;
                 }
 
+                // NOTE: Linux reads at most 0x7ffff000 bytes per call, so a short read is not an error - only
+                // reading nothing is
                 BeginTime(Tester);
+#if _WIN32
                 int Result = _read(File, Dest, ReadSize);
+#else
+                int Result = (int)read(File, Dest, ReadSize);
+#endif
                 EndTime(Tester);
 
-                if(Result == (int)ReadSize)
+                if(Result > 0)
                 {
-                    CountBytes(Tester, ReadSize);
+                    CountBytes(Tester, Result);
                 }
                 else
                 {
-                    Error(Tester, "_read failed");
+                    Error(Tester, "read failed");
                     break;
                 }
                 
-                SizeRemaining -= ReadSize;
-                Dest += ReadSize;
+                SizeRemaining -= Result;
+                Dest += Result;
             }
             
             HandleDeallocation(Params, &DestBuffer);
+#if _WIN32
             _close(File);
+#else
+            close(File);
+#endif
         }
         else
         {
-            Error(Tester, "_open failed");
+            Error(Tester, "open failed");
         }
     }
 }
 
+/* NOTE: The haversine CLI's --io=uring reader: Depth reads of BlockSize in flight, on io_uring where the kernel has
+   it. AllocType_none leaves each block where it was read, like a parser consuming it in place would; with an
+   allocation every block is copied into the destination while the next ones are read, so it compares with fread. */
+static void ReadViaAsyncReader(repetition_tester *Tester, read_parameters *Params)
+{
+    size_t const BlockSize = 1024*1024;
+    size_t const Depth = 4;
+    
+    while(IsTesting(Tester))
+    {
+        buffer DestBuffer = Params->Dest;
+        HandleAllocation(Tester, Params, &DestBuffer);
+        
+        try
+        {
+            AsyncFileReader Reader(Params->FileName, BlockSize, Depth, 0);
+            AsyncFileReader::Block Block;
+            
+            BeginTime(Tester);
+            while(Reader.next(Block))
+            {
+                if((Params->AllocType != AllocType_none) && DestBuffer.Data)
+                {
+                    memcpy(DestBuffer.Data + Block.offset, Block.data, Block.size);
+                }
+                CountBytes(Tester, Block.size);
+                Reader.release();
+            }
+            EndTime(Tester);
+        }
+        catch(std::exception const &Exception)
+        {
+            EndTime(Tester);
+            Error(Tester, Exception.what());
+        }
+        
+        HandleDeallocation(Params, &DestBuffer);
+    }
+}
+
+#if _WIN32
 static void ReadViaReadFile(repetition_tester *Tester, read_parameters *Params)
 {
     while(IsTesting(Tester))
@@ -262,3 +456,106 @@ static void ReadViaReadFile(repetition_tester *Tester, read_parameters *Params)
         }
     }
 }
+#else
+
+/* NOTE: O_DIRECT skips the page cache and DMAs straight into the buffer. The buffer, the file offset and every read
+   size have to be aligned to the device's block size - every allocation type here is at least page aligned, and the
+   last read is rounded up to a whole page, which the page granular allocation always has room for. */
+static void ReadViaReadDirect(repetition_tester *Tester, read_parameters *Params)
+{
+    u64 const Alignment = 4096;
+    
+    while(IsTesting(Tester))
+    {
+        int File = open(Params->FileName, O_RDONLY|O_DIRECT);
+        if(File != -1)
+        {
+            buffer DestBuffer = Params->Dest;
+            HandleAllocation(Tester, Params, &DestBuffer);
+            
+            u8 *Dest = DestBuffer.Data;
+            u64 SizeRemaining = DestBuffer.Count;
+            while(SizeRemaining)
+            {
+                u64 ReadSize = 1024*1024*1024;
+                if(ReadSize > SizeRemaining)
+                {
+                    ReadSize = (SizeRemaining + Alignment - 1) & ~(Alignment - 1);
+                }
+                
+                BeginTime(Tester);
+                ssize_t Result = read(File, Dest, ReadSize);
+                EndTime(Tester);
+                
+                if(Result > 0)
+                {
+                    if((u64)Result > SizeRemaining)
+                    {
+                        Result = SizeRemaining;
+                    }
+                    CountBytes(Tester, Result);
+                }
+                else
+                {
+                    Error(Tester, "O_DIRECT read failed (the file system may not support it)");
+                    break;
+                }
+                
+                SizeRemaining -= Result;
+                Dest += Result;
+            }
+            
+            HandleDeallocation(Params, &DestBuffer);
+            close(File);
+        }
+        else
+        {
+            Error(Tester, "open with O_DIRECT failed");
+        }
+    }
+}
+
+/* NOTE: Asks the kernel to pull the whole file into the page cache before the reads, both inside the timing. When the
+   file is cached already readahead only walks the cache, so this shows its overhead over ReadViaRead. */
+static void ReadViaReadahead(repetition_tester *Tester, read_parameters *Params)
+{
+    while(IsTesting(Tester))
+    {
+        int File = open(Params->FileName, O_RDONLY);
+        if(File != -1)
+        {
+            buffer DestBuffer = Params->Dest;
+            HandleAllocation(Tester, Params, &DestBuffer);
+            
+            BeginTime(Tester);
+            readahead(File, 0, DestBuffer.Count);
+            
+            u8 *Dest = DestBuffer.Data;
+            u64 SizeRemaining = DestBuffer.Count;
+            while(SizeRemaining)
+            {
+                ssize_t Result = read(File, Dest, SizeRemaining);
+                if(Result <= 0)
+                {
+                    Error(Tester, "read failed");
+                    break;
+                }
+                
+                SizeRemaining -= Result;
+                Dest += Result;
+            }
+            EndTime(Tester);
+            
+            CountBytes(Tester, DestBuffer.Count - SizeRemaining);
+            
+            HandleDeallocation(Params, &DestBuffer);
+            close(File);
+        }
+        else
+        {
+            Error(Tester, "open failed");
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,174 @@
+/* ========================================================================
+
+   (C) Copyright 2023 by Molly Rocket, Inc., All Rights Reserved.
+   
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+   
+   Please see https://computerenhance.com for more information
+   
+   ======================================================================== */
+
+/* ========================================================================
+   LISTING 128
+   ======================================================================== */
+
+/* NOTE(casey): _CRT_SECURE_NO_WARNINGS is here because otherwise we cannot
+   call fopen(). If we replace fopen() with fopen_s() to avoid the warning,
+   then the code doesn't compile on Linux anymore, since fopen_s() does not
+   exist there.
+   
+   What exactly the CRT maintainers were thinking when they made this choice,
+   I have no idea. */
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "listing_0125_buffer.cpp"
+#include "listing_0126_os_platform.cpp"
+#include "listing_0109_pagefault_repetition_tester.cpp"
+#include "listing_0136_repetition_tester_options.cpp"
+#include "listing_0127_largepageread_overhead_test.cpp"
+
+struct test_function
+{
+    char const *Name;
+    read_overhead_test_func *Func;
+};
+test_function TestFunctions[] =
+{
+    {"fread", ReadViaFRead},
+    {"AsyncFileReader", ReadViaAsyncReader},
+#if _WIN32
+    {"_read", ReadViaRead},
+    {"ReadFile", ReadViaReadFile},
+#else
+    {"read", ReadViaRead},
+    {"read (O_DIRECT)", ReadViaReadDirect},
+    {"readahead + read", ReadViaReadahead},
+#endif
+};
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+    
+    repetition_options Options = DefaultRepetitionOptions();
+    char *FileName = 0;
+    b32 ArgsValid = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char *Arg = Args[ArgIndex];
+        if(!ParseRepetitionOption(&Options, Arg))
+        {
+            if(!FileName && (Arg[0] != '-'))
+            {
+                FileName = Arg;
+            }
+            else
+            {
+                ArgsValid = false;
+            }
+        }
+    }
+    
+    // NOTE: --test picks a read function, which then runs with every allocation type
+    u32 SelectedCount = 0;
+    for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+    {
+        SelectedCount += IsTestSelected(&Options, TestFunctions[FuncIndex].Name);
+    }
+    
+    if(FileName && ArgsValid && !Options.Invalid && SelectedCount)
+    {
+        // NOTE: --counters adds the hardware counters to every result, when this machine has them
+        if(Options.UseCounters)
+        {
+            InitializeOSPerfCounters();
+        }
+        
+#if _WIN32
+        struct __stat64 Stat;
+        _stat64(FileName, &Stat);
+#else
+        struct stat Stat;
+        stat(FileName, &Stat);
+#endif
+        
+        read_parameters Params = {};
+        Params.Dest = AllocateBuffer(Stat.st_size);
+        Params.FileName = FileName;
+    
+        if(Params.Dest.Count > 0)
+        {
+            repetition_tester Testers[ArrayCount(TestFunctions)][AllocType_Count] = {};
+            char TestNames[ArrayCount(TestFunctions)][AllocType_Count][64];
+            
+            for(u32 Round = 0; !Options.RoundCount || (Round < Options.RoundCount); ++Round)
+            {
+                for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+                {
+                    test_function TestFunc = TestFunctions[FuncIndex];
+                    if(!IsTestSelected(&Options, TestFunc.Name))
+                    {
+                        continue;
+                    }
+                    
+                    for(u32 AllocType = 0; AllocType < AllocType_Count; ++AllocType)
+                    {
+                        Params.AllocType = (allocation_type)AllocType;
+                        
+                        repetition_tester *Tester = &Testers[FuncIndex][AllocType];
+                        char *TestName = TestNames[FuncIndex][AllocType];
+                        snprintf(TestName, sizeof(TestNames[0][0]), "%s%s%s",
+                                 DescribeAllocationType(Params.AllocType),
+                                 Params.AllocType ? " + " : "",
+                                 TestFunc.Name);
+                        
+                        printf("\n--- %s ---\n", TestName);
+                        Tester->Name = TestName;
+                        Tester->Settings = Options.Settings;
+                        NewTestWave(Tester, Params.Dest.Count, GetCPUTimerFreq(), Options.SecondsToTry);
+                        TestFunc.Func(Tester, &Params);
+                    }
+                }
+                
+                WriteRepetitionResults(&Options, &Testers[0][0], ArrayCount(TestFunctions)*AllocType_Count);
+            }
+            
+            FreeBuffer(&Params.Dest);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Test data size must be non-zero\n");
+        }
+    }
+    else if(FileName && ArgsValid && !Options.Invalid)
+    {
+        fprintf(stderr, "ERROR: No test named \"%s\"\n", Options.TestName);
+    }
+    else
+    {
+        fprintf(stderr, "Usage: %s [existing filename] [options]\n", Args[0]);
+        PrintRepetitionOptionsUsage();
+    }
+    
+    return 0;
+}
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <sys/stat.h>
 
@@ -43,6 +44,7 @@ typedef double f64;
 #include "listing_0125_buffer.cpp"
 #include "listing_0126_os_platform.cpp"
 #include "listing_0109_pagefault_repetition_tester.cpp"
+#include "listing_0136_repetition_tester_options.cpp"
 #include "listing_0127_largepageread_overhead_test.cpp"
 #include "listing_0131_front_end_test.cpp"
 
@@ -64,9 +66,39 @@ int main(int ArgCount, char **Args)
 {
     InitializeOSPlatform();
     
-    if(ArgCount == 2)
+    repetition_options Options = DefaultRepetitionOptions();
+    char *FileName = 0;
+    b32 ArgsValid = true;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
     {
-        char *FileName = Args[1];
+        char *Arg = Args[ArgIndex];
+        if(!ParseRepetitionOption(&Options, Arg))
+        {
+            if(!FileName && (Arg[0] != '-'))
+            {
+                FileName = Arg;
+            }
+            else
+            {
+                ArgsValid = false;
+            }
+        }
+    }
+    
+    u32 SelectedCount = 0;
+    for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
+    {
+        SelectedCount += IsTestSelected(&Options, TestFunctions[FuncIndex].Name);
+    }
+    
+    if(FileName && ArgsValid && !Options.Invalid && SelectedCount)
+    {
+        // NOTE: --counters adds the hardware counters to every result, when this machine has them
+        if(Options.UseCounters)
+        {
+            InitializeOSPerfCounters();
+        }
+        
 #if _WIN32
         struct __stat64 Stat;
         _stat64(FileName, &Stat);
@@ -83,38 +115,55 @@ int main(int ArgCount, char **Args)
         {
             repetition_tester Testers[ArrayCount(TestFunctions)] = {};
             
-            for(;;)
+            for(u32 Round = 0; !Options.RoundCount || (Round < Options.RoundCount); ++Round)
             {
                 for(u32 FuncIndex = 0; FuncIndex < ArrayCount(TestFunctions); ++FuncIndex)
                 {
                     repetition_tester *Tester = &Testers[FuncIndex];
                     test_function TestFunc = TestFunctions[FuncIndex];
+                    if(!IsTestSelected(&Options, TestFunc.Name))
+                    {
+                        continue;
+                    }
                     
                     printf("\n--- %s ---\n", TestFunc.Name);
-                    NewTestWave(Tester, Params.Dest.Count, GetCPUTimerFreq());
+                    Tester->Name = TestFunc.Name;
+                    Tester->Settings = Options.Settings;
+                    NewTestWave(Tester, Params.Dest.Count, GetCPUTimerFreq(), Options.SecondsToTry);
                     TestFunc.Func(Tester, &Params);
                 }
+                
+                WriteRepetitionResults(&Options, Testers, ArrayCount(Testers));
             }
             
-            // NOTE(casey): We would normally call this here, but we can't because the compiler will complain about "unreachable code".
-            // So instead we just reference the pointer to prevent the compiler complaining about unused function :(
-            (void)&FreeBuffer;
+            FreeBuffer(&Params.Dest);
         }
         else
         {
             fprintf(stderr, "ERROR: Test data size must be non-zero\n");
         }
     }
+    else if(FileName && ArgsValid && !Options.Invalid)
+    {
+        fprintf(stderr, "ERROR: No test named \"%s\"\n", Options.TestName);
+    }
     else
     {
-        fprintf(stderr, "Usage: %s [existing filename]\n", Args[0]);
+        fprintf(stderr, "Usage: %s [existing filename] [options]\n", Args[0]);
+        PrintRepetitionOptionsUsage();
     }
 
     // NOTE(casey): We don't use these functions
     (void)&DescribeAllocationType;
     (void)&ReadViaFRead;
     (void)&ReadViaRead;
+    (void)&ReadViaAsyncReader;
+#if _WIN32
     (void)&ReadViaReadFile;
+#else
+    (void)&ReadViaReadDirect;
+    (void)&ReadViaReadahead;
+#endif
 
     return 0;
 }
@@ -0,0 +1,314 @@
+/* ========================================================================
+   Microarchitecture probe suite. Runs every loop of
+   listing_0134_probe_loops.S under the repetition tester and prints a
+   summary table at the end - what to look at on a new machine before the
+   parser is tuned for it:
+
+     align   the same tiny loop at offsets into a cache line
+     nop     loop bodies padded with NOPs of growing width (front end)
+     ports   1-4 loads and 1-3 stores per iteration (load/store ports)
+     branch  one branch per byte, taken in patterns of growing period
+     cache   read bandwidth at working sets from 4kb up (L1 to DRAM)
+
+   The probes are System V assembly, so this only builds on Linux x64.
+   ======================================================================== */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int32_t b32;
+
+typedef float f32;
+typedef double f64;
+
+#define ArrayCount(Array) (sizeof(Array)/sizeof((Array)[0]))
+
+#include "listing_0125_buffer.cpp"
+#include "listing_0126_os_platform.cpp"
+#include "listing_0109_pagefault_repetition_tester.cpp"
+
+#if _WIN32
+#error "The probe loops are System V assembly, the suite only builds on Linux"
+#endif
+
+typedef void probe_asm_func(u64 Count, u8 *Data, u64 Mask);
+
+extern "C" probe_asm_func AlignedLoop0ASM, AlignedLoop16ASM, AlignedLoop28ASM, AlignedLoop30ASM, AlignedLoop32ASM,
+    AlignedLoop48ASM, AlignedLoop60ASM, AlignedLoop62ASM, AlignedLoop63ASM;
+extern "C" probe_asm_func NOP1x4ASM, NOP3x4ASM, NOP5x4ASM, NOP7x4ASM, NOP9x4ASM, NOP11x4ASM, NOP15x4ASM;
+extern "C" probe_asm_func Read_x1ASM, Read_x2ASM, Read_x3ASM, Read_x4ASM, Write_x1ASM, Write_x2ASM, Write_x3ASM;
+extern "C" probe_asm_func ConditionalNOPASM;
+extern "C" probe_asm_func ReadMaskedSSEASM, ReadMaskedAVXASM;
+
+enum branch_pattern
+{
+    Branch_None,
+    Branch_NeverTaken,
+    Branch_AlwaysTaken,
+    Branch_Every2,
+    Branch_Every3,
+    Branch_Every4,
+    Branch_Every16,
+    Branch_Every64,
+    Branch_Random,
+};
+
+struct probe
+{
+    char const *Group;
+    char Name[32];
+    probe_asm_func *Func;
+
+    u64 Count;       // NOTE: What the loop counts - iterations, loads/stores or bytes
+    u64 BytesPerOp;  // NOTE: Memory touched per counted op, 0 when the probe isn't about memory
+    u64 Mask;        // NOTE: Working set - 1, for the cache probes
+    branch_pattern Pattern;
+
+    repetition_tester Tester;
+};
+
+/* NOTE: Iteration counts - enough that the loop runs for milliseconds, so the timer reads around it don't show */
+static u64 const LOOP_COUNT = 64*1024*1024;
+static u64 const PORT_OP_COUNT = 12*4*1024*1024; // NOTE: A multiple of every load/store count per iteration
+static u64 const BRANCH_COUNT = 16*1024*1024;
+static u64 const MIN_CACHE_READ_COUNT = 64*1024*1024;
+
+static void FillBranchPattern(u8 *Data, u64 Count, branch_pattern Pattern)
+{
+    u64 Random = 0x9E3779B97F4A7C15ull;
+    for(u64 Index = 0; Index < Count; ++Index)
+    {
+        u8 Value = 0;
+        switch(Pattern)
+        {
+            case Branch_NeverTaken: Value = 0; break;
+            case Branch_AlwaysTaken: Value = 1; break;
+            case Branch_Every2: Value = ((Index % 2) == 0); break;
+            case Branch_Every3: Value = ((Index % 3) == 0); break;
+            case Branch_Every4: Value = ((Index % 4) == 0); break;
+            case Branch_Every16: Value = ((Index % 16) == 0); break;
+            case Branch_Every64: Value = ((Index % 64) == 0); break;
+            case Branch_Random:
+            {
+                // NOTE: xorshift64 - no period a predictor could learn, and the same bytes every run
+                Random ^= Random << 13;
+                Random ^= Random >> 7;
+                Random ^= Random << 17;
+                Value = (u8)(Random & 1);
+            } break;
+
+            default: break;
+        }
+        Data[Index] = Value;
+    }
+}
+
+static probe *AddProbe(probe *Probes, u32 *ProbeCount, char const *Group, char const *Name, probe_asm_func *Func,
+                       u64 Count, u64 BytesPerOp)
+{
+    probe *Probe = &Probes[(*ProbeCount)++];
+    Probe->Group = Group;
+    snprintf(Probe->Name, sizeof(Probe->Name), "%s", Name);
+    Probe->Func = Func;
+    Probe->Count = Count;
+    Probe->BytesPerOp = BytesPerOp;
+    return Probe;
+}
+
+static void RunProbe(probe *Probe, buffer Data, u32 SecondsToTry)
+{
+    repetition_tester *Tester = &Probe->Tester;
+    if(Probe->Pattern != Branch_None)
+    {
+        FillBranchPattern(Data.Data, Probe->Count, Probe->Pattern);
+    }
+
+    NewTestWave(Tester, Probe->Count*(Probe->BytesPerOp ? Probe->BytesPerOp : 1), GetCPUTimerFreq(), SecondsToTry);
+    while(IsTesting(Tester))
+    {
+        BeginTime(Tester);
+        Probe->Func(Probe->Count, Data.Data, Probe->Mask);
+        EndTime(Tester);
+
+        CountBytes(Tester, Probe->Count*(Probe->BytesPerOp ? Probe->BytesPerOp : 1));
+    }
+}
+
+/* NOTE: From the best run of each probe. Core cycles when the hardware counters are open, CPU timer ticks when they
+   aren't - those only match cycles on a machine running at its nominal clock. */
+static void PrintSummary(probe *Probes, u32 ProbeCount, b32 HaveCycles)
+{
+    char const *Unit = HaveCycles ? "cycles" : "ticks";
+    printf("\n%-7s %-20s %12s %12s %10s %10s %10s\n", "group", "probe", "count", Unit, "per op", "ops/clk", "gb/s");
+    for(u32 ProbeIndex = 0; ProbeIndex < ProbeCount; ++ProbeIndex)
+    {
+        probe *Probe = &Probes[ProbeIndex];
+        repetition_value Min = Probe->Tester.Results.Min;
+        if(!Min.E[RepValue_TestCount])
+        {
+            continue;
+        }
+
+        f64 Clocks = (f64)(HaveCycles ? Min.E[RepValue_Cycles] : Min.E[RepValue_CPUTimer]);
+        f64 Count = (f64)Probe->Count;
+        printf("%-7s %-20s %12llu %12.0f %10.3f %10.3f", Probe->Group, Probe->Name, (unsigned long long)Probe->Count,
+               Clocks, Clocks / Count, Count / Clocks);
+        if(Probe->BytesPerOp)
+        {
+            f64 Seconds = SecondsFromCPUTime((f64)Min.E[RepValue_CPUTimer], GetCPUTimerFreq());
+            f64 Gigabyte = (1024.0f * 1024.0f * 1024.0f);
+            printf(" %10.3f", (f64)Min.E[RepValue_ByteCount] / (Gigabyte * Seconds));
+        }
+        printf("\n");
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    InitializeOSPlatform();
+
+    u32 SecondsToTry = 1;
+    u64 MaxWorkingSet = 256*1024*1024;
+    b32 UseCounters = false;
+    char const *OnlyGroup = 0;
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        char const *Arg = Args[ArgIndex];
+        if(strcmp(Arg, "--counters") == 0)
+        {
+            UseCounters = true;
+        }
+        else if(strncmp(Arg, "--seconds=", 10) == 0)
+        {
+            SecondsToTry = (u32)atoi(Arg + 10);
+        }
+        else if(strncmp(Arg, "--max-mb=", 9) == 0)
+        {
+            MaxWorkingSet = strtoull(Arg + 9, 0, 10)*1024*1024;
+        }
+        else if(strncmp(Arg, "--group=", 8) == 0)
+        {
+            OnlyGroup = Arg + 8;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--group=align|nop|ports|branch|cache] [--seconds=<no new minimum for>]"
+                    " [--max-mb=<largest cache working set>] [--counters]\n", Args[0]);
+            return 1;
+        }
+    }
+    if(UseCounters)
+    {
+        UseCounters = InitializeOSPerfCounters();
+    }
+    if(SecondsToTry == 0)
+    {
+        SecondsToTry = 1;
+    }
+
+    // NOTE: Working sets are powers of two, the cache loop wraps its offsets with a mask
+    u64 WorkingSet = 4096;
+    while((WorkingSet*2) <= MaxWorkingSet)
+    {
+        WorkingSet *= 2;
+    }
+    MaxWorkingSet = WorkingSet;
+
+    static probe Probes[128];
+    u32 ProbeCount = 0;
+
+    struct {char const *Name; probe_asm_func *Func;} AlignedLoops[] =
+    {
+        {"offset 0", AlignedLoop0ASM}, {"offset 16", AlignedLoop16ASM}, {"offset 28", AlignedLoop28ASM},
+        {"offset 30", AlignedLoop30ASM}, {"offset 32", AlignedLoop32ASM}, {"offset 48", AlignedLoop48ASM},
+        {"offset 60", AlignedLoop60ASM}, {"offset 62", AlignedLoop62ASM}, {"offset 63", AlignedLoop63ASM},
+    };
+    for(u32 Index = 0; Index < ArrayCount(AlignedLoops); ++Index)
+    {
+        AddProbe(Probes, &ProbeCount, "align", AlignedLoops[Index].Name, AlignedLoops[Index].Func, LOOP_COUNT, 0);
+    }
+
+    struct {char const *Name; probe_asm_func *Func;} NOPLoops[] =
+    {
+        {"4 x 1-byte NOP", NOP1x4ASM}, {"4 x 3-byte NOP", NOP3x4ASM}, {"4 x 5-byte NOP", NOP5x4ASM},
+        {"4 x 7-byte NOP", NOP7x4ASM}, {"4 x 9-byte NOP", NOP9x4ASM}, {"4 x 11-byte NOP", NOP11x4ASM},
+        {"4 x 15-byte NOP", NOP15x4ASM},
+    };
+    for(u32 Index = 0; Index < ArrayCount(NOPLoops); ++Index)
+    {
+        AddProbe(Probes, &ProbeCount, "nop", NOPLoops[Index].Name, NOPLoops[Index].Func, LOOP_COUNT, 0);
+    }
+
+    struct {char const *Name; probe_asm_func *Func;} PortLoops[] =
+    {
+        {"1 load", Read_x1ASM}, {"2 loads", Read_x2ASM}, {"3 loads", Read_x3ASM}, {"4 loads", Read_x4ASM},
+        {"1 store", Write_x1ASM}, {"2 stores", Write_x2ASM}, {"3 stores", Write_x3ASM},
+    };
+    for(u32 Index = 0; Index < ArrayCount(PortLoops); ++Index)
+    {
+        AddProbe(Probes, &ProbeCount, "ports", PortLoops[Index].Name, PortLoops[Index].Func, PORT_OP_COUNT, 8);
+    }
+
+    struct {char const *Name; branch_pattern Pattern;} BranchPatterns[] =
+    {
+        {"never taken", Branch_NeverTaken}, {"always taken", Branch_AlwaysTaken}, {"every 2", Branch_Every2},
+        {"every 3", Branch_Every3}, {"every 4", Branch_Every4}, {"every 16", Branch_Every16},
+        {"every 64", Branch_Every64}, {"random", Branch_Random},
+    };
+    for(u32 Index = 0; Index < ArrayCount(BranchPatterns); ++Index)
+    {
+        probe *Probe = AddProbe(Probes, &ProbeCount, "branch", BranchPatterns[Index].Name, ConditionalNOPASM,
+                                BRANCH_COUNT, 0);
+        Probe->Pattern = BranchPatterns[Index].Pattern;
+    }
+
+    // NOTE: 256-bit loads where the CPU has them, L1 bandwidth is twice what 128-bit loads can reach on most cores
+    b32 HaveAVX = __builtin_cpu_supports("avx");
+    for(WorkingSet = 4096; WorkingSet <= MaxWorkingSet; WorkingSet *= 2)
+    {
+        char Name[32];
+        b32 InMegabytes = (WorkingSet >= 1024*1024);
+        snprintf(Name, sizeof(Name), "%llu%s %s", (unsigned long long)(WorkingSet / (InMegabytes ? 1024*1024 : 1024)),
+                 InMegabytes ? "mb" : "kb", HaveAVX ? "avx" : "sse");
+
+        u64 Count = (WorkingSet > MIN_CACHE_READ_COUNT) ? WorkingSet : MIN_CACHE_READ_COUNT;
+        probe *Probe = AddProbe(Probes, &ProbeCount, "cache", Name, HaveAVX ? ReadMaskedAVXASM : ReadMaskedSSEASM,
+                                Count, 1);
+        Probe->Mask = WorkingSet - 1;
+    }
+
+    // NOTE: One buffer for everything - the branch patterns and the largest working set
+    buffer Data = AllocateBuffer((MaxWorkingSet > BRANCH_COUNT) ? MaxWorkingSet : BRANCH_COUNT);
+    if(!Data.Count)
+    {
+        return 1;
+    }
+    memset(Data.Data, 1, Data.Count); // NOTE: Faulted in up front, so no probe counts page faults
+
+    for(u32 ProbeIndex = 0; ProbeIndex < ProbeCount; ++ProbeIndex)
+    {
+        probe *Probe = &Probes[ProbeIndex];
+        if(OnlyGroup && strcmp(OnlyGroup, Probe->Group))
+        {
+            continue;
+        }
+
+        printf("\n--- %s: %s ---\n", Probe->Group, Probe->Name);
+        RunProbe(Probe, Data, SecondsToTry);
+    }
+
+    PrintSummary(Probes, ProbeCount, UseCounters);
+    FreeBuffer(&Data);
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+/* ========================================================================
+   LISTING 136
+
+   Command line options and result export for the repetition tester
+   mains that run a TestFunctions table. Include it after listing 109.
+   ======================================================================== */
+
+struct repetition_options
+{
+    repetition_settings Settings;
+    u32 SecondsToTry;
+    u32 RoundCount; // times every test runs, 0 runs until the process is stopped
+    char const *TestName; // run only the TestFunctions entry with this name
+    char const *JSONPath;
+    char const *CSVPath;
+    b32 UseCounters;
+    b32 Invalid;
+};
+
+static repetition_options DefaultRepetitionOptions(void)
+{
+    repetition_options Result = {};
+    Result.SecondsToTry = 10;
+    return Result;
+}
+
+static void PrintRepetitionOptionsUsage(void)
+{
+    fprintf(stderr, "  --counters          add the hardware counters to every result, when this machine has them\n");
+    fprintf(stderr, "  --test=<name>       run only the test with this name\n");
+    fprintf(stderr, "  --seconds=<n>       end a test after n seconds without a new minimum (default 10)\n");
+    fprintf(stderr, "  --warmup=<n>        runs at the start of every test that aren't recorded\n");
+    fprintf(stderr, "  --ci=<fraction>     also end a test once the 95%% confidence interval of its mean is within\n");
+    fprintf(stderr, "                      fraction of the mean, e.g. 0.01\n");
+    fprintf(stderr, "  --min-runs=<n>      with --ci, the runs a test records before it may end (default 10)\n");
+    fprintf(stderr, "  --rounds=<n>        run every test n times, then exit (default: until stopped)\n");
+    fprintf(stderr, "  --json=<file>       write the results to file as JSON after every round\n");
+    fprintf(stderr, "  --csv=<file>        write the results to file as CSV after every round\n");
+}
+
+static b32 ParseRepetitionU32(char const *Value, u32 *Result)
+{
+    char *End = 0;
+    unsigned long Parsed = strtoul(Value, &End, 10);
+    b32 Valid = (End != Value) && (*End == 0) && (Parsed <= 0xffffffffu);
+    if(Valid)
+    {
+        *Result = (u32)Parsed;
+    }
+    return Valid;
+}
+
+/* NOTE: Returns whether Arg was one of the options above. A recognised option with a bad value sets Invalid. */
+static b32 ParseRepetitionOption(repetition_options *Options, char const *Arg)
+{
+    b32 Recognised = true;
+    if(strcmp(Arg, "--counters") == 0)
+    {
+        Options->UseCounters = true;
+    }
+    else if(strncmp(Arg, "--test=", 7) == 0)
+    {
+        Options->TestName = Arg + 7;
+        Options->Invalid |= (Options->TestName[0] == 0);
+    }
+    else if(strncmp(Arg, "--seconds=", 10) == 0)
+    {
+        Options->Invalid |= !ParseRepetitionU32(Arg + 10, &Options->SecondsToTry);
+    }
+    else if(strncmp(Arg, "--warmup=", 9) == 0)
+    {
+        Options->Invalid |= !ParseRepetitionU32(Arg + 9, &Options->Settings.WarmupCount);
+    }
+    else if(strncmp(Arg, "--min-runs=", 11) == 0)
+    {
+        Options->Invalid |= !ParseRepetitionU32(Arg + 11, &Options->Settings.MinSampleCount);
+    }
+    else if(strncmp(Arg, "--rounds=", 9) == 0)
+    {
+        Options->Invalid |= !ParseRepetitionU32(Arg + 9, &Options->RoundCount);
+    }
+    else if(strncmp(Arg, "--ci=", 5) == 0)
+    {
+        char *End = 0;
+        Options->Settings.TargetCI = strtod(Arg + 5, &End);
+        Options->Invalid |= (End == Arg + 5) || (*End != 0) || !(Options->Settings.TargetCI > 0);
+    }
+    else if(strncmp(Arg, "--json=", 7) == 0)
+    {
+        Options->JSONPath = Arg + 7;
+        Options->Invalid |= (Options->JSONPath[0] == 0);
+    }
+    else if(strncmp(Arg, "--csv=", 6) == 0)
+    {
+        Options->CSVPath = Arg + 6;
+        Options->Invalid |= (Options->CSVPath[0] == 0);
+    }
+    else
+    {
+        Recognised = false;
+    }
+
+    return Recognised;
+}
+
+static b32 IsTestSelected(repetition_options *Options, char const *Name)
+{
+    b32 Result = (!Options->TestName || (strcmp(Options->TestName, Name) == 0));
+    return Result;
+}
+
+struct repetition_summary
+{
+    u64 RunCount;
+    f64 Min;
+    f64 Median;
+    f64 P90;
+    f64 P99;
+    f64 Max;
+    f64 Mean;
+    f64 StdDev;
+    f64 CI95;
+    f64 MinGBps;
+    f64 MedianGBps;
+    f64 PageFaults; // per run
+};
+
+static repetition_summary SummarizeTester(repetition_tester *Tester)
+{
+    repetition_summary Result = {};
+    repetition_samples *Samples = &Tester->Samples;
+    repetition_test_results *Results = &Tester->Results;
+    f64 ByteCount = (f64)Tester->TargetProcessedByteCount;
+
+    Result.RunCount = Samples->Count;
+    Result.Min = (f64)Results->Min.E[RepValue_CPUTimer];
+    Result.Median = SamplePercentile(Samples, 0.5);
+    Result.P90 = SamplePercentile(Samples, 0.9);
+    Result.P99 = SamplePercentile(Samples, 0.99);
+    Result.Max = (f64)Results->Max.E[RepValue_CPUTimer];
+    Result.Mean = Samples->Mean;
+    Result.StdDev = SampleStdDev(Samples);
+    Result.CI95 = SampleConfidence95(Samples);
+    Result.MinGBps = GigabytesPerSecond(ByteCount, Result.Min, Tester->CPUTimerFreq);
+    Result.MedianGBps = GigabytesPerSecond(ByteCount, Result.Median, Tester->CPUTimerFreq);
+    if(Samples->Count)
+    {
+        Result.PageFaults = (f64)Results->Total.E[RepValue_MemPageFaults] / (f64)Samples->Count;
+    }
+
+    return Result;
+}
+
+/* NOTE: Times are in CPU timer ticks - cpu_timer_freq converts them to seconds. Testers that never recorded a run
+   (not selected, or not reached yet) are left out. */
+static b32 WriteRepetitionResultsJSON(char const *Path, repetition_tester *Testers, u32 TesterCount)
+{
+    FILE *File = fopen(Path, "wb");
+    if(File)
+    {
+        fprintf(File, "{\n  \"cpu_timer_freq\": %llu,\n  \"tests\": [", (unsigned long long)GetCPUTimerFreq());
+        char const *Separator = "\n";
+        for(u32 TesterIndex = 0; TesterIndex < TesterCount; ++TesterIndex)
+        {
+            repetition_tester *Tester = &Testers[TesterIndex];
+            if(Tester->Samples.Count)
+            {
+                repetition_summary S = SummarizeTester(Tester);
+
+                fprintf(File, "%s    {\"name\": \"", Separator);
+                for(char const *At = Tester->Name ? Tester->Name : ""; *At; ++At)
+                {
+                    if((*At == '"') || (*At == '\\'))
+                    {
+                        fputc('\\', File);
+                    }
+                    fputc(*At, File);
+                }
+                fprintf(File, "\", \"runs\": %llu, \"bytes\": %llu, \"min\": %.0f, \"median\": %.0f, \"p90\": %.0f, "
+                        "\"p99\": %.0f, \"max\": %.0f, \"mean\": %.1f, \"stddev\": %.1f, \"ci95\": %.1f, "
+                        "\"min_gbps\": %.4f, \"median_gbps\": %.4f, \"page_faults\": %.4f}",
+                        (unsigned long long)S.RunCount, (unsigned long long)Tester->TargetProcessedByteCount,
+                        S.Min, S.Median, S.P90, S.P99, S.Max, S.Mean, S.StdDev, S.CI95, S.MinGBps, S.MedianGBps,
+                        S.PageFaults);
+                Separator = ",\n";
+            }
+        }
+        fprintf(File, "\n  ]\n}\n");
+
+        return (fclose(File) == 0);
+    }
+
+    return false;
+}
+
+static b32 WriteRepetitionResultsCSV(char const *Path, repetition_tester *Testers, u32 TesterCount)
+{
+    FILE *File = fopen(Path, "wb");
+    if(File)
+    {
+        fprintf(File, "name,runs,bytes,cpu_timer_freq,min,median,p90,p99,max,mean,stddev,ci95,min_gbps,median_gbps,"
+                "page_faults\n");
+        for(u32 TesterIndex = 0; TesterIndex < TesterCount; ++TesterIndex)
+        {
+            repetition_tester *Tester = &Testers[TesterIndex];
+            if(Tester->Samples.Count)
+            {
+                repetition_summary S = SummarizeTester(Tester);
+
+                // NOTE: Names are quoted, some have spaces and parentheses in them
+                fprintf(File, "\"%s\",%llu,%llu,%llu,%.0f,%.0f,%.0f,%.0f,%.0f,%.1f,%.1f,%.1f,%.4f,%.4f,%.4f\n",
+                        Tester->Name ? Tester->Name : "", (unsigned long long)S.RunCount,
+                        (unsigned long long)Tester->TargetProcessedByteCount, (unsigned long long)GetCPUTimerFreq(),
+                        S.Min, S.Median, S.P90, S.P99, S.Max, S.Mean, S.StdDev, S.CI95, S.MinGBps, S.MedianGBps,
+                        S.PageFaults);
+            }
+        }
+
+        return (fclose(File) == 0);
+    }
+
+    return false;
+}
+
+static b32 WriteRepetitionResults(repetition_options *Options, repetition_tester *Testers, u32 TesterCount)
+{
+    b32 Result = true;
+    if(Options->JSONPath && !WriteRepetitionResultsJSON(Options->JSONPath, Testers, TesterCount))
+    {
+        fprintf(stderr, "ERROR: Unable to write \"%s\".\n", Options->JSONPath);
+        Result = false;
+    }
+    if(Options->CSVPath && !WriteRepetitionResultsCSV(Options->CSVPath, Testers, TesterCount))
+    {
+        fprintf(stderr, "ERROR: Unable to write \"%s\".\n", Options->CSVPath);
+        Result = false;
+    }
+
+    return Result;
+}